@@ -2,6 +2,8 @@
 #define CONVEYOR_H_
 #include "pros/misc.h"
 
+#include <stdbool.h>
+
 /**
  * @file conveyor.h
  *
@@ -12,12 +14,23 @@
  * abstracting away specific information.
  */
 
-// Moves the conveyor up
+/**
+ * @brief Sets up the conveyor's velocity controller
+ *
+ * @details Registers the controller with Ringtail's controller scheduler, so
+ * the scheduler must be started for the conveyor to move.
+ */
+void conveyor_init(void);
+
+// Moves the conveyor up at a constant speed
 void conveyor_up(void);
 
-// Moves the conveyor down
+// Moves the conveyor down at a constant speed
 void conveyor_down(void);
 
+// Returns whether the conveyor is running at its set speed
+bool conveyor_at_speed(void);
+
 /**
  * @brief Conveyor operation controller
  *
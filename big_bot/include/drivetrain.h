@@ -1,6 +1,7 @@
 #ifndef DRIVETRAIN_H_
 #define DRIVETRAIN_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "pros/misc.h"
@@ -43,8 +44,8 @@ void drivetrain_opcontrol(controller_analog_e_t left,
  *
  * @details This function takes in a distance to travel forward, in inches.
  * Negative values indicate moving backwards. The function sets the targets for
- * the left and right motor group PID controllers, so the PID tasks must be
- * running for the function to do anything.
+ * the drivetrain's PID controller, which ramps towards them along a motion
+ * profile, so the PID tasks must be running for the function to do anything.
  *
  * @param inches the distance to travel forward, in inches
  */
@@ -55,8 +56,9 @@ void drivetrain_move_straight(double inches);
  *
  * @details This function takes in an angle, in degrees, to rotate
  * counterclockwise. Negative values indicate a clockwise rotation. The function
- * sets the targets for the left and right motor group PID controllers, so the
- * PID tasks must be running for the function to do anything.
+ * sets the targets for the drivetrain's PID controller, which ramps towards
+ * them along a motion profile, so the PID tasks must be running for the
+ * function to do anything.
  *
  * @param angle the angle for the drive to rotate counterclockwise, in degrees
  */
@@ -65,18 +67,23 @@ void drivetrain_turn_angle(double angle);
 /**
  * @brief Delays until all drivetrain PID controllers have reached their targets
  *
- * @details This function continuously calls the PROS delay function while any
- * of the PID controllers for the drivetrain have yet to reach their target.
+ * @details This function blocks until both of the PID controllers for the
+ * drivetrain have reached the target set by the last move or turn, or until
+ * timeout ms have passed, whichever comes first.
+ *
+ * @param timeout The most time to wait, in ms, or TIMEOUT_MAX to wait forever
+ *
+ * @return true if both controllers reached their targets, false if it timed out
  */
-void drivetrain_wait_until_at_target(uint32_t timeout);
+bool drivetrain_wait_until_at_target(uint32_t timeout);
 
-// Suspend the drivetrain PID tasks
+// Suspend the drivetrain PID controllers
 void drivetrain_suspend_pid_tasks(void);
 
-// Resume the drivetrain PID tasks
+// Resume the drivetrain PID controllers
 void drivetrain_resume_pid_tasks(void);
 
-// Delete the drivetrain PID tasks
+// Stop the drivetrain PID controllers, same as suspending them
 void drivetrain_delete_pid_tasks(void);
 
 #endif /* DRIVETRAIN_H_ */
\ No newline at end of file
@@ -10,6 +10,13 @@
  * system.
  */
 
+#ifndef RINGTAIL_CONTROLLER_H_
+#define RINGTAIL_CONTROLLER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #include "ringtail/motor_group.h"
 
 #include "pros/rtos.h"
@@ -17,14 +24,111 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// The default time between controller cycles, in ms
+#define RGT_CONTROLLER_DEFAULT_PERIOD 10
+
+/**
+ * A cycle is counted as an overrun when it starts more than this long (us)
+ * after it was due
+ */
+#define RGT_CONTROLLER_OVERRUN_MARGIN 1000
+
+// The most tasks that can wait on a single controller at once
+#define RGT_CONTROLLER_MAX_WAITERS 4
+
+/**
+ * Timing statistics for a controller, measured between the starts of
+ * consecutive cycles. Periods are in microseconds.
+ */
 typedef struct {
-	int8_t *mg; // Ringtail Motor Group to control
+	uint32_t cycles;     // Cycles measured
+	uint32_t min_period; // Shortest period
+	uint32_t max_period; // Longest period
+	double mean_period;  // Mean period
+	// Cycles that started more than RGT_CONTROLLER_OVERRUN_MARGIN late
+	uint32_t overruns;
+} Rgt_Controller_Timing;
+
+/**
+ * Set to 0 (e.g. with -DRGT_CONTROLLER_PROFILING=0 in EXTRA_CFLAGS) to compile
+ * out the controller profiling. The profiling fields are then left out of the
+ * controller structs and the loops don't read the clock for it, so it costs
+ * nothing.
+ */
+#ifndef RGT_CONTROLLER_PROFILING
+#define RGT_CONTROLLER_PROFILING 1
+#endif
+
+/**
+ * The number of buckets in a profiling histogram. Bucket 0 counts durations of
+ * 0 us, and bucket b counts durations from 2^(b-1) to 2^b - 1 us, except the
+ * last bucket, which counts everything from 2^(b-1) us up.
+ */
+#define RGT_CONTROLLER_HISTOGRAM_BUCKETS 16
+
+/**
+ * A histogram of durations, in microseconds
+ */
+typedef struct {
+	uint32_t counts[RGT_CONTROLLER_HISTOGRAM_BUCKETS];
+	uint32_t samples; // Durations recorded
+	uint32_t max;     // Longest duration
+	uint64_t total;   // Sum of the durations, for the mean
+} Rgt_Controller_Histogram;
+
+/**
+ * Where a controller's cycles spend their time. Every cycle adds one sample to
+ * each histogram.
+ */
+typedef struct {
+	// Time spent reading the sensors (get_sensor_data)
+	Rgt_Controller_Histogram sensor;
+	// Time spent checking the error and determining the voltage
+	// (calculate_voltage)
+	Rgt_Controller_Histogram compute;
+	// Time spent sending the voltage to the motors
+	Rgt_Controller_Histogram actuate;
+	// How long after its scheduled time the cycle started
+	Rgt_Controller_Histogram lateness;
+} Rgt_Controller_Profile;
+
+#if RGT_CONTROLLER_PROFILING
+/**
+ * Internal state for profiling a controller. Only the controller loop writes
+ * the profile, so it is read without a lock - each value is read atomically,
+ * but a read that races a cycle may see some histograms with one more sample
+ * than others.
+ */
+typedef struct {
+	Rgt_Controller_Profile profile;
+	// Set to have the loop clear the profile
+	bool reset;
+	// The time (us) the next cycle is scheduled to start, 0 if unknown
+	uint64_t next_cycle_time;
+} Rgt_Controller_Profiler;
+#endif
+
+typedef struct {
+	const Rgt_Motor_Group *mg; // Ringtail Motor Group to control
 	// Function to get sensor data used as the controller input
 	double (*get_sensor_data)(void);
 	// Function to determine the voltage to send to the motor group - the
 	// "controller". Must take the target value, current value, and a boolean
 	// for indicating a reset
 	double (*calculate_voltage)(double, double, bool);
+	// Versions of get_sensor_data and calculate_voltage that take a context
+	// pointer as their first argument, so one function can serve many
+	// controllers. When set, they are used instead of the versions without
+	// context. See rgt_controller_info_init_ctx
+	double (*get_sensor_data_ctx)(void *);
+	double (*calculate_voltage_ctx)(void *, double, double, bool);
+	// The context pointers passed to get_sensor_data_ctx and
+	// calculate_voltage_ctx
+	void *sensor_context;
+	void *controller_context;
+	// target, reset, and at_target are shared between the controller loop and
+	// other tasks without a lock - use the rgt_controller_* functions to access
+	// them once the controller is running.
 	// The target value for the controller - can be initialized to 0
 	double target;
 	// Whether the state of the controller should be reset. This exists mainly
@@ -38,8 +142,30 @@ typedef struct {
 	// The number of iterations that the controller is within
 	// error_settle_threshold before the controller sets at_target to true
 	uint32_t error_below_thresh_max_cnt;
-	// Mutex to prevent race conditions
+	// Mutex for code that shares state with the controller's callbacks. The
+	// controller loop and the rgt_controller_* functions don't take it
 	mutex_t mutex;
+	// Internal state - the number of consecutive iterations the error has been
+	// within error_settle_threshold
+	uint32_t error_below_thresh_cnt;
+	// The time between cycles, in ms. Set with rgt_controller_set_period
+	uint32_t period;
+	// Internal state - timing statistics, see rgt_controller_get_timing. The
+	// loop publishes them to alternating buffers, timing_seq counts the
+	// publishes and its lowest bit selects the latest buffer
+	Rgt_Controller_Timing timing[2];
+	uint32_t timing_seq;
+	// Internal state - set to have the loop clear the timing statistics
+	bool timing_reset;
+	// Internal state - the time (us) the last cycle started, 0 if never
+	uint64_t last_cycle_time;
+	// Internal state - tasks to notify when at_target becomes true, NULL for
+	// unused slots
+	task_t waiters[RGT_CONTROLLER_MAX_WAITERS];
+#if RGT_CONTROLLER_PROFILING
+	// Internal state - see rgt_controller_get_profile
+	Rgt_Controller_Profiler profiler;
+#endif
 } Rgt_Controller_Info;
 
 /**
@@ -48,16 +174,19 @@ typedef struct {
  *
  * @details This function simplifies the creation of a Rgt_Controller_Info
  * struct by removing the need to initialize some variables, namely: target,
- * reset, and at_target.
+ * reset, at_target, and period, which is set to
+ * RGT_CONTROLLER_DEFAULT_PERIOD.
  *
- * @param mg The Ringtail Motor Group to control
+ * @param mg A pointer to the Ringtail Motor Group to control - the group must
+ * outlive the controller
  * @param get_sensor_data A function pointer that returns the sensor data to be
  * used as input to the controller.
  * @param calculate_voltage A function pointer to a function that determines the
  * voltage to supply to the controller based on the target value and current
  * value - also includes a flag to allow for resetting the state of the
  * controller.
- * @param mutex A mutex lock - used to prevent race conditions
+ * @param mutex A mutex lock for code that shares state with the callbacks.
+ * Ringtail doesn't take it itself.
  * @param error_settle_threshold The maximum value of error at which the
  * controller considers itself to be at the target value
  * @param error_below_thresh_max_cnt The number of iterations that the
@@ -65,20 +194,56 @@ typedef struct {
  * at_target to true
  */
 Rgt_Controller_Info
-rgt_controller_info_init(rgt_motor_group mg, double (*get_sensor_data)(void),
+rgt_controller_info_init(const Rgt_Motor_Group *mg,
+                         double (*get_sensor_data)(void),
                          double (*calculate_voltage)(double, double, bool),
                          mutex_t mutex, double error_settle_threshold,
                          uint32_t error_below_thresh_max_cnt);
 
+/**
+ * @brief Creates a Rgt_Controller_Info struct with context-carrying callbacks
+ *
+ * @details The same as rgt_controller_info_init, but the callbacks take a
+ * context pointer as their first argument. This lets several controllers share
+ * one sensor function and one controller function, each with its own state -
+ * e.g. calculate_voltage can be rgt_pid_controller with a Rgt_PID as its
+ * context.
+ *
+ * @param mg A pointer to the Ringtail Motor Group to control - the group must
+ * outlive the controller
+ * @param get_sensor_data A function pointer that returns the sensor data to be
+ * used as input to the controller. It is passed sensor_context.
+ * @param sensor_context The context pointer for get_sensor_data
+ * @param calculate_voltage A function pointer to a function that determines the
+ * voltage to supply to the controller. It is passed controller_context, then
+ * the same arguments as the calculate_voltage of rgt_controller_info_init.
+ * @param controller_context The context pointer for calculate_voltage
+ * @param mutex A mutex lock for code that shares state with the callbacks.
+ * Ringtail doesn't take it itself.
+ * @param error_settle_threshold The maximum value of error at which the
+ * controller considers itself to be at the target value
+ * @param error_below_thresh_max_cnt The number of iterations that the
+ * controller is within error_settle_threshold before the controller sets
+ * at_target to true
+ */
+Rgt_Controller_Info rgt_controller_info_init_ctx(
+    const Rgt_Motor_Group *mg, double (*get_sensor_data)(void *),
+    void *sensor_context,
+    double (*calculate_voltage)(void *, double, double, bool),
+    void *controller_context, mutex_t mutex, double error_settle_threshold,
+    uint32_t error_below_thresh_max_cnt);
+
 /**
  * @brief Creates a Ringtail Controller as a PROS task
  *
  * @details This function handles the creation of a Ringtail controller as a
  * PROS task. It creates a task whose function is Ringtail's controller
- * function. This function runs forever (with a 10ms delay between cycles). This
- * function handles the actual control of the motor - getting the current sensor
- * data, determining the error and if the controller has reached its target,
- * determining the output voltage, and moving the motor group.
+ * function. This function runs forever, one cycle every period ms. The cycles
+ * are on a fixed schedule (using task_delay_until), so the time spent in a
+ * cycle doesn't add to the period. This function handles the actual control of
+ * the motor - getting the current sensor data, determining the error and if the
+ * controller has reached its target, determining the output voltage, and
+ * moving the motor group.
  *
  * @param Rgt_Controller_Info The Controller info to use for the controller
  * The other parameters are directly passed to PROS's task_create function, see
@@ -88,27 +253,316 @@ rgt_controller_info_init(rgt_motor_group mg, double (*get_sensor_data)(void),
 task_t rgt_controller_create(Rgt_Controller_Info *i, uint8_t priority,
                              uint16_t stack_depth, const char *name);
 
+/**
+ * @brief Runs a single cycle of a Ringtail controller
+ *
+ * @details This is the body of the controller task's loop: it gets the current
+ * sensor data, updates at_target, determines the output voltage, and moves the
+ * motor group. It is used by the controller scheduler to run many controllers
+ * in one task, and can be called from your own loop too. It never blocks on
+ * other tasks. Only one task may run a given controller.
+ *
+ * @param i The controller info of the controller to run
+ */
+void rgt_controller_step(Rgt_Controller_Info *i);
+
+/**
+ * @brief Sets the time between controller cycles
+ *
+ * @details Controller tasks pick up the new period on their next cycle. The
+ * scheduler sets the period of the controllers it runs itself, from its period
+ * and their dividers, so this shouldn't be used for them.
+ *
+ * @param i The controller info
+ * @param period The time between cycles, in ms
+ */
+void rgt_controller_set_period(Rgt_Controller_Info *i, uint32_t period);
+
+/**
+ * @brief Gets the controller's timing statistics
+ *
+ * @details The statistics show how close the controller runs to its period -
+ * the min, max, and mean time between cycles, and how many cycles started late.
+ * Use them to check that a controller can keep up with a shorter period. This
+ * reads the statistics without locking, so it never blocks the controller.
+ *
+ * @param i The controller info
+ */
+Rgt_Controller_Timing rgt_controller_get_timing(Rgt_Controller_Info *i);
+
+// Clears the controller's timing statistics, starting on its next cycle
+void rgt_controller_reset_timing(Rgt_Controller_Info *i);
+
+/**
+ * @brief Gets the controller's profile
+ *
+ * @details The profile holds histograms of how long each cycle spends reading
+ * the sensors, computing the voltage, and moving the motors, and of how late
+ * each cycle starts. Use it to find slow sensor paths, and to pick a period
+ * the controller can keep up with. Lateness is measured against a fixed
+ * schedule, so under the scheduler it includes the time taken by controllers
+ * that run earlier in the same cycle. A cycle more than a whole period late
+ * (e.g. after the controller was paused) restarts the schedule.
+ *
+ * This reads the profile without locking, so it never blocks the controller.
+ *
+ * @param i The controller info
+ * @param profile The struct to copy the profile into
+ *
+ * @return true if the profile was copied, false if profiling is compiled out
+ * (see RGT_CONTROLLER_PROFILING), in which case profile is zeroed
+ */
+bool rgt_controller_get_profile(Rgt_Controller_Info *i,
+                                Rgt_Controller_Profile *profile);
+
+// Clears the controller's profile, starting on its next cycle
+void rgt_controller_reset_profile(Rgt_Controller_Info *i);
+
+/**
+ * @brief Estimates a percentile of the durations in a histogram
+ *
+ * @details Finds the bucket holding the percentile and returns its upper
+ * bound, so the estimate is never below the true value and is at most twice
+ * it. The estimate is capped at the histogram's max.
+ *
+ * @param h The histogram
+ * @param percentile The percentile, from 0 to 100 - e.g. 99 for the duration
+ * that 99% of samples are at or below
+ *
+ * @return The estimated duration in microseconds, or 0 if the histogram has no
+ * samples
+ */
+uint32_t rgt_controller_histogram_percentile(const Rgt_Controller_Histogram *h,
+                                             double percentile);
+
 /**
  * @brief Gets the at_target value from a Rgt_Controller_Info
  *
- * @details To ensure that the at_target value is accurate, one must take the
- * mutex in the Rgt_Controller_Info struct. This function wraps that process,
- * allowing programmers to ignore the specifics of multithreading.
+ * @details The controller loop publishes at_target atomically, so this never
+ * blocks and never makes the loop wait. It returns false while a reset is
+ * pending, since the controller hasn't evaluated the new state yet.
  */
 bool rgt_controller_at_target(Rgt_Controller_Info *i);
 
+/**
+ * @brief Waits until the controller reaches its target, or times out
+ *
+ * @details Blocks the calling task on a task notification, which the controller
+ * loop sends when at_target becomes true, so waiting takes no CPU time.
+ * at_target stays true until the controller is reset, so reset the controller
+ * along with setting a new target to wait for the new target.
+ *
+ * The calling task's notification value is used for the wait, so it shouldn't
+ * also be waiting on other notifications.
+ *
+ * @param i The controller info
+ * @param timeout The most time to wait, in ms, or TIMEOUT_MAX to wait forever
+ * @param elapsed If not NULL, set to the time spent waiting, in ms
+ *
+ * @return true if the controller reached its target, false if it timed out
+ */
+bool rgt_controller_wait_settled(Rgt_Controller_Info *i, uint32_t timeout,
+                                 uint32_t *elapsed);
+
+/**
+ * @brief Waits until all the controllers reach their targets, or times out
+ *
+ * @details Waits the same way as rgt_controller_wait_settled.
+ *
+ * @param infos The controllers to wait on
+ * @param count The number of controllers
+ * @param timeout The most time to wait, in ms, or TIMEOUT_MAX to wait forever
+ * @param elapsed If not NULL, set to the time spent waiting, in ms
+ *
+ * @return true if every controller reached its target, false if it timed out
+ */
+bool rgt_controller_wait_all(Rgt_Controller_Info *const *infos, uint8_t count,
+                             uint32_t timeout, uint32_t *elapsed);
+
+/**
+ * @brief Waits until any of the controllers reaches its target, or times out
+ *
+ * @details Waits the same way as rgt_controller_wait_settled.
+ *
+ * @param infos The controllers to wait on
+ * @param count The number of controllers
+ * @param timeout The most time to wait, in ms, or TIMEOUT_MAX to wait forever
+ * @param elapsed If not NULL, set to the time spent waiting, in ms
+ *
+ * @return The index in infos of a controller that reached its target, or -1 if
+ * it timed out
+ */
+int rgt_controller_wait_any(Rgt_Controller_Info *const *infos, uint8_t count,
+                            uint32_t timeout, uint32_t *elapsed);
+
 /**
  * @brief Sets the reset flag for the controller
  *
- * @details Sets the reset flag for the controller, including taking and giving
- * the mutex - allowing programmers to ignore the specifics of multithreading.
+ * @details Sets the reset flag for the controller atomically. The controller
+ * loop consumes it on its next cycle and passes it to calculate_voltage.
  */
 void rgt_controller_reset(Rgt_Controller_Info *i);
 
 /**
  * @brief Sets the target for the controller
  *
- * @details Sets the target for the controller, including taking and giving
- * the mutex - allowing programmers to ignore the specifics of multithreading.
+ * @details Sets the target for the controller atomically, so the controller
+ * loop always sees either the old or the new target, never a mix of the two.
  */
 void rgt_controller_set_target(Rgt_Controller_Info *i, double target);
+
+/*******************************************************************************
+ *                             Coupled Controllers                             *
+ ******************************************************************************/
+
+// The most sensor values (and targets) a coupled controller can have
+#define RGT_COUPLED_MAX_AXES 4
+
+// The most motor groups a coupled controller can drive
+#define RGT_COUPLED_MAX_OUTPUTS 4
+
+/**
+ * A controller that drives several motor groups from one shared set of sensor
+ * values - e.g. both sides of a tank drive from its distance and heading. Each
+ * cycle reads every sensor value once, computes every group's voltage, then
+ * moves all the groups together, so the outputs never act on different
+ * readings. See rgt_tank_get_sensor_data and rgt_tank_calculate_voltages for
+ * a reference tank drive controller.
+ */
+typedef struct {
+	// Motor groups to control - the groups must outlive the controller
+	const Rgt_Motor_Group *mgs[RGT_COUPLED_MAX_OUTPUTS];
+	uint8_t output_count;
+	// The number of sensor values, and targets for them
+	uint8_t axis_count;
+	// Function to read every sensor value into the array, in axis order. It is
+	// passed sensor_context
+	void (*get_sensor_data)(void *, double *);
+	void *sensor_context;
+	// Function to determine the voltage for every motor group. Takes
+	// controller_context, the targets, the sensor values, a reset flag, and
+	// the array to store the voltages in, in motor group order
+	void (*calculate_voltages)(void *, const double *, const double *, bool,
+	                           double *);
+	void *controller_context;
+	// The maximum error for each axis at which the controller considers
+	// itself to be at the targets
+	double error_settle_thresholds[RGT_COUPLED_MAX_AXES];
+	// The number of iterations that every axis is within its threshold before
+	// the controller sets at_target to true
+	uint32_t error_below_thresh_max_cnt;
+	// The time between cycles, in ms
+	uint32_t period;
+	// Internal state - the targets, published to alternating buffers like the
+	// timing statistics of Rgt_Controller_Info
+	double targets[2][RGT_COUPLED_MAX_AXES];
+	uint32_t target_seq;
+	// Internal state - timing statistics, kept like those of
+	// Rgt_Controller_Info. See rgt_coupled_controller_get_timing
+	Rgt_Controller_Timing timing[2];
+	uint32_t timing_seq;
+	bool timing_reset;
+	uint64_t last_cycle_time;
+	// Internal state, shared without a lock like in Rgt_Controller_Info
+	bool reset;
+	bool at_target;
+	uint32_t error_below_thresh_cnt;
+	task_t waiters[RGT_CONTROLLER_MAX_WAITERS];
+#if RGT_CONTROLLER_PROFILING
+	Rgt_Controller_Profiler profiler;
+#endif
+} Rgt_Coupled_Controller;
+
+/**
+ * @brief Creates a Rgt_Coupled_Controller struct
+ *
+ * @details The targets start at 0 and the period at
+ * RGT_CONTROLLER_DEFAULT_PERIOD.
+ *
+ * @param mgs The motor groups to control - the groups must outlive the
+ * controller
+ * @param output_count The number of motor groups, up to
+ * RGT_COUPLED_MAX_OUTPUTS
+ * @param axis_count The number of sensor values, up to RGT_COUPLED_MAX_AXES
+ * @param get_sensor_data A function that reads every sensor value
+ * @param sensor_context The context pointer for get_sensor_data
+ * @param calculate_voltages A function that determines every group's voltage
+ * @param controller_context The context pointer for calculate_voltages
+ * @param error_settle_thresholds The settle threshold for each axis
+ * @param error_below_thresh_max_cnt The number of iterations that every axis
+ * is within its threshold before the controller sets at_target to true
+ */
+Rgt_Coupled_Controller rgt_coupled_controller_init(
+    const Rgt_Motor_Group *const *mgs, uint8_t output_count,
+    uint8_t axis_count, void (*get_sensor_data)(void *, double *),
+    void *sensor_context,
+    void (*calculate_voltages)(void *, const double *, const double *, bool,
+                               double *),
+    void *controller_context, const double *error_settle_thresholds,
+    uint32_t error_below_thresh_max_cnt);
+
+/**
+ * @brief Runs a single cycle of a coupled controller
+ *
+ * @details The coupled version of rgt_controller_step. Only one task may run a
+ * given controller.
+ */
+void rgt_coupled_controller_step(Rgt_Coupled_Controller *c);
+
+/**
+ * @brief Creates a coupled controller as a PROS task
+ *
+ * @details The coupled version of rgt_controller_create. The parameters after
+ * the controller are passed to PROS's task_create function.
+ */
+task_t rgt_coupled_controller_create(Rgt_Coupled_Controller *c,
+                                     uint8_t priority, uint16_t stack_depth,
+                                     const char *name);
+
+/**
+ * @brief Sets every target of a coupled controller at once
+ *
+ * @details The controller loop always sees a complete set of targets, old or
+ * new, and never waits on this function. Only one task should set a given
+ * controller's targets.
+ *
+ * @param c The controller
+ * @param targets The new targets, one for each axis
+ */
+void rgt_coupled_controller_set_targets(Rgt_Coupled_Controller *c,
+                                        const double *targets);
+
+// The coupled version of rgt_controller_reset
+void rgt_coupled_controller_reset(Rgt_Coupled_Controller *c);
+
+// The coupled version of rgt_controller_at_target
+bool rgt_coupled_controller_at_target(Rgt_Coupled_Controller *c);
+
+// The coupled version of rgt_controller_wait_settled
+bool rgt_coupled_controller_wait_settled(Rgt_Coupled_Controller *c,
+                                         uint32_t timeout, uint32_t *elapsed);
+
+// The coupled version of rgt_controller_get_timing
+Rgt_Controller_Timing
+rgt_coupled_controller_get_timing(Rgt_Coupled_Controller *c);
+
+// The coupled version of rgt_controller_reset_timing
+void rgt_coupled_controller_reset_timing(Rgt_Coupled_Controller *c);
+
+/**
+ * @brief The coupled version of rgt_controller_get_profile
+ *
+ * @details The actuate histogram covers moving all the controller's motor
+ * groups.
+ */
+bool rgt_coupled_controller_get_profile(Rgt_Coupled_Controller *c,
+                                        Rgt_Controller_Profile *profile);
+
+// The coupled version of rgt_controller_reset_profile
+void rgt_coupled_controller_reset_profile(Rgt_Coupled_Controller *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGTAIL_CONTROLLER_H_ */
@@ -4,9 +4,10 @@
  * @brief Definitions for the motor group and related functions
  *
  * @details This file contains the type definition for Ringtail's motor group
- * structure, the base unit for all Ringtail functions. In reality, the motor
- * group struct is just an array of 21 8 bit integers, which account for all 21
- * smart ports on the v5 brain.
+ * structure, the base unit for all Ringtail functions. The motor group stores
+ * the number of motors, their (unsigned) ports, and a bitmask of which motors
+ * are reversed, so the rgt_mg_* functions never have to scan for the end of
+ * the group.
  */
 
 #ifndef RINGTAIL_MOTOR_GROUP_H_
@@ -22,23 +23,363 @@ using namespace pros::c;
 
 #include "pros/motors.h"
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
- * Ringtail's motor group is defined to be an array of int8_t of length 21, as a
- * single v5 brain has 21 ports that can be used for a motor. While no one in
- * their right mind would have a use case for all 21 motors in 1 group, there's
- * no harm in using the technical limit, as long as we have a limit.
- *
- * Setting a defined limit allows us to just pass the array to and from
- * functions without having to also pass the length. Because values that aren't
- * initialized in an array in C are set to 0, we can check once user-defined
- * values stop by seeing if the port value is 0.
+ * A motor group can hold up to 21 motors, as a single v5 brain has 21 ports
+ * that can be used for a motor. While no one in their right mind would have a
+ * use case for all 21 motors in 1 group, there's no harm in using the technical
+ * limit, as long as we have a limit.
+ *
+ * rgt_motor_group is the original array form of a motor group: an array of
+ * int8_t of length 21 holding signed PROS ports. Because values that aren't
+ * initialized in an array in C are set to 0, the user-defined values end at the
+ * first 0. Convert it to a Rgt_Motor_Group with rgt_mg_init.
  */
 #define RGT_MG_SIZE 21
 
 typedef int8_t rgt_motor_group[RGT_MG_SIZE];
 
+/**
+ * The longest time, in ms, that rgt_mg_get_aligned_positions will extrapolate a
+ * motor's position by. Motors report new data every 10 ms, so anything older
+ * than this means the motor isn't reporting.
+ */
+#define RGT_MG_MAX_EXTRAPOLATION 20
+
+/**
+ * Counters kept by a group's output shaping, to tune the limits with. They are
+ * reset by rgt_mg_set_output.
+ */
+typedef struct {
+	uint32_t commands;     // Commands that went through the slew limiter
+	uint32_t slew_limited; // Commands changed by the slew limit
+	uint32_t jerk_limited; // Commands changed by the jerk limit
+} Rgt_MG_Output_Stats;
+
+/**
+ * Optional output shaping for a motor group. Attach one to a group with
+ * rgt_mg_set_output to change how rgt_mg_move and rgt_mg_move_voltage drive
+ * the motors. The struct holds per-group state, so each group needs its own,
+ * and only one task should command a group that has one.
+ */
+typedef struct {
+	// Current balancing: trims each motor's voltage so all the motors in the
+	// group draw about the same current, so one doesn't overheat first
+	bool balance_current;
+	// How far (mA) a motor's current can be from the group mean before it is
+	// trimmed
+	double balance_band;
+	// How much (mV per mA outside the band) the trim changes per command
+	double balance_gain;
+	// The largest trim (mV) that can be applied to a single motor
+	int16_t balance_max_trim;
+	// Internal state - the trim (mV) currently applied to each motor
+	double balance_trims[RGT_MG_SIZE];
+
+	// Battery compensation for this group, even when it isn't enabled for all
+	// groups. See rgt_mg_set_battery_compensation
+	bool compensate_battery;
+
+	// Slew limiting: the most (mV) the group's output can change per command,
+	// or 0 for no limit. Commands from rgt_mg_move are limited by the same
+	// amount, converted from the -127 to 127 range
+	int32_t max_slew;
+	// Jerk limiting: the most (mV) the slew can change per command, or 0 for
+	// no limit. The output eases in and out of each change instead of ramping
+	// at a constant rate. Only used with max_slew
+	int32_t max_jerk;
+	// Internal state - the last output (mV) and how much it last changed by
+	double slew_output;
+	double slew_rate;
+	// How often the slew and jerk limits engaged
+	Rgt_MG_Output_Stats stats;
+} Rgt_MG_Output;
+
+/**
+ * Ringtail's motor group descriptor. It is built once - either at compile time
+ * with RGT_MOTOR_GROUP or at runtime from the zero-terminated array form with
+ * rgt_mg_init - and then passed by pointer to every rgt_mg_* function.
+ */
+typedef struct {
+	uint8_t count;              // Number of motors in the group
+	uint8_t ports[RGT_MG_SIZE]; // Smart ports, from 1 to 21
+	uint32_t reversed;          // Bit i is set if motor i is reversed
+	Rgt_MG_Output *output;      // Optional output shaping, NULL for none
+} Rgt_Motor_Group;
+
+// Helpers for RGT_MOTOR_GROUP. These are not meant to be used directly.
+#define RGT_MG_ABS_PORT_(p) ((uint8_t)((p) < 0 ? -(p) : (p)))
+#define RGT_MG_REV_BIT_(p, i) ((p) < 0 ? (uint32_t)1 << (i) : 0)
+#define RGT_MG_ZEROS_                                                          \
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+#define RGT_MG_APPLY_(m, ...) m(__VA_ARGS__)
+#define RGT_MG_PORTS_(p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12,   \
+                      p13, p14, p15, p16, p17, p18, p19, p20, ...)             \
+	{RGT_MG_ABS_PORT_(p0),  RGT_MG_ABS_PORT_(p1),  RGT_MG_ABS_PORT_(p2),       \
+	 RGT_MG_ABS_PORT_(p3),  RGT_MG_ABS_PORT_(p4),  RGT_MG_ABS_PORT_(p5),       \
+	 RGT_MG_ABS_PORT_(p6),  RGT_MG_ABS_PORT_(p7),  RGT_MG_ABS_PORT_(p8),       \
+	 RGT_MG_ABS_PORT_(p9),  RGT_MG_ABS_PORT_(p10), RGT_MG_ABS_PORT_(p11),      \
+	 RGT_MG_ABS_PORT_(p12), RGT_MG_ABS_PORT_(p13), RGT_MG_ABS_PORT_(p14),      \
+	 RGT_MG_ABS_PORT_(p15), RGT_MG_ABS_PORT_(p16), RGT_MG_ABS_PORT_(p17),      \
+	 RGT_MG_ABS_PORT_(p18), RGT_MG_ABS_PORT_(p19), RGT_MG_ABS_PORT_(p20)}
+#define RGT_MG_REVERSED_(p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11,     \
+                         p12, p13, p14, p15, p16, p17, p18, p19, p20, ...)     \
+	(RGT_MG_REV_BIT_(p0, 0) | RGT_MG_REV_BIT_(p1, 1) |                         \
+	 RGT_MG_REV_BIT_(p2, 2) | RGT_MG_REV_BIT_(p3, 3) |                         \
+	 RGT_MG_REV_BIT_(p4, 4) | RGT_MG_REV_BIT_(p5, 5) |                         \
+	 RGT_MG_REV_BIT_(p6, 6) | RGT_MG_REV_BIT_(p7, 7) |                         \
+	 RGT_MG_REV_BIT_(p8, 8) | RGT_MG_REV_BIT_(p9, 9) |                         \
+	 RGT_MG_REV_BIT_(p10, 10) | RGT_MG_REV_BIT_(p11, 11) |                     \
+	 RGT_MG_REV_BIT_(p12, 12) | RGT_MG_REV_BIT_(p13, 13) |                     \
+	 RGT_MG_REV_BIT_(p14, 14) | RGT_MG_REV_BIT_(p15, 15) |                     \
+	 RGT_MG_REV_BIT_(p16, 16) | RGT_MG_REV_BIT_(p17, 17) |                     \
+	 RGT_MG_REV_BIT_(p18, 18) | RGT_MG_REV_BIT_(p19, 19) |                     \
+	 RGT_MG_REV_BIT_(p20, 20))
+
+/**
+ * @brief Compile-time initializer for a Rgt_Motor_Group
+ *
+ * @details Takes the motor ports in the same form PROS uses - negative ports
+ * are reversed - and expands to a constant initializer, so the descriptor can
+ * be a static variable without any runtime setup. Ports must be integer
+ * constants, and 0 is not a valid port.
+ *
+ * Example:
+ *     static Rgt_Motor_Group left_motors = RGT_MOTOR_GROUP(-8, -9, -10);
+ */
+#define RGT_MOTOR_GROUP(...) RGT_MOTOR_GROUP_WITH_OUTPUT(NULL, __VA_ARGS__)
+
+/**
+ * @brief Compile-time initializer for a Rgt_Motor_Group with output shaping
+ *
+ * @details The same as RGT_MOTOR_GROUP, but the group starts with output
+ * already attached, like after rgt_mg_set_output. The output's internal state
+ * and counters must start at 0, which they do for a static Rgt_MG_Output.
+ *
+ * Example:
+ *     static Rgt_MG_Output left_output = {.max_slew = 1000};
+ *     static Rgt_Motor_Group left_motors =
+ *         RGT_MOTOR_GROUP_WITH_OUTPUT(&left_output, -8, -9, -10);
+ */
+#define RGT_MOTOR_GROUP_WITH_OUTPUT(output_, ...)                              \
+	{                                                                          \
+	    .count = sizeof((int8_t[]){__VA_ARGS__}),                              \
+	    .ports = RGT_MG_APPLY_(RGT_MG_PORTS_, __VA_ARGS__, RGT_MG_ZEROS_),     \
+	    .reversed =                                                            \
+	        RGT_MG_APPLY_(RGT_MG_REVERSED_, __VA_ARGS__, RGT_MG_ZEROS_),       \
+	    .output = (output_),                                                   \
+	}
+
+/**
+ * @brief Returns the port of a motor in the group in PROS's signed form
+ *
+ * @details PROS takes negative ports to mean the motor is reversed. This
+ * combines the stored port and reversal bit into that form.
+ *
+ * @param mg The motor group
+ * @param i The index of the motor in the group, from 0 to count - 1
+ */
+static inline int8_t rgt_mg_port(const Rgt_Motor_Group *mg, uint8_t i) {
+	return (mg->reversed >> i) & 1 ? -(int8_t)mg->ports[i]
+	                               : (int8_t)mg->ports[i];
+}
+
+/**
+ * Counters kept by the motor command cache. See rgt_mg_command_cache_enable.
+ */
+typedef struct {
+	uint32_t issued;     // Commands sent to the motors
+	uint32_t suppressed; // Commands skipped because they repeated the last one
+} Rgt_MG_Command_Stats;
+
+/**
+ * The ways Ringtail can combine the readings from the motors in a group into a
+ * single value. Readings of PROS_ERR_F (e.g. from an unplugged motor) are
+ * always left out, whatever the policy.
+ */
+typedef enum {
+	// The mean of all readings
+	RGT_MG_AGGREGATE_MEAN = 0,
+	// The median of all readings
+	RGT_MG_AGGREGATE_MEDIAN,
+	// The mean with the highest and lowest readings left out. Falls back to
+	// the mean with fewer than 3 readings
+	RGT_MG_AGGREGATE_TRIMMED_MEAN,
+	// The mean of the readings within a threshold of the median - drops
+	// motors whose reading diverges, e.g. from a slipping pinion
+	RGT_MG_AGGREGATE_EXCLUDE_OUTLIERS
+} Rgt_MG_Aggregation;
+
+/**
+ * A single motor's telemetry, as read by rgt_mg_snapshot. All values come from
+ * the same pass over the motor group.
+ */
+typedef struct {
+	double position;      // Position in the motor's encoder units
+	double velocity;      // Actual velocity in RPM
+	int32_t current_draw; // Current draw in mA
+	int32_t voltage;      // Voltage delivered to the motor in mV
+	double temperature;   // Temperature in degrees Celsius
+	int32_t raw_position; // Raw encoder count
+	uint32_t timestamp;   // Time (ms) at which raw_position was recorded
+} Rgt_Motor_Sample;
+
+/**
+ * A consistent snapshot of every motor in a motor group, plus the group
+ * aggregates, filled in by rgt_mg_snapshot.
+ */
+typedef struct {
+	// The number of motors in the group, i.e. valid entries in motors
+	uint8_t count;
+	// Per-motor telemetry, in the same order as the ports in the group
+	Rgt_Motor_Sample motors[RGT_MG_SIZE];
+	double average_position;
+	double average_velocity;
+	double average_current_draw;
+	double average_voltage;
+	// The hottest motor in the group - the one that will throttle first
+	double max_temperature;
+	// Time (ms) at which the snapshot was started
+	uint32_t timestamp;
+} Rgt_Motor_Group_Snapshot;
+
+/**
+ * @brief Builds a Rgt_Motor_Group from the zero-terminated array form
+ *
+ * @details Converts an rgt_motor_group array (signed ports, ended by the first
+ * 0 or the end of the array) into a motor group descriptor. Use this once at
+ * initialization when the ports aren't known at compile time, or to keep using
+ * existing array definitions.
+ *
+ * @param ports The zero-terminated array of signed ports
+ *
+ * @return The motor group descriptor
+ */
+Rgt_Motor_Group rgt_mg_init(const rgt_motor_group ports);
+
+/**
+ * @brief Attaches output shaping to a motor group
+ *
+ * @details Resets the output's internal state and counters and attaches it to
+ * the group. Pass NULL to remove the group's output shaping. See Rgt_MG_Output.
+ *
+ * @param mg The motor group
+ * @param output The output shaping settings and state for the group
+ */
+void rgt_mg_set_output(Rgt_Motor_Group *mg, Rgt_MG_Output *output);
+
+/*******************************************************************************
+ *                                Command Cache                                *
+ ******************************************************************************/
+
+/**
+ * @brief Enables the motor command cache
+ *
+ * @details Ringtail remembers the last command sent to each smart port by
+ * rgt_mg_brake, rgt_mg_move, rgt_mg_move_velocity, and rgt_mg_move_voltage.
+ * While the cache is enabled, a command identical to the last one sent to a
+ * port is skipped, unless the last one is older than refresh_interval. The
+ * periodic refresh makes sure a motor that rebooted or was unplugged still
+ * gets re-commanded.
+ *
+ * This is meant for opcontrol loops that send the same command (usually 0)
+ * every iteration. Profiled movements (rgt_mg_move_absolute and
+ * rgt_mg_move_relative) always go through and clear the cached command for
+ * their motors.
+ *
+ * The cache is kept per port, so groups that share a port share its entry.
+ * It isn't synchronized, so each motor should only be commanded from one task
+ * at a time while it is enabled.
+ *
+ * @param refresh_interval The maximum time, in ms, a command can be skipped
+ * for before it is sent again
+ */
+void rgt_mg_command_cache_enable(uint32_t refresh_interval);
+
+/**
+ * @brief Disables the motor command cache - every command is sent
+ */
+void rgt_mg_command_cache_disable(void);
+
+/**
+ * @brief Clears the cached commands for all motors in the group
+ *
+ * @details The next command to each motor in the group is sent even if it
+ * matches the previous one. Use this if something outside of Ringtail changed
+ * the motors' outputs.
+ *
+ * @param mg The motor group to clear the cached commands for
+ */
+void rgt_mg_command_cache_invalidate(const Rgt_Motor_Group *mg);
+
+/**
+ * @brief Returns the number of commands issued and suppressed
+ *
+ * @details Commands are counted per motor, so moving a 3 motor group counts 3
+ * commands. Commands are counted as issued even when the cache is disabled.
+ */
+Rgt_MG_Command_Stats rgt_mg_get_command_stats(void);
+
+// Resets the issued and suppressed command counters to 0
+void rgt_mg_reset_command_stats(void);
+
+/*******************************************************************************
+ *                             Battery Compensation                            *
+ ******************************************************************************/
+
+/**
+ * The default battery voltage (mV) that outputs are compensated to, roughly a
+ * freshly charged V5 battery
+ */
+#define RGT_MG_NOMINAL_BATTERY_VOLTAGE 12800
+
+// How often (ms) the battery voltage is read for compensation
+#define RGT_MG_BATTERY_UPDATE_INTERVAL 100
+
+/**
+ * @brief Enables or disables battery compensation for all motor groups
+ *
+ * @details With battery compensation, rgt_mg_move and rgt_mg_move_voltage scale
+ * their commands by the nominal battery voltage divided by the filtered battery
+ * voltage, so the motors get about the same voltage whether the battery is
+ * fresh or sagging at the end of a match. Controllers tuned on a fresh battery
+ * then behave the same on a tired one. Commands are still limited to the
+ * motors' range, so compensation can't add output at full power.
+ *
+ * Groups with output shaping can also enable compensation for themselves with
+ * the compensate_battery field of Rgt_MG_Output.
+ *
+ * @param enabled Whether every group's output is compensated
+ */
+void rgt_mg_set_battery_compensation(bool enabled);
+
+/**
+ * @brief Sets the battery voltage that outputs are compensated to
+ *
+ * @details This should be about the voltage of the battery the controllers were
+ * tuned on. Defaults to RGT_MG_NOMINAL_BATTERY_VOLTAGE.
+ *
+ * @param nominal_voltage The nominal battery voltage in mV
+ */
+void rgt_mg_set_nominal_battery_voltage(int32_t nominal_voltage);
+
+/**
+ * @brief Returns the filtered battery voltage used for compensation, in mV
+ *
+ * @details The battery is read at most once every
+ * RGT_MG_BATTERY_UPDATE_INTERVAL ms and low-pass filtered, so the voltage
+ * doesn't jump with every current spike and the battery isn't read for every
+ * motor command. It is safe to call from several tasks: only one of them reads
+ * the battery and updates the filter each interval.
+ *
+ * @return The filtered battery voltage, or PROS_ERR_F if the battery couldn't
+ * be read yet
+ */
+double rgt_mg_get_battery_voltage(void);
+
 /*******************************************************************************
  *                              Movement Functions                             *
  ******************************************************************************/
@@ -57,7 +398,7 @@ typedef int8_t rgt_motor_group[RGT_MG_SIZE];
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_brake(const rgt_motor_group mg);
+int32_t rgt_mg_brake(const Rgt_Motor_Group *mg);
 
 /**
  * @brief Sets the voltage for all the motors, from -127 to 127.
@@ -68,13 +409,20 @@ int32_t rgt_mg_brake(const rgt_motor_group mg);
  * The motor_move function sets a motor's voltage to the given value, from -127
  * to 127.
  *
+ * If battery compensation is enabled for the group, the voltage is scaled by
+ * the battery sag. See rgt_mg_set_battery_compensation.
+ *
+ * If the group has output shaping with max_slew set, the voltage is moved
+ * towards the new value by at most max_slew per call. Keep calling this
+ * function (e.g. every opcontrol loop) for the output to reach it.
+ *
  * @param mg The motor group to set the voltage for
  * @param voltage The new motor group voltage from -127 to 127
  *
  * @return 1 if all motor operations were successful, PROS_ERR otherwise
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_move(const rgt_motor_group mg, const int8_t voltage);
+int32_t rgt_mg_move(const Rgt_Motor_Group *mg, const int8_t voltage);
 
 /**
  * @brief Sets the absolute position for all motors to move to
@@ -97,7 +445,7 @@ int32_t rgt_mg_move(const rgt_motor_group mg, const int8_t voltage);
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_move_absolute(const rgt_motor_group mg, const double position,
+int32_t rgt_mg_move_absolute(const Rgt_Motor_Group *mg, const double position,
                              const int32_t velocity);
 
 /**
@@ -120,7 +468,7 @@ int32_t rgt_mg_move_absolute(const rgt_motor_group mg, const double position,
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_move_relative(const rgt_motor_group mg, const double position,
+int32_t rgt_mg_move_relative(const Rgt_Motor_Group *mg, const double position,
                              const int32_t velocity);
 
 /**
@@ -146,7 +494,8 @@ int32_t rgt_mg_move_relative(const rgt_motor_group mg, const double position,
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_move_velocity(const rgt_motor_group mg, const int32_t velocity);
+int32_t rgt_mg_move_velocity(const Rgt_Motor_Group *mg,
+                             const int32_t velocity);
 
 /**
  * @brief Sets the voltage for all the motors to run at, from -12000mV to
@@ -158,13 +507,27 @@ int32_t rgt_mg_move_velocity(const rgt_motor_group mg, const int32_t velocity);
  * The motor_move_voltage function sets a motor's raw voltage from -12000
  * millivolts to +12000 millivolts
  *
+ * If battery compensation is enabled for the group, the voltage is scaled by
+ * the battery sag. See rgt_mg_set_battery_compensation.
+ *
+ * If the group has output shaping with max_slew set, the voltage is moved
+ * towards the new value by at most max_slew per call, and its rate of change is
+ * limited by max_jerk. Keep calling this function for the output to reach it.
+ * Braking, velocity, and profiled movements reset the limiter to 0.
+ *
+ * If the group has output shaping with balance_current set, each motor's
+ * voltage is trimmed based on the current draws from rgt_mg_get_current_draws.
+ * A motor drawing more than balance_band above the group mean has its voltage
+ * magnitude reduced, and one drawing less has it increased. The trims always
+ * average to 0, so the group's total effort is unchanged.
+ *
  * @param mg A motor group to set the voltage for
  * @param voltage The new motor voltage, from -12000mV to +12000mV
  *
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_move_voltage(const rgt_motor_group mg, const int16_t voltage);
+int32_t rgt_mg_move_voltage(const Rgt_Motor_Group *mg, const int16_t voltage);
 
 /**
  * @brief Changes the velocity for a profiled movement (move absolute/relative)
@@ -183,7 +546,7 @@ int32_t rgt_mg_move_voltage(const rgt_motor_group mg, const int16_t voltage);
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_modify_profiled_velocity(const rgt_motor_group mg,
+int32_t rgt_mg_modify_profiled_velocity(const Rgt_Motor_Group *mg,
                                         const int32_t velocity);
 
 /*******************************************************************************
@@ -204,7 +567,7 @@ int32_t rgt_mg_modify_profiled_velocity(const rgt_motor_group mg,
  *
  * @return The average current draw for each motor in the group.
  */
-double rgt_mg_get_average_current_draw(const rgt_motor_group mg);
+double rgt_mg_get_average_current_draw(const Rgt_Motor_Group *mg);
 
 /**
  * @brief Retrieves the current draw for each motor in the group
@@ -213,11 +576,15 @@ double rgt_mg_get_average_current_draw(const rgt_motor_group mg);
  * writes those values to an array passed in as an argument. It uses the PROS
  * motor_get_current_draw function to get the current draw for each motor.
  *
- * @param mg The motor group to get the average current draw for
+ * Motors that fail to read are written as PROS_ERR_F, like the other double
+ * readings, so the values can be passed straight to rgt_mg_aggregate.
+ *
+ * @param mg The motor group to get the current draws for
  * @param current_draws An array to write all the motor current draws to. Should
  * be initialized to the number of elements in mg.
  */
-void rgt_mg_get_current_draws(const rgt_motor_group mg, double *current_draws);
+void rgt_mg_get_current_draws(const Rgt_Motor_Group *mg,
+                              double *current_draws);
 
 /**
  * @brief Returns the average position of all the motors in the group
@@ -233,7 +600,7 @@ void rgt_mg_get_current_draws(const rgt_motor_group mg, double *current_draws);
  *
  * @return The average position for all the motors in the group
  */
-double rgt_mg_get_average_position(const rgt_motor_group mg);
+double rgt_mg_get_average_position(const Rgt_Motor_Group *mg);
 
 /**
  * @brief Retrieves the position for each motor in the group
@@ -246,7 +613,92 @@ double rgt_mg_get_average_position(const rgt_motor_group mg);
  * @param positions An array to write all the motor positions to. Should
  * be initialized to the length value from the motor group.
  */
-void rgt_mg_get_positions(const rgt_motor_group mg, double *positions);
+void rgt_mg_get_positions(const Rgt_Motor_Group *mg, double *positions);
+
+/**
+ * @brief Retrieves the position of each motor, aligned to a common time
+ *
+ * @details The motors in a group report positions that were sampled at
+ * slightly different times, so on a fast-moving mechanism the readings are
+ * skewed relative to each other. This function reads each motor's position,
+ * velocity, and the timestamp of its latest encoder sample (from the PROS
+ * motor_get_raw_position function). It then extrapolates every position
+ * forward, using the motor's velocity, to the newest timestamp in the group.
+ *
+ * Extrapolation is capped at RGT_MG_MAX_EXTRAPOLATION ms, so a motor with
+ * stale data (e.g. one that was unplugged) can't run away. Motors whose
+ * position, velocity, or timestamp fail to read can't be aligned, so their
+ * positions are PROS_ERR_F.
+ *
+ * Each motor's encoder units and gearing are read the first time it is used
+ * and then cached. Change them with rgt_mg_set_encoder_units and
+ * rgt_mg_set_gearing, which clear the cache, rather than the PROS functions.
+ *
+ * @param mg The motor group to get the positions for
+ * @param positions An array to write the aligned positions to. Should be
+ * initialized to the length value from the motor group.
+ *
+ * @return The time (ms) the positions are aligned to
+ */
+uint32_t rgt_mg_get_aligned_positions(const Rgt_Motor_Group *mg,
+                                      double *positions);
+
+/**
+ * @brief Returns the average position of the group, aligned to a common time
+ *
+ * @details Averages the positions from rgt_mg_get_aligned_positions with
+ * rgt_mg_aggregate, so motors that fail to read are left out. Use this
+ * instead of rgt_mg_get_average_position as the input to a position
+ * controller on a fast-moving mechanism, such as a drivetrain.
+ *
+ * @param mg The motor group to get the average position for
+ *
+ * @return The average aligned position of the motors that could be read, or
+ * PROS_ERR_F if none could
+ */
+double rgt_mg_get_aligned_average_position(const Rgt_Motor_Group *mg);
+
+/**
+ * @brief Combines per-motor readings into a single value using a policy
+ *
+ * @details This is the function the rgt_mg_get_aggregate_* functions use to
+ * combine their readings. It can also be used on readings from
+ * rgt_mg_snapshot or the other rgt_mg_get_* functions.
+ *
+ * @param values The reading for each motor
+ * @param count The number of readings
+ * @param policy How to combine the readings, see Rgt_MG_Aggregation
+ * @param threshold For RGT_MG_AGGREGATE_EXCLUDE_OUTLIERS, the largest
+ * difference from the median a reading can have and still be used. Ignored by
+ * the other policies.
+ * @param valid If not NULL, bit i is set to 1 if reading i was used in the
+ * result, and 0 if it was left out
+ *
+ * @return The combined value, or PROS_ERR_F if there were no usable readings
+ */
+double rgt_mg_aggregate(const double *values, uint8_t count,
+                        Rgt_MG_Aggregation policy, double threshold,
+                        uint32_t *valid);
+
+/**
+ * @brief Returns the position of the group, combined using a policy
+ *
+ * @details Reads the aligned position of each motor (see
+ * rgt_mg_get_aligned_positions) and combines them with rgt_mg_aggregate. With
+ * a median or outlier-rejecting policy, a single unplugged or slipping motor
+ * costs some accuracy instead of corrupting the result.
+ *
+ * @param mg The motor group to get the position for
+ * @param policy How to combine the readings, see Rgt_MG_Aggregation
+ * @param threshold The outlier threshold, in the motors' encoder units, for
+ * RGT_MG_AGGREGATE_EXCLUDE_OUTLIERS
+ * @param valid If not NULL, set to a bitmask of the motors that were used
+ *
+ * @return The combined position, or PROS_ERR_F if no motor could be read
+ */
+double rgt_mg_get_aggregate_position(const Rgt_Motor_Group *mg,
+                                     Rgt_MG_Aggregation policy,
+                                     double threshold, uint32_t *valid);
 
 /**
  * @brief Returns the average velocity for all the motors in the group
@@ -263,7 +715,7 @@ void rgt_mg_get_positions(const rgt_motor_group mg, double *positions);
  *
  * @return The average velocity for all the motors in the group
  */
-double rgt_mg_get_average_velocity(const rgt_motor_group mg);
+double rgt_mg_get_average_velocity(const Rgt_Motor_Group *mg);
 
 /**
  * @brief Retrieves the velocity for each motor in the group
@@ -277,7 +729,48 @@ double rgt_mg_get_average_velocity(const rgt_motor_group mg);
  * @param velocities An array to write all the motor velocities to. Should
  * be initialized to the length value from the motor group.
  */
-void rgt_mg_get_velocities(const rgt_motor_group mg, double *velocities);
+void rgt_mg_get_velocities(const Rgt_Motor_Group *mg, double *velocities);
+
+/**
+ * @brief Returns the velocity of the group, combined using a policy
+ *
+ * @details Reads the velocity of each motor and combines them with
+ * rgt_mg_aggregate. See rgt_mg_get_aggregate_position.
+ *
+ * @param mg The motor group to get the velocity for
+ * @param policy How to combine the readings, see Rgt_MG_Aggregation
+ * @param threshold The outlier threshold, in RPM, for
+ * RGT_MG_AGGREGATE_EXCLUDE_OUTLIERS
+ * @param valid If not NULL, set to a bitmask of the motors that were used
+ *
+ * @return The combined velocity, or PROS_ERR_F if no motor could be read
+ */
+double rgt_mg_get_aggregate_velocity(const Rgt_Motor_Group *mg,
+                                     Rgt_MG_Aggregation policy,
+                                     double threshold, uint32_t *valid);
+
+/**
+ * @brief Reads all the telemetry for every motor in the group in a single pass
+ *
+ * @details This function walks the motor group once, reading the position,
+ * velocity, current draw, voltage, temperature, and timestamped raw position of
+ * each motor using the corresponding PROS motor_get_* functions. It then
+ * computes the group averages from those same readings.
+ *
+ * Controllers and loggers that need several values should use this instead of
+ * calling the rgt_mg_get_average_* functions one after another, as each of
+ * those walks the whole group again and the readings no longer line up.
+ *
+ * @param mg The motor group to read
+ * @param snapshot A caller-owned snapshot struct to write the readings to
+ *
+ * @return 1 if all motor reads were successful, PROS_ERR otherwise. The
+ * snapshot is still filled in if a read fails, with the failed value set to
+ * PROS_ERR or PROS_ERR_F by PROS. Failed values are left out of the averages
+ * and max_temperature, which are PROS_ERR_F if no motor could be read.
+ */
+int32_t rgt_mg_snapshot(const Rgt_Motor_Group *mg,
+                        Rgt_Motor_Group_Snapshot *snapshot);
 
 /*******************************************************************************
  *                           Configuration Functions *
@@ -297,7 +790,7 @@ void rgt_mg_get_velocities(const rgt_motor_group mg, double *velocities);
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_set_brake_mode(const rgt_motor_group mg,
+int32_t rgt_mg_set_brake_mode(const Rgt_Motor_Group *mg,
                               const motor_brake_mode_e_t brake_mode);
 
 /**
@@ -315,7 +808,7 @@ int32_t rgt_mg_set_brake_mode(const rgt_motor_group mg,
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_set_encoder_units(const rgt_motor_group mg,
+int32_t rgt_mg_set_encoder_units(const Rgt_Motor_Group *mg,
                                  const motor_encoder_units_e_t encoder_units);
 
 /**
@@ -336,7 +829,7 @@ int32_t rgt_mg_set_encoder_units(const rgt_motor_group mg,
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_set_gearing(const rgt_motor_group mg,
+int32_t rgt_mg_set_gearing(const Rgt_Motor_Group *mg,
                            const motor_gearset_e_t gearing);
 
 /**
@@ -351,7 +844,7 @@ int32_t rgt_mg_set_gearing(const rgt_motor_group mg,
  * @return 1 if all motor operations were successful, PROS_ERR otherwise.
  * Basically just returns what motor_move does.
  */
-int32_t rgt_mg_reset_positions(const rgt_motor_group mg);
+int32_t rgt_mg_reset_positions(const Rgt_Motor_Group *mg);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,150 @@
+/**
+ * @file scheduler.h
+ *
+ * @brief Runs many Ringtail controllers in a single task
+ *
+ * @details rgt_controller_create gives every controller its own PROS task,
+ * each with its own stack, and the kernel has to switch to each of them every
+ * cycle. The scheduler instead runs every registered controller from one task
+ * at a fixed rate. Controllers can run at a fraction of that rate with a
+ * divider, and always run in the order they were registered, so the order of
+ * motor commands is the same every cycle.
+ */
+
+#ifndef RINGTAIL_SCHEDULER_H_
+#define RINGTAIL_SCHEDULER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ringtail/controller.h"
+
+#include "pros/rtos.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The most controllers that can be registered with the scheduler
+#define RGT_SCHEDULER_MAX_CONTROLLERS 16
+
+/**
+ * A rough cost (us) of waking a PROS task up: a context switch in and out,
+ * and the kernel's bookkeeping for the delay. Only used to estimate the time
+ * the scheduler saves, so define it to a measurement of your own if you have
+ * one.
+ */
+#ifndef RGT_SCHEDULER_WAKEUP_TIME
+#define RGT_SCHEDULER_WAKEUP_TIME 5
+#endif
+
+/**
+ * Timing and savings reported by the scheduler. The savings compare the
+ * scheduler to giving each registered controller its own task with
+ * TASK_STACK_DEPTH_DEFAULT, running at the same rate.
+ */
+typedef struct {
+	uint8_t controllers; // Controllers registered
+	uint32_t cycles;     // Scheduler cycles run
+	// Time (us) the scheduler spent running controllers in a cycle
+	uint32_t last_busy_time;
+	uint32_t max_busy_time;
+	double mean_busy_time;
+	// Time (us) of each cycle the scheduler spent on itself, outside the
+	// controllers - what the scheduler costs per tick
+	uint32_t last_overhead_time;
+	double mean_overhead_time;
+	// Tasks and stack memory (bytes) saved. Negative if the scheduler's stack
+	// is bigger than the tasks it replaces
+	int32_t tasks_saved;
+	int32_t stack_bytes_saved;
+	// Task wakeups (each a context switch in and out) saved per second
+	int32_t wakeups_saved;
+	// Estimated CPU time (us) saved per second: the wakeups saved at
+	// RGT_SCHEDULER_WAKEUP_TIME each, less the scheduler's measured overhead
+	int32_t time_saved;
+} Rgt_Scheduler_Stats;
+
+/**
+ * @brief Registers a controller with the scheduler
+ *
+ * @details The controller runs once every divider scheduler cycles, using
+ * rgt_controller_step. Controllers that run in the same cycle run in the order
+ * they were registered. The controller is stored by pointer, so it must
+ * outlive the scheduler (i.e. be static), and it must not also be started with
+ * rgt_controller_create.
+ *
+ * Controllers can be registered before or after the scheduler is started. The
+ * scheduler sets the controller's period to its own period times divider, so
+ * the controller's timing statistics work the same as for a controller task.
+ *
+ * @param i The controller to run
+ * @param divider How many scheduler cycles there are between runs of this
+ * controller - 1 runs it every cycle
+ *
+ * @return true if the controller was registered, false if divider is 0, the
+ * controller is already registered, or RGT_SCHEDULER_MAX_CONTROLLERS
+ * controllers are
+ */
+bool rgt_scheduler_add(Rgt_Controller_Info *i, uint32_t divider);
+
+/**
+ * @brief Registers a coupled controller with the scheduler
+ *
+ * @details The same as rgt_scheduler_add, for a Rgt_Coupled_Controller. Both
+ * kinds of controller share the same order.
+ */
+bool rgt_scheduler_add_coupled(Rgt_Coupled_Controller *c, uint32_t divider);
+
+/**
+ * @brief Pauses or resumes a registered controller
+ *
+ * @details A paused controller keeps its place in the order, but isn't run and
+ * doesn't move its motors, like a suspended controller task.
+ *
+ * @param controller The controller, as passed to rgt_scheduler_add or
+ * rgt_scheduler_add_coupled
+ * @param enabled Whether the controller should run
+ *
+ * @return true if the controller is registered, false otherwise
+ */
+bool rgt_scheduler_set_enabled(const void *controller, bool enabled);
+
+/**
+ * @brief Starts the scheduler as a PROS task
+ *
+ * @details The scheduler runs its cycles on a fixed schedule with
+ * task_delay_until. Calling this more than once returns the existing task.
+ *
+ * @param period The time between scheduler cycles, in ms
+ * @param priority The task priority - the same one the controllers would have
+ * had as their own tasks
+ * @param stack_depth The task's stack depth. It only needs to be big enough for
+ * the deepest controller, not for all of them.
+ *
+ * @return The scheduler task
+ */
+task_t rgt_scheduler_start(uint32_t period, uint8_t priority,
+                           uint16_t stack_depth);
+
+/**
+ * @brief Runs one scheduler cycle
+ *
+ * @details This is the body of the scheduler task. Call it from a task of your
+ * own instead of starting the scheduler, not as well as.
+ */
+void rgt_scheduler_step(void);
+
+/**
+ * @brief Returns the scheduler's timing and savings
+ *
+ * @details The scheduler task publishes these once a cycle without locking.
+ * Every value comes from the same cycle.
+ */
+Rgt_Scheduler_Stats rgt_scheduler_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGTAIL_SCHEDULER_H_ */
@@ -10,14 +10,14 @@
  * @brief Function implementations and local variables for controlling the intake
  */ 
  
-static rgt_motor_group arm_motors = {-1, 2};
+static Rgt_Motor_Group arm_motors = RGT_MOTOR_GROUP(-1, 2);
 
  void arm_up(){
-    rgt_mg_move(arm_motors, 127);
+    rgt_mg_move(&arm_motors, 127);
  }
 
  void arm_down(){
-    rgt_mg_move(arm_motors, -127);
+    rgt_mg_move(&arm_motors, -127);
  }
 
  void arm_opcontrol(controller_digital_e_t up_button,
@@ -28,7 +28,7 @@ static rgt_motor_group arm_motors = {-1, 2};
         arm_down();
      } else {  
         // Turn off if no inputs
-        rgt_mg_move(arm_motors, 0);
+        rgt_mg_move(&arm_motors, 0);
     }
 
 }
\ No newline at end of file
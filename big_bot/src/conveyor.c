@@ -2,7 +2,12 @@
 
 #include "pros/misc.h"
 
+#include "ringtail/controller.h"
 #include "ringtail/motor_group.h"
+#include "ringtail/reference_controllers.h"
+#include "ringtail/scheduler.h"
+
+#include <stddef.h>
 
 /**
  * @file conveyor.c
@@ -11,11 +16,51 @@
  * conveyor
  */
 
-static rgt_motor_group conveyor_run = {-1};
+static Rgt_Motor_Group conveyor_run = RGT_MOTOR_GROUP(-1);
+
+/**
+ * Ringtail controller variables for the conveyor. A take back half controller
+ * holds the conveyor's speed, so it moves rings at the same rate whether it is
+ * empty or full.
+ */
+static Rgt_TBH conveyor_tbh;
+static Rgt_Controller_Info conveyor_controller;
+
+// The speed the conveyor runs at, in RPM - 80% of the motor's 200 RPM free
+// speed, leaving headroom to hold it under load. Before the velocity
+// controller, the conveyor ran at full voltage, so loaded it was slower than
+// this and empty it was faster
+static const double CONVEYOR_VELOCITY = 160;
+
+// The voltage per RPM that holds a speed with no load - 12 V over the free
+// speed - and the gain that ramps up to it
+static const double GUESS_GAIN = 12000.0 / 200;
+static const double KH = 3;
 
-void conveyor_up(void) { rgt_mg_move(conveyor_run, 127); }
+void conveyor_init(void) {
+	// The velocity target and guess are for a green cartridge
+	rgt_mg_set_gearing(&conveyor_run, E_MOTOR_GEARSET_18);
+	conveyor_tbh = rgt_tbh_init(&conveyor_run, KH, GUESS_GAIN);
+	// Motor velocity readings jump around by a few RPM from cycle to cycle
+	conveyor_tbh.velocity_filter = 2;
+	conveyor_controller = rgt_controller_info_init_ctx(
+	    &conveyor_run, rgt_tbh_get_sensor_data, &conveyor_tbh,
+	    rgt_tbh_controller, &conveyor_tbh, NULL,
+	    conveyor_tbh.at_speed_threshold, 5);
+
+	// The conveyor runs every cycle of Ringtail's controller scheduler
+	rgt_scheduler_add(&conveyor_controller, 1);
+}
+
+void conveyor_up(void) {
+	rgt_controller_set_target(&conveyor_controller, CONVEYOR_VELOCITY);
+}
+
+void conveyor_down(void) {
+	rgt_controller_set_target(&conveyor_controller, -CONVEYOR_VELOCITY);
+}
 
-void conveyor_down(void) { rgt_mg_move(conveyor_run, -127); }
+bool conveyor_at_speed(void) { return rgt_tbh_at_speed(&conveyor_tbh); }
 
 void conveyor_opcontrol(controller_digital_e_t up_button,
                         controller_digital_e_t down_button) {
@@ -24,7 +69,7 @@ void conveyor_opcontrol(controller_digital_e_t up_button,
 	} else if (controller_get_digital(E_CONTROLLER_MASTER, down_button)) {
 		conveyor_down();
 	} else {
-		// Turn off if no inputs
-		rgt_mg_move(conveyor_run, 0);
+		// Turn off if no inputs - the controller outputs 0 for a target of 0
+		rgt_controller_set_target(&conveyor_controller, 0);
 	}
 }
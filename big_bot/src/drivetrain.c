@@ -4,9 +4,13 @@
 #include "pros/rtos.h"
 
 #include "ringtail/controller.h"
+#include "ringtail/health.h"
+#include "ringtail/motion_profile.h"
 #include "ringtail/motor_group.h"
 #include "ringtail/reference_controllers.h"
+#include "ringtail/scheduler.h"
 #include <math.h>
+#include <stddef.h>
 
 /**
  * @file drivetrain.c
@@ -14,28 +18,51 @@
  * @brief Function implementations and local variables for the drivetrain
  */
 
-// Motor groups for each side of the drivetrain
-static rgt_motor_group right_motors = {18, 19, 20};
-static rgt_motor_group left_motors = {-8, -9, -10};
+// Derating policy for the drivetrain motors, applied by Ringtail's health task
+static const Rgt_Health_Policy drive_health_policy = RGT_HEALTH_POLICY_DEFAULT;
 
 /**
- * Ringtail task variables and function prototypes for each side of the
- * drivetrain
+ * Output shaping for each side. Current balancing keeps one motor from
+ * overheating first. While driving from the sticks, the sides are also slew
+ * limited (see drivetrain_suspend_pid_tasks).
  */
-static mutex_t left_mutex;
-static mutex_t right_mutex;
+static Rgt_MG_Output left_output = {.balance_current = true,
+                                    .balance_band = 150,
+                                    .balance_gain = 0.5,
+                                    .balance_max_trim = 1000};
+static Rgt_MG_Output right_output = {.balance_current = true,
+                                     .balance_band = 150,
+                                     .balance_gain = 0.5,
+                                     .balance_max_trim = 1000};
 
-static task_t left_pid_task;
-static task_t right_pid_task;
-
-static Rgt_Controller_Info left_pid_info;
-static Rgt_Controller_Info right_pid_info;
+/**
+ * The slew limit while driving from the sticks: 0 to full power in 200 ms at
+ * the 20 ms opcontrol loop, so full-stick reversals don't slip the wheels or
+ * tip the robot. The controller's output already follows a jerk-limited motion
+ * profile, so it isn't slew limited - at its 10 ms period the same limit would
+ * hold its corrections back.
+ */
+static const int32_t OPCONTROL_MAX_SLEW = 1200;
 
-double left_mg_get_pos(void);
-double right_mg_get_pos(void);
+/**
+ * Motor groups for each side of the drivetrain. The controller and opcontrol
+ * share them, taking turns: opcontrol suspends the controller before it drives
+ * the motors. Only one group per set of ports means the command cache and the
+ * output state each see every command sent to the motors.
+ */
+static Rgt_Motor_Group right_motors =
+    RGT_MOTOR_GROUP_WITH_OUTPUT(&right_output, 18, 19, 20);
+static Rgt_Motor_Group left_motors =
+    RGT_MOTOR_GROUP_WITH_OUTPUT(&left_output, -8, -9, -10);
 
-double left_mg_controller(double target, double current, bool reset);
-double right_mg_controller(double target, double current, bool reset);
+/**
+ * Ringtail controller variables and function prototypes for the drivetrain. One
+ * coupled controller drives both sides from the drive's distance and heading,
+ * with each move's targets following a motion profile.
+ */
+static Rgt_Tank_Drive drive;
+static Rgt_Profiled_Coupled_Controller drive_profile;
+static Rgt_Coupled_Controller drive_controller;
 
 /**
  * Gear Ratio on the drivetrain -  defined as:
@@ -50,127 +77,121 @@ static const double BASE_WIDTH = 11.375;
 /**
  * Motor encoder position threshold within which the drivetrain's PID
  * controllers begin accumulating error i.e. the I part of the PID becomes
- * relevant.
+ * relevant. It applies to errors in both directions.
  */
 static const double ERROR_ACCUMULATION_THRESH = 50;
 
+/**
+ * Motor encoder position difference from the median of a drivetrain side past
+ * which a motor's reading is ignored, e.g. if it is unplugged or its pinion
+ * slips.
+ */
+static const double POSITION_OUTLIER_THRESH = 90;
+
+/**
+ * Motion profile limits for drive moves and turns, in wheel degrees - about 40
+ * in/s top speed, reached in half a second. Limiting the jerk as well keeps the
+ * wheels from slipping as the acceleration comes on.
+ */
+static const Rgt_Profile_Limits PROFILE_LIMITS = {
+    .max_velocity = 1400, .max_acceleration = 4000, .max_jerk = 24000};
+
+/**
+ * Feedforward for both axes, in mV per wheel degree (per second, per second
+ * squared). kV is 12 V over the wheels' free speed of 2160 deg/s, so the PID
+ * only has to correct the drive's error from the profile, not push it along.
+ */
+static const Rgt_Feedforward FEEDFORWARD = {.kS = 500, .kV = 5.5, .kA = 0.6};
+
 void drivetrain_init(void) {
-	left_mutex = mutex_create();
-	right_mutex = mutex_create();
-
-	left_pid_info = rgt_controller_info_init(
-	    left_motors, left_mg_get_pos, left_mg_controller, left_mutex, 5.0, 20);
-	right_pid_info =
-	    rgt_controller_info_init(right_motors, right_mg_get_pos,
-	                             right_mg_controller, right_mutex, 5.0, 20);
-
-	left_pid_task = rgt_controller_create(&left_pid_info, TASK_PRIORITY_DEFAULT,
-	                                      TASK_STACK_DEPTH_DEFAULT,
-	                                      "Drive Left Controller");
-	right_pid_task = rgt_controller_create(
-	    &right_pid_info, TASK_PRIORITY_DEFAULT, TASK_STACK_DEPTH_DEFAULT,
-	    "Drive Right Controller");
+	rgt_health_register(&left_motors, &drive_health_policy);
+	rgt_health_register(&right_motors, &drive_health_policy);
+
+	drive = (Rgt_Tank_Drive){
+	    .left = &left_motors,
+	    .right = &right_motors,
+	    // Accounts for the 5:3 gear ratio from motor to wheel
+	    .scale = GEAR_RATIO,
+	    // Ignores outlier motors
+	    .aggregation = RGT_MG_AGGREGATE_EXCLUDE_OUTLIERS,
+	    .aggregation_threshold = POSITION_OUTLIER_THRESH,
+	    .get_heading = NULL,
+	    .distance_pid = rgt_pid_init(20, 2, 5),
+	    .heading_pid = rgt_pid_init(20, 2, 5),
+	    .feedforward = drive_profile.feedforward_voltages,
+	};
+	// Only accumulate error near the target, and drop it once the target is
+	// crossed so it doesn't push the drive past it. The derivative is of the
+	// filtered encoder readings, so new targets and encoder noise don't kick
+	// the output, and is scaled by the measured loop period
+	Rgt_PID *pids[] = {&drive.distance_pid, &drive.heading_pid};
+	for (uint8_t a = 0; a < 2; a++) {
+		pids[a]->integral_zone = ERROR_ACCUMULATION_THRESH;
+		pids[a]->reset_on_sign_change = true;
+		pids[a]->derivative_on_measurement = true;
+		pids[a]->derivative_filter = 2;
+		pids[a]->nominal_period = RGT_CONTROLLER_DEFAULT_PERIOD;
+	}
+
+	const Rgt_Motor_Group *const sides[] = {&left_motors, &right_motors};
+	const double settle_thresholds[] = {5.0, 5.0};
+	const Rgt_Profile_Limits profile_limits[] = {PROFILE_LIMITS,
+	                                             PROFILE_LIMITS};
+	const Rgt_Feedforward feedforward[] = {FEEDFORWARD, FEEDFORWARD};
+	drive_profile = rgt_profiled_coupled_controller_init(
+	    profile_limits, 2, rgt_tank_calculate_voltages, &drive, feedforward);
+	drive_controller = rgt_coupled_controller_init(
+	    sides, 2, 2, rgt_tank_get_sensor_data, &drive,
+	    rgt_profiled_coupled_controller, &drive_profile, settle_thresholds,
+	    20);
+
+	// The drive runs every cycle of Ringtail's controller scheduler
+	rgt_scheduler_add_coupled(&drive_controller, 1);
 }
 
 void drivetrain_opcontrol(controller_analog_e_t left,
                           controller_analog_e_t right) {
-	rgt_mg_move(left_motors, controller_get_analog(E_CONTROLLER_MASTER, left));
-	rgt_mg_move(right_motors,
+	rgt_mg_move(&left_motors, controller_get_analog(E_CONTROLLER_MASTER, left));
+	rgt_mg_move(&right_motors,
 	            controller_get_analog(E_CONTROLLER_MASTER, right));
 }
 
 void drivetrain_move_straight(double inches) {
 	double target = inches * WHEEL_DIAMETER / 2 * 180 / M_PI;
-	rgt_controller_set_target(&left_pid_info, target);
-	rgt_controller_set_target(&right_pid_info, target);
+	rgt_coupled_controller_set_targets(&drive_controller,
+	                                   (const double[]){target, 0});
+	// Clear at_target so waits are for the new targets
+	rgt_coupled_controller_reset(&drive_controller);
 }
 
 void drivetrain_turn_angle(double angle) {
 	double inches = angle * M_PI / 180 * BASE_WIDTH / 2;
 	double target = inches * WHEEL_DIAMETER / 2 * 180 / M_PI;
-	rgt_controller_set_target(&left_pid_info, target);
-	rgt_controller_set_target(&right_pid_info, -target);
+	// The left side drives to target and the right side to -target
+	rgt_coupled_controller_set_targets(&drive_controller,
+	                                   (const double[]){0, target});
+	rgt_coupled_controller_reset(&drive_controller);
 }
 
-void drivetrain_wait_until_at_target(uint32_t timeout) {
-	while (!rgt_controller_at_target(&right_pid_info) ||
-	       !rgt_controller_at_target(&left_pid_info)) {
-		delay(10);
-	}
-	delay(timeout);
-}
-
-double left_mg_get_pos(void) {
-	// Return average motor encoder position, accounting for 5:3 gear ratio from
-	// motor to wheel
-	return rgt_mg_get_average_position(left_motors) * GEAR_RATIO;
-}
-double right_mg_get_pos(void) {
-	// Return average motor encoder position, accounting for 5:3 gear ratio from
-	// motor to wheel
-	return rgt_mg_get_average_position(right_motors) * GEAR_RATIO;
+bool drivetrain_wait_until_at_target(uint32_t timeout) {
+	return rgt_coupled_controller_wait_settled(&drive_controller, timeout,
+	                                           NULL);
 }
 
-double left_mg_controller(double target, double current, bool reset) {
-	static double integral, prev_error = 0;
-
-	bool clear_integral = false;
-
-	double error = target - current;
-
-	if (error > ERROR_ACCUMULATION_THRESH)
-		clear_integral = true;
-
-	if (reset) {
-		prev_error = 0;
-		clear_integral = true;
-	}
-
-	double voltage =
-	    pid(error, 20, 2, 5, &integral, prev_error, clear_integral);
-
-	prev_error = error;
-
-	return voltage;
-}
-
-double right_mg_controller(double target, double current, bool reset) {
-	static double integral, prev_error = 0;
-
-	bool clear_integral = false;
-
-	double error = target - current;
-
-	if (error > ERROR_ACCUMULATION_THRESH)
-		clear_integral = true;
-
-	if (reset) {
-		prev_error = 0;
-		clear_integral = true;
-	}
-
-	double voltage =
-	    pid(error, 20, 2, 5, &integral, prev_error, clear_integral);
-
-	prev_error = error;
-
-	return voltage;
-}
-
-// Suspend the drivetrain PID tasks
+// Suspend the drivetrain PID controller, handing the motors to opcontrol
 void drivetrain_suspend_pid_tasks(void) {
-	task_suspend(left_pid_task);
-	task_suspend(right_pid_task);
+	rgt_scheduler_set_enabled(&drive_controller, false);
+	left_output.max_slew = OPCONTROL_MAX_SLEW;
+	right_output.max_slew = OPCONTROL_MAX_SLEW;
 }
 
-// Resume the drivetrain PID tasks
+// Resume the drivetrain PID controller, taking the motors back from opcontrol
 void drivetrain_resume_pid_tasks(void) {
-	task_resume(left_pid_task);
-	task_resume(right_pid_task);
+	left_output.max_slew = 0;
+	right_output.max_slew = 0;
+	rgt_scheduler_set_enabled(&drive_controller, true);
 }
 
-// Delete the drivetrain PID tasks
-void drivetrain_delete_pid_tasks(void) {
-	task_delete(left_pid_task);
-	task_delete(right_pid_task);
-}
+// Stop the drivetrain PID controller - the scheduler keeps its slot, so this
+// is the same as suspending it
+void drivetrain_delete_pid_tasks(void) { drivetrain_suspend_pid_tasks(); }
@@ -11,11 +11,11 @@
  * intake
  */
 
-static rgt_motor_group intake_motors = {2, 4};
+static Rgt_Motor_Group intake_motors = RGT_MOTOR_GROUP(2, 4);
 
-void intake_in() { rgt_mg_move(intake_motors, 127); }
+void intake_in() { rgt_mg_move(&intake_motors, 127); }
 
-void intake_out() { rgt_mg_move(intake_motors, -127); }
+void intake_out() { rgt_mg_move(&intake_motors, -127); }
 
 void intake_opcontrol(controller_digital_e_t in_button,
                       controller_digital_e_t out_button) {
@@ -25,7 +25,7 @@ void intake_opcontrol(controller_digital_e_t in_button,
 		intake_out();
 	} else {
 		// Turn off if no inputs
-		rgt_mg_move(intake_motors, 0);
+		rgt_mg_move(&intake_motors, 0);
 		// rgt_mg_move(intake_pivot, 0);
 	}
 }
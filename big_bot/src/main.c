@@ -5,6 +5,10 @@
 #include "intake.h"
 #include "piston.h"
 #include "pros/misc.h"
+#include "ringtail/health.h"
+#include "ringtail/motor_group.h"
+#include "ringtail/reference_controllers.h"
+#include "ringtail/scheduler.h"
 
 /**
  * Runs initialization code. This occurs as soon as the program is started.
@@ -12,7 +16,21 @@
  * All other competition modes are blocked by initialize; it is recommended
  * to keep execution time for this mode under a few seconds.
  */
-void initialize() { piston_init(); }
+void initialize() {
+	// Skip repeated identical motor commands from the opcontrol loop, but
+	// re-send them every 100 ms in case a motor reconnected
+	rgt_mg_command_cache_enable(100);
+	// Keep motor outputs consistent as the battery sags during a match
+	rgt_mg_set_battery_compensation(true);
+	// Watch motor temperatures for any groups registered by the subsystems
+	rgt_health_start(100);
+	// Run the controllers registered by the subsystems every 10 ms, all in one
+	// task
+	rgt_scheduler_start(10, TASK_PRIORITY_DEFAULT, TASK_STACK_DEPTH_DEFAULT);
+	drivetrain_init();
+	piston_init();
+	conveyor_init();
+}
 
 /**
  * Runs while the robot is in the disabled state of Field Management System or
@@ -43,7 +61,111 @@ void competition_initialize() {}
  * will be stopped. Re-enabling the robot will restart the task, not re-start it
  * from where it left off.
  */
-void autonomous() {}
+void autonomous() {
+	// The drive controller holds the drivetrain at its target
+	drivetrain_resume_pid_tasks();
+}
+
+#ifdef BENCHMARK_CONTROLLERS
+#include <stdio.h>
+
+#define BENCHMARK_ITERATIONS 10000
+#define BENCHMARK_INPUTS 64
+
+// Keeps the compiler from optimizing away the results
+static volatile double sink_double;
+static volatile float sink_float;
+static volatile rgt_q16_t sink_q16;
+
+/**
+ * Times the double, float, and Q16.16 pid and tbh on the brain with micros(),
+ * and prints the cost per call to the terminal. The same loops as
+ * test/bench_fixed_point.c, for choosing a variant on the V5 itself. Build
+ * with EXTRA_CFLAGS=-DBENCHMARK_CONTROLLERS to run it at the start of
+ * opcontrol.
+ */
+static void benchmark_controllers(void) {
+	static double errors[BENCHMARK_INPUTS];
+	static float errors_f[BENCHMARK_INPUTS];
+	static rgt_q16_t errors_16[BENCHMARK_INPUTS];
+	// The index of the error before each one
+	static int prev[BENCHMARK_INPUTS];
+	for (int k = 0; k < BENCHMARK_INPUTS; k++) {
+		errors[k] = (k * 37 % 61 - 30) * 1.5;
+		errors_f[k] = (float)errors[k];
+		errors_16[k] = rgt_q16_from_double(errors[k]);
+		prev[k] = (k + BENCHMARK_INPUTS - 1) % BENCHMARK_INPUTS;
+	}
+
+	double integral = 0, out = 0;
+	uint64_t start = micros();
+	for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+		int i = k % BENCHMARK_INPUTS;
+		out += pid(errors[i], 20, 0.01, 5, &integral, errors[prev[i]], i == 0);
+	}
+	uint64_t us = micros() - start;
+	sink_double = out;
+
+	float integral_f = 0, out_f = 0;
+	start = micros();
+	for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+		int i = k % BENCHMARK_INPUTS;
+		out_f += pidf(errors_f[i], 20, 0.01f, 5, &integral_f,
+		              errors_f[prev[i]], i == 0);
+	}
+	uint64_t us_f = micros() - start;
+	sink_float = out_f;
+
+	rgt_q16_t integral_16 = 0, out_16 = 0;
+	start = micros();
+	for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+		int i = k % BENCHMARK_INPUTS;
+		out_16 ^= pid_q16(errors_16[i], RGT_Q16(20), RGT_Q16(0.01),
+		                  RGT_Q16(5), &integral_16, errors_16[prev[i]],
+		                  i == 0);
+	}
+	uint64_t us_16 = micros() - start;
+	sink_q16 = out_16;
+
+	printf("pid: double %.3f us, float %.3f us, Q16.16 %.3f us per call\n",
+	       (double)us / BENCHMARK_ITERATIONS,
+	       (double)us_f / BENCHMARK_ITERATIONS,
+	       (double)us_16 / BENCHMARK_ITERATIONS);
+
+	double output = 0, taken = 0;
+	start = micros();
+	for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+		int i = k % BENCHMARK_INPUTS;
+		tbh(errors[i], errors[prev[i]], &output, &taken, 0.75);
+	}
+	us = micros() - start;
+	sink_double = output;
+
+	float output_f = 0, taken_f = 0;
+	start = micros();
+	for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+		int i = k % BENCHMARK_INPUTS;
+		tbhf(errors_f[i], errors_f[prev[i]], &output_f, &taken_f, 0.75f);
+	}
+	us_f = micros() - start;
+	sink_float = output_f;
+
+	rgt_q16_t output_16 = 0, taken_16 = 0;
+	start = micros();
+	for (int k = 0; k < BENCHMARK_ITERATIONS; k++) {
+		int i = k % BENCHMARK_INPUTS;
+		tbh_q16(errors_16[i], errors_16[prev[i]], &output_16, &taken_16,
+		        RGT_Q16(0.75));
+	}
+	us_16 = micros() - start;
+	sink_q16 = output_16;
+
+	printf("tbh: double %.3f us, float %.3f us, Q16.16 %.3f us per call\n",
+	       (double)us / BENCHMARK_ITERATIONS,
+	       (double)us_f / BENCHMARK_ITERATIONS,
+	       (double)us_16 / BENCHMARK_ITERATIONS);
+}
+#endif
 
 /**
  * Runs the operator control code. This function will be started in its own task
@@ -59,6 +181,12 @@ void autonomous() {}
  * task, not resume it from where it left off.
  */
 void opcontrol() {
+#ifdef BENCHMARK_CONTROLLERS
+	benchmark_controllers();
+#endif
+	// The sticks drive the drivetrain directly, so the drive controller must
+	// not also command it
+	drivetrain_suspend_pid_tasks();
 	while (true) {
 		intake_opcontrol(E_CONTROLLER_DIGITAL_R2, E_CONTROLLER_DIGITAL_R1);
 
@@ -0,0 +1,346 @@
+#include "ringtail/motion_profile.h"
+
+#include "ringtail/controller.h"
+#include "ringtail/reference_controllers.h"
+
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file motion_profile.c
+ *
+ * @brief Function implementations for Ringtail's motion profiles
+ */
+
+/*******************************************************************************
+ *                                  Profiles                                   *
+ ******************************************************************************/
+
+Rgt_Motion_Profile rgt_profile_init(double max_velocity,
+                                    double max_acceleration, double max_jerk) {
+	Rgt_Motion_Profile p = {
+	    .limits = {.max_velocity = max_velocity,
+	               .max_acceleration = max_acceleration,
+	               .max_jerk = max_jerk},
+	};
+	rgt_profile_plan(&p, 0, 0);
+	return p;
+}
+
+/**
+ * A change of speed (in the direction of travel) by a jerk phase, a constant
+ * acceleration phase, and another jerk phase. A trapezoidal profile has no jerk
+ * phases.
+ */
+typedef struct {
+	double jerk_time;
+	double accel_time;
+	// The acceleration in the middle phase - negative to slow down
+	double acceleration;
+	double distance;
+} Rgt_Speed_Change;
+
+static Rgt_Speed_Change rgt_profile_speed_change(double from, double to,
+                                                 double a, double j) {
+	Rgt_Speed_Change c = {0, 0, 0, 0};
+	double change = fabs(to - from);
+	if (j > 0 && change * j < a * a) {
+		// Too small a change to reach the acceleration limit
+		c.jerk_time = sqrt(change / j);
+		a = j * c.jerk_time;
+	} else {
+		if (j > 0)
+			c.jerk_time = a / j;
+		c.accel_time = change / a - c.jerk_time;
+	}
+	c.acceleration = to >= from ? a : -a;
+	// The change is symmetric, so its mean velocity is halfway between
+	c.distance = (from + to) / 2 * (2 * c.jerk_time + c.accel_time);
+	return c;
+}
+
+/**
+ * Fills in three phases from a speed change in direction d. Setting the
+ * acceleration at each phase start makes the trapezoidal profile's instant
+ * acceleration changes work too.
+ */
+static void rgt_profile_set_change(double *durations, double *jerks,
+                                   double *accelerations, Rgt_Speed_Change c,
+                                   double j, double d) {
+	double a = d * c.acceleration;
+	double jerk = copysign(j, a);
+	durations[0] = c.jerk_time;
+	durations[1] = c.accel_time;
+	durations[2] = c.jerk_time;
+	jerks[0] = jerk;
+	jerks[1] = 0;
+	jerks[2] = -jerk;
+	accelerations[0] = 0;
+	accelerations[1] = a;
+	accelerations[2] = a;
+}
+
+// The distance it takes to change speed to peak and then slow down to rest
+static double rgt_profile_move_distance(double speed, double peak, double a,
+                                        double j) {
+	return rgt_profile_speed_change(speed, peak, a, j).distance +
+	       rgt_profile_speed_change(peak, 0, a, j).distance;
+}
+
+void rgt_profile_plan(Rgt_Motion_Profile *p, double start, double end) {
+	rgt_profile_plan_from(p, start, 0, end);
+}
+
+void rgt_profile_plan_from(Rgt_Motion_Profile *p, double start,
+                           double velocity, double end) {
+	double v = p->limits.max_velocity;
+	double a = p->limits.max_acceleration;
+	double j = p->limits.max_jerk > 0 ? p->limits.max_jerk : 0;
+
+	double durations[RGT_PROFILE_PHASES] = {0};
+	double jerks[RGT_PROFILE_PHASES] = {0};
+	double accelerations[RGT_PROFILE_PHASES] = {0};
+
+	p->start = start;
+	p->start_velocity = velocity;
+	p->end = end;
+	p->phase = 0;
+
+	// Limits that aren't positive can't move anything (and would divide by 0),
+	// so the move is a step straight to the end
+	if (!(v > 0) || !(a > 0)) {
+		p->start_velocity = 0;
+		velocity = 0;
+		v = 0;
+	}
+
+	double from = start;
+	double speed = fabs(velocity);
+	double d = end >= start ? 1 : -1;
+	// Brake to a stop first if moving away from the end, or too fast to stop by
+	// it, then move from rest
+	double moving = velocity >= 0 ? 1 : -1;
+	if (speed > 0) {
+		Rgt_Speed_Change stop = rgt_profile_speed_change(speed, 0, a, j);
+		if (moving != d || stop.distance > fabs(end - start)) {
+			rgt_profile_set_change(durations, jerks, accelerations, stop, j,
+			                       moving);
+			from = start + moving * stop.distance;
+			speed = 0;
+			d = end >= from ? 1 : -1;
+		}
+	}
+
+	// Peak at max_velocity if the move is long enough, otherwise find the
+	// highest peak that still leaves room to slow down. Peaking at the current
+	// speed always does, since the move didn't need to brake
+	double distance = fabs(end - from);
+	double peak = v;
+	if (v > 0 && rgt_profile_move_distance(speed, v, a, j) > distance) {
+		double low = speed, high = v;
+		for (uint8_t k = 0; k < 60; k++) {
+			double mid = (low + high) / 2;
+			if (rgt_profile_move_distance(speed, mid, a, j) <= distance)
+				low = mid;
+			else
+				high = mid;
+		}
+		peak = low;
+	}
+
+	if (peak > 0) {
+		rgt_profile_set_change(durations + 3, jerks + 3, accelerations + 3,
+		                       rgt_profile_speed_change(speed, peak, a, j), j,
+		                       d);
+		durations[6] =
+		    (distance - rgt_profile_move_distance(speed, peak, a, j)) / peak;
+		rgt_profile_set_change(durations + 7, jerks + 7, accelerations + 7,
+		                       rgt_profile_speed_change(peak, 0, a, j), j, d);
+	}
+
+	Rgt_Profile_State s = {.position = 0, .velocity = velocity};
+	double time = 0;
+	for (uint8_t ph = 0; ph < RGT_PROFILE_PHASES; ph++) {
+		double t = durations[ph];
+		s.acceleration = accelerations[ph];
+		p->phase_start[ph] = s;
+		p->phase_jerk[ph] = jerks[ph];
+		time += t;
+		p->phase_end[ph] = time;
+
+		s.position += s.velocity * t + s.acceleration * t * t / 2 +
+		              jerks[ph] * t * t * t / 6;
+		s.velocity += s.acceleration * t + jerks[ph] * t * t / 2;
+	}
+}
+
+double rgt_profile_duration(const Rgt_Motion_Profile *p) {
+	return p->phase_end[RGT_PROFILE_PHASES - 1];
+}
+
+Rgt_Profile_State rgt_profile_sample(Rgt_Motion_Profile *p, double time) {
+	if (time >= rgt_profile_duration(p))
+		return (Rgt_Profile_State){.position = p->end};
+	if (time <= 0)
+		return (Rgt_Profile_State){.position = p->start,
+		                           .velocity = p->start_velocity};
+
+	// Samples usually move forward, so start from the last sample's phase
+	uint8_t ph = p->phase;
+	if (ph > 0 && time < p->phase_end[ph - 1])
+		ph = 0;
+	while (time >= p->phase_end[ph])
+		ph++;
+	p->phase = ph;
+
+	double t = time - (ph > 0 ? p->phase_end[ph - 1] : 0);
+	Rgt_Profile_State s = p->phase_start[ph];
+	double jerk = p->phase_jerk[ph];
+	return (Rgt_Profile_State){
+	    .position = p->start + s.position + s.velocity * t +
+	                s.acceleration * t * t / 2 + jerk * t * t * t / 6,
+	    .velocity = s.velocity + s.acceleration * t + jerk * t * t / 2,
+	    .acceleration = s.acceleration + jerk * t,
+	};
+}
+
+/*******************************************************************************
+ *                            Profiled Controllers                             *
+ ******************************************************************************/
+
+Rgt_Profile_State rgt_profiled_target_update(Rgt_Profiled_Target *t,
+                                             double target, double current) {
+	uint64_t now = micros();
+	double elapsed = (now - t->start_time) / 1e6;
+
+	if (!t->moving || target != t->target) {
+		Rgt_Profile_State from = {.position = current};
+		// Only a move that's still going continues from its own setpoint, at
+		// the setpoint's velocity
+		if (t->moving && elapsed < rgt_profile_duration(&t->profile))
+			from = rgt_profile_sample(&t->profile, elapsed);
+
+		rgt_profile_plan_from(&t->profile, from.position, from.velocity,
+		                      target);
+		t->target = target;
+		t->start_time = now;
+		t->moving = true;
+		elapsed = 0;
+	}
+
+	return rgt_profile_sample(&t->profile, elapsed);
+}
+
+Rgt_Profiled_Controller rgt_profiled_controller_init(
+    Rgt_Profile_Limits limits,
+    double (*calculate_voltage)(void *, double, double, bool),
+    void *controller_context, const Rgt_Feedforward *feedforward) {
+	return (Rgt_Profiled_Controller){
+	    .target = {.profile = rgt_profile_init(limits.max_velocity,
+	                                           limits.max_acceleration,
+	                                           limits.max_jerk),
+	               .target = 0,
+	               .start_time = 0,
+	               .moving = false},
+	    .calculate_voltage = calculate_voltage,
+	    .controller_context = controller_context,
+	    .feedforward = feedforward != NULL ? *feedforward
+	                                       : (Rgt_Feedforward){0, 0, 0},
+	    .telemetry = {{{0}}, {{0}}},
+	    .telemetry_seq = 0,
+	};
+}
+
+double rgt_profiled_controller(void *controller, double target, double current,
+                               bool reset) {
+	Rgt_Profiled_Controller *c = (Rgt_Profiled_Controller *)controller;
+	Rgt_Profile_State s =
+	    rgt_profiled_target_update(&c->target, target, current);
+	double feedback = c->calculate_voltage(c->controller_context, s.position,
+	                                       current, reset);
+	double feedforward =
+	    rgt_feedforward_calculate(&c->feedforward, s.velocity, s.acceleration);
+
+	// Readers only look at telemetry[telemetry_seq & 1], so the other one is
+	// free
+	uint32_t next = __atomic_load_n(&c->telemetry_seq, __ATOMIC_RELAXED) + 1;
+	c->telemetry[next & 1] = (Rgt_Profiled_Telemetry){
+	    .setpoint = s, .feedforward = feedforward, .feedback = feedback};
+	__atomic_store_n(&c->telemetry_seq, next, __ATOMIC_RELEASE);
+
+	return feedback + feedforward;
+}
+
+Rgt_Profiled_Telemetry
+rgt_profiled_controller_get_telemetry(Rgt_Profiled_Controller *c) {
+	Rgt_Profiled_Telemetry telemetry;
+	uint32_t seq;
+	do {
+		seq = __atomic_load_n(&c->telemetry_seq, __ATOMIC_ACQUIRE);
+		telemetry = c->telemetry[seq & 1];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&c->telemetry_seq, __ATOMIC_RELAXED) != seq);
+	return telemetry;
+}
+
+Rgt_Profiled_Coupled_Controller rgt_profiled_coupled_controller_init(
+    const Rgt_Profile_Limits *limits, uint8_t axis_count,
+    void (*calculate_voltages)(void *, const double *, const double *, bool,
+                               double *),
+    void *controller_context, const Rgt_Feedforward *feedforward) {
+	Rgt_Profiled_Coupled_Controller c = {
+	    .axis_count = axis_count,
+	    .calculate_voltages = calculate_voltages,
+	    .controller_context = controller_context,
+	};
+	// The other fields start zeroed, with no move yet and no feedforward
+	for (uint8_t a = 0; a < axis_count && a < RGT_COUPLED_MAX_AXES; a++) {
+		c.targets[a].profile =
+		    rgt_profile_init(limits[a].max_velocity,
+		                     limits[a].max_acceleration, limits[a].max_jerk);
+		if (feedforward != NULL)
+			c.feedforward[a] = feedforward[a];
+	}
+	return c;
+}
+
+void rgt_profiled_coupled_controller(void *controller, const double *targets,
+                                     const double *values, bool reset,
+                                     double *voltages) {
+	Rgt_Profiled_Coupled_Controller *c =
+	    (Rgt_Profiled_Coupled_Controller *)controller;
+	uint32_t next = __atomic_load_n(&c->telemetry_seq, __ATOMIC_RELAXED) + 1;
+
+	double profiled[RGT_COUPLED_MAX_AXES];
+	for (uint8_t a = 0; a < c->axis_count; a++) {
+		Rgt_Profile_State s =
+		    rgt_profiled_target_update(&c->targets[a], targets[a], values[a]);
+		profiled[a] = s.position;
+		c->feedforward_voltages[a] = rgt_feedforward_calculate(
+		    &c->feedforward[a], s.velocity, s.acceleration);
+		c->telemetry[next & 1][a] = (Rgt_Profiled_Telemetry){
+		    .setpoint = s,
+		    .feedforward = c->feedforward_voltages[a],
+		    .feedback = 0};
+	}
+	__atomic_store_n(&c->telemetry_seq, next, __ATOMIC_RELEASE);
+
+	c->calculate_voltages(c->controller_context, profiled, values, reset,
+	                      voltages);
+}
+
+Rgt_Profiled_Telemetry rgt_profiled_coupled_controller_get_telemetry(
+    Rgt_Profiled_Coupled_Controller *c, uint8_t axis) {
+	Rgt_Profiled_Telemetry telemetry;
+	uint32_t seq;
+	do {
+		seq = __atomic_load_n(&c->telemetry_seq, __ATOMIC_ACQUIRE);
+		telemetry = c->telemetry[seq & 1][axis];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&c->telemetry_seq, __ATOMIC_RELAXED) != seq);
+	return telemetry;
+}
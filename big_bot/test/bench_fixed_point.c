@@ -0,0 +1,109 @@
+#include "test.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file bench_fixed_point.c
+ *
+ * @brief Per-call cost of the double, float, and Q16.16 reference controllers
+ *
+ * @details The host has fast doubles, so the differences here are smaller
+ * than on the V5. Run the same loops on the brain to choose between them.
+ */
+
+#define ITERATIONS 2000000
+#define INPUTS 256
+
+// Keeps the compiler from optimizing away the results
+static volatile double sink_double;
+static volatile float sink_float;
+static volatile rgt_q16_t sink_q16;
+
+static double errors[INPUTS];
+static float errors_f[INPUTS];
+static rgt_q16_t errors_16[INPUTS];
+// The index of the error before each one
+static int prev[INPUTS];
+
+static void bench_pid(void) {
+	double integral = 0, out = 0;
+	double start = test_now_ns();
+	for (int k = 0; k < ITERATIONS; k++) {
+		int i = k % INPUTS;
+		out += pid(errors[i], 20, 0.01, 5, &integral, errors[prev[i]], i == 0);
+	}
+	double ns = (test_now_ns() - start) / ITERATIONS;
+	sink_double = out;
+
+	float integral_f = 0, out_f = 0;
+	start = test_now_ns();
+	for (int k = 0; k < ITERATIONS; k++) {
+		int i = k % INPUTS;
+		out_f += pidf(errors_f[i], 20, 0.01f, 5, &integral_f,
+		              errors_f[prev[i]], i == 0);
+	}
+	double ns_f = (test_now_ns() - start) / ITERATIONS;
+	sink_float = out_f;
+
+	rgt_q16_t integral_16 = 0, out_16 = 0;
+	start = test_now_ns();
+	for (int k = 0; k < ITERATIONS; k++) {
+		int i = k % INPUTS;
+		out_16 ^= pid_q16(errors_16[i], RGT_Q16(20), RGT_Q16(0.01), RGT_Q16(5),
+		                  &integral_16, errors_16[prev[i]], i == 0);
+	}
+	double ns_16 = (test_now_ns() - start) / ITERATIONS;
+	sink_q16 = out_16;
+
+	printf("pid: double %5.2f ns, float %5.2f ns, Q16.16 %5.2f ns per call\n",
+	       ns, ns_f, ns_16);
+}
+
+static void bench_tbh(void) {
+	double output = 0, taken = 0;
+	double start = test_now_ns();
+	for (int k = 0; k < ITERATIONS; k++) {
+		int i = k % INPUTS;
+		tbh(errors[i], errors[prev[i]], &output, &taken, 0.75);
+	}
+	double ns = (test_now_ns() - start) / ITERATIONS;
+	sink_double = output;
+
+	float output_f = 0, taken_f = 0;
+	start = test_now_ns();
+	for (int k = 0; k < ITERATIONS; k++) {
+		int i = k % INPUTS;
+		tbhf(errors_f[i], errors_f[prev[i]], &output_f, &taken_f, 0.75f);
+	}
+	double ns_f = (test_now_ns() - start) / ITERATIONS;
+	sink_float = output_f;
+
+	rgt_q16_t output_16 = 0, taken_16 = 0;
+	start = test_now_ns();
+	for (int k = 0; k < ITERATIONS; k++) {
+		int i = k % INPUTS;
+		tbh_q16(errors_16[i], errors_16[prev[i]], &output_16, &taken_16,
+		        RGT_Q16(0.75));
+	}
+	double ns_16 = (test_now_ns() - start) / ITERATIONS;
+	sink_q16 = output_16;
+
+	printf("tbh: double %5.2f ns, float %5.2f ns, Q16.16 %5.2f ns per call\n",
+	       ns, ns_f, ns_16);
+}
+
+int main(void) {
+	// Errors that change sign now and then, like a controller near its target
+	for (int k = 0; k < INPUTS; k++) {
+		errors[k] = (k * 37 % 101 - 50) * 1.5;
+		errors_f[k] = (float)errors[k];
+		errors_16[k] = rgt_q16_from_double(errors[k]);
+		prev[k] = (k + INPUTS - 1) % INPUTS;
+	}
+	bench_pid();
+	bench_tbh();
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "test.h"
+
+#include "ringtail/motor_group.h"
+
+#include "pros/error.h"
+#include "pros/motors.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file bench_motor_group.c
+ *
+ * @brief Per-call overhead of the rgt_mg_* functions and the command cache
+ *
+ * @details drivetrain_opcontrol and every mechanism's opcontrol call these
+ * every 20 ms. The stubs' motor calls only touch memory, so the times here are
+ * Ringtail's own overhead - on the brain, each motor call also costs a trip
+ * into the firmware, which is what the command cache saves.
+ */
+
+#define ITERATIONS 2000000
+
+// Keeps the compiler from optimizing away a result
+static volatile double sink;
+
+/**
+ * The original form: scan the zero-terminated array and use signed ports. Like
+ * the originals, these return the status and aren't inlined into the caller -
+ * they lived in their own translation unit. They have none of
+ * rgt_mg_move_voltage's cache or compensation checks, so they are a floor
+ * rather than a like-for-like comparison.
+ */
+__attribute__((noinline)) static int32_t
+legacy_move_voltage(const int8_t *ports, int16_t voltage) {
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < RGT_MG_SIZE && ports[i] != 0; i++) {
+		if (motor_move_voltage(ports[i], voltage) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+__attribute__((noinline)) static double
+legacy_average_position(const int8_t *ports) {
+	double sum = 0;
+	uint8_t count = 0;
+	for (; count < RGT_MG_SIZE && ports[count] != 0; count++)
+		sum += motor_get_position(ports[count]);
+	return sum / count;
+}
+
+// Each loop is timed this many times, keeping the fastest, so a time slice
+// lost to another process doesn't skew one side of a comparison
+#define RUNS 5
+
+// Keeps the fastest of two times, where best starts at 0 for none yet
+static void keep_fastest(double *best, double ns) {
+	if (*best == 0 || ns < *best)
+		*best = ns;
+}
+
+static void bench_group(const char *name, const rgt_motor_group ports) {
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	double start, ns_legacy = 0, ns_rgt = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++)
+			legacy_move_voltage(ports, (int16_t)(k & 0xfff));
+		keep_fastest(&ns_legacy, (test_now_ns() - start) / ITERATIONS);
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++)
+			rgt_mg_move_voltage(&mg, (int16_t)(k & 0xfff));
+		keep_fastest(&ns_rgt, (test_now_ns() - start) / ITERATIONS);
+	}
+	printf("%-8s move_voltage          %6.1f ns/call (array scan %6.1f)\n",
+	       name, ns_rgt, ns_legacy);
+
+	ns_legacy = ns_rgt = 0;
+	for (int run = 0; run < RUNS; run++) {
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++)
+			sink = legacy_average_position(ports);
+		keep_fastest(&ns_legacy, (test_now_ns() - start) / ITERATIONS);
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++)
+			sink = rgt_mg_get_average_position(&mg);
+		keep_fastest(&ns_rgt, (test_now_ns() - start) / ITERATIONS);
+	}
+	printf("%-8s get_average_position  %6.1f ns/call (array scan %6.1f)\n",
+	       name, ns_rgt, ns_legacy);
+}
+
+/**
+ * An opcontrol loop holding the sticks still: the same command every 20 ms,
+ * with and without the command cache
+ */
+static void bench_command_cache(const char *name, const rgt_motor_group ports,
+                                uint32_t refresh_interval) {
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+
+	for (int enabled = 0; enabled <= 1; enabled++) {
+		test_reset();
+		if (enabled)
+			rgt_mg_command_cache_enable(refresh_interval);
+		else
+			rgt_mg_command_cache_disable();
+		rgt_mg_reset_command_stats();
+
+		double start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++) {
+			rgt_mg_move(&mg, 0);
+			test_advance_ms(20);
+		}
+		double ns = (test_now_ns() - start) / ITERATIONS;
+
+		Rgt_MG_Command_Stats stats = rgt_mg_get_command_stats();
+		printf("%-8s cache %-8s        %6.1f ns/call, %u issued, %u "
+		       "suppressed\n",
+		       name, enabled ? "enabled" : "disabled", ns, stats.issued,
+		       stats.suppressed);
+	}
+	rgt_mg_command_cache_disable();
+}
+
+int main(void) {
+	const rgt_motor_group one = {1};
+	const rgt_motor_group three = {-1, 2, -3};
+	const rgt_motor_group six = {-1, 2, -3, 4, -5, 6};
+
+	test_reset();
+	bench_group("1 motor", one);
+	bench_group("3 motors", three);
+	bench_group("6 motors", six);
+
+	bench_command_cache("1 motor", one, 100);
+	bench_command_cache("3 motors", three, 100);
+	bench_command_cache("6 motors", six, 100);
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include "test.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file bench_pid.c
+ *
+ * @brief Per-update cost of the batch PID against one pid call per controller
+ *
+ * @details The baseline is a loop of pid calls, which is what the batch
+ * replaces. On the host, rgt_pid_batch_calculate takes its scalar path, so the
+ * two batch times should match, and any gap to the pid loop is float against
+ * double, not vectorization. Built for the V5, the same comparison times the
+ * NEON path against the pid loop.
+ */
+
+#define ITERATIONS 200000
+
+// Keeps the compiler from optimizing away the outputs
+static volatile float sink;
+static volatile double sink_double;
+
+int main(void) {
+	test_reset();
+
+	for (int count = 4; count <= RGT_PID_BATCH_MAX; count += 4) {
+		Rgt_PID_Batch batch = {0};
+		Rgt_PID pids[RGT_PID_BATCH_MAX];
+		float errors[RGT_PID_BATCH_MAX], outputs[RGT_PID_BATCH_MAX];
+		double errors_double[RGT_PID_BATCH_MAX];
+		double outputs_double[RGT_PID_BATCH_MAX];
+		double integrals[RGT_PID_BATCH_MAX] = {0};
+		double prev_errors[RGT_PID_BATCH_MAX];
+		for (int c = 0; c < count; c++) {
+			rgt_pid_batch_add(&batch, 20, 0.01f, 5);
+			pids[c] = rgt_pid_init(20, 0.01, 5);
+			errors[c] = errors_double[c] = prev_errors[c] = 100 - 10 * c;
+		}
+
+		double start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++) {
+			errors_double[k % count] += 0.5;
+			for (int c = 0; c < count; c++) {
+				outputs_double[c] = pid(errors_double[c], 20, 0.01, 5,
+				                        &integrals[c], prev_errors[c], false);
+				prev_errors[c] = errors_double[c];
+			}
+		}
+		double ns_pid = (test_now_ns() - start) / ITERATIONS;
+		sink_double = outputs_double[0];
+
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++) {
+			errors[k % count] += 0.5f;
+			rgt_pid_batch_calculate(&batch, errors, outputs);
+		}
+		double ns_batch = (test_now_ns() - start) / ITERATIONS;
+		sink = outputs[0];
+
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++) {
+			errors[k % count] += 0.5f;
+			rgt_pid_batch_calculate_scalar(&batch, errors, outputs);
+		}
+		double ns_scalar = (test_now_ns() - start) / ITERATIONS;
+		sink = outputs[0];
+
+		start = test_now_ns();
+		for (int k = 0; k < ITERATIONS; k++) {
+			errors_double[k % count] += 0.5;
+			rgt_pid_calculate_all(pids, errors_double, outputs_double, count);
+		}
+		double ns_all = (test_now_ns() - start) / ITERATIONS;
+		sink_double = outputs_double[0];
+
+		printf("%2d controllers: pid %6.1f ns, batch %6.1f ns (%.2fx), "
+		       "batch scalar %6.1f ns, Rgt_PID %6.1f ns per update\n",
+		       count, ns_pid, ns_batch, ns_pid / ns_batch, ns_scalar, ns_all);
+	}
+	return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file arm_neon.h
+ *
+ * @brief A host stand-in for the NEON intrinsics Ringtail uses
+ *
+ * @details The Makefile builds the *_neon tests with this directory on the
+ * include path and __ARM_NEON defined, so Ringtail's NEON code paths compile
+ * and run on the host. Each intrinsic does its four lanes one at a time in
+ * single precision, so the results can be compared with the scalar code's -
+ * the timings can't. Unlike NEON, the host keeps denormals.
+ */
+
+#ifndef RINGTAIL_TEST_ARM_NEON_H_
+#define RINGTAIL_TEST_ARM_NEON_H_
+
+typedef struct {
+	float v[4];
+} float32x4_t;
+
+static inline float32x4_t vld1q_f32(const float *p) {
+	float32x4_t r;
+	for (int i = 0; i < 4; i++)
+		r.v[i] = p[i];
+	return r;
+}
+
+static inline void vst1q_f32(float *p, float32x4_t a) {
+	for (int i = 0; i < 4; i++)
+		p[i] = a.v[i];
+}
+
+// Defines a lane-wise intrinsic of two vectors, a and b, for lane i
+#define RGT_NEON_BINARY_(name, expr)                                           \
+	static inline float32x4_t name(float32x4_t a, float32x4_t b) {             \
+		float32x4_t r;                                                         \
+		for (int i = 0; i < 4; i++)                                            \
+			r.v[i] = (expr);                                                   \
+		return r;                                                              \
+	}
+
+RGT_NEON_BINARY_(vaddq_f32, a.v[i] + b.v[i])
+RGT_NEON_BINARY_(vsubq_f32, a.v[i] - b.v[i])
+RGT_NEON_BINARY_(vmulq_f32, a.v[i] * b.v[i])
+RGT_NEON_BINARY_(vminq_f32, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+RGT_NEON_BINARY_(vmaxq_f32, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+
+// NEON's multiply-accumulate rounds the product before adding, unlike FMA
+static inline float32x4_t vmlaq_f32(float32x4_t a, float32x4_t b,
+                                    float32x4_t c) {
+	float32x4_t r;
+	for (int i = 0; i < 4; i++) {
+		float product = b.v[i] * c.v[i];
+		r.v[i] = a.v[i] + product;
+	}
+	return r;
+}
+
+static inline float32x4_t vnegq_f32(float32x4_t a) {
+	for (int i = 0; i < 4; i++)
+		a.v[i] = -a.v[i];
+	return a;
+}
+
+#endif /* RINGTAIL_TEST_ARM_NEON_H_ */
@@ -0,0 +1,342 @@
+#include "test.h"
+
+#include "pros/error.h"
+#include "pros/misc.h"
+#include "pros/motors.h"
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @file stubs.c
+ *
+ * @brief A stand-in for the PROS API, so Ringtail can run on the host
+ */
+
+Rgt_Test_Motor test_motors[RGT_MG_SIZE + 1];
+uint32_t test_rumbles = 0;
+uint32_t test_mutex_takes = 0;
+uint32_t test_battery_reads = 0;
+
+static uint64_t clock_us = 0;
+static int32_t battery_voltage = 12800;
+
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+void test_reset(void) {
+	memset(test_motors, 0, sizeof(test_motors));
+	for (uint8_t p = 1; p <= RGT_MG_SIZE; p++) {
+		test_motors[p].temperature = 25;
+		test_motors[p].encoder_units = E_MOTOR_ENCODER_DEGREES;
+		test_motors[p].gearing = E_MOTOR_GEARSET_18;
+		test_motors[p].current_limit = 2500;
+		test_motors[p].voltage_limit = 12000;
+	}
+	test_rumbles = 0;
+	test_mutex_takes = 0;
+	test_battery_reads = 0;
+	test_set_time_us(1000000);
+}
+
+void test_set_battery_voltage(int32_t voltage) {
+	__atomic_store_n(&battery_voltage, voltage, __ATOMIC_RELEASE);
+}
+
+uint64_t test_time_us(void) {
+	return __atomic_load_n(&clock_us, __ATOMIC_ACQUIRE);
+}
+
+void test_set_time_us(uint64_t time) {
+	__atomic_store_n(&clock_us, time, __ATOMIC_RELEASE);
+}
+
+void test_advance_us(uint64_t time) {
+	__atomic_fetch_add(&clock_us, time, __ATOMIC_ACQ_REL);
+}
+
+double test_now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+void test_check(bool passed, const char *file, int line, const char *cond,
+                const char *format, ...) {
+	__atomic_fetch_add(&checks, 1, __ATOMIC_RELAXED);
+	if (passed)
+		return;
+
+	__atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED);
+	va_list args;
+	va_start(args, format);
+	printf("%s:%d: FAILED %s: ", file, line, cond);
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+}
+
+int test_summary(const char *name) {
+	printf("%s: %u checks, %u failed\n", name, checks, failures);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*******************************************************************************
+ *                                   Motors                                    *
+ ******************************************************************************/
+
+// The simulated motor on a port, or NULL for an invalid or unplugged one
+static Rgt_Test_Motor *motor(int8_t port) {
+	int index = abs(port);
+	if (index < 1 || index > RGT_MG_SIZE || test_motors[index].unplugged)
+		return NULL;
+	return &test_motors[index];
+}
+
+// Negative ports read and command the motor reversed, like PROS
+static double direction(int8_t port) { return port < 0 ? -1 : 1; }
+
+double motor_get_position(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? direction(port) * m->position : PROS_ERR_F;
+}
+
+double motor_get_actual_velocity(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? direction(port) * m->velocity : PROS_ERR_F;
+}
+
+int32_t motor_get_raw_position(int8_t port, uint32_t *const timestamp) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL || m->raw_position_fails)
+		return PROS_ERR;
+	*timestamp = m->timestamp;
+	return (int32_t)(direction(port) * m->position);
+}
+
+int32_t motor_get_current_draw(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->current_draw : PROS_ERR;
+}
+
+int32_t motor_get_voltage(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->command : PROS_ERR;
+}
+
+double motor_get_temperature(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->temperature : PROS_ERR_F;
+}
+
+uint32_t motor_get_faults(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->faults : PROS_ERR;
+}
+
+uint32_t motor_get_flags(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->flags : PROS_ERR;
+}
+
+int32_t motor_is_over_temp(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->temperature >= 55 : PROS_ERR;
+}
+
+motor_encoder_units_e_t motor_get_encoder_units(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL)
+		return E_MOTOR_ENCODER_INVALID;
+	m->config_reads++;
+	return m->encoder_units;
+}
+
+motor_gearset_e_t motor_get_gearing(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL)
+		return E_MOTOR_GEARSET_INVALID;
+	m->config_reads++;
+	return m->gearing;
+}
+
+// Records a command to a motor, returning PROS's success or error value
+static int32_t command(int8_t port, int32_t value) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL)
+		return PROS_ERR;
+	m->command = (int32_t)direction(port) * value;
+	m->commands++;
+	return 1;
+}
+
+int32_t motor_move(int8_t port, int32_t voltage) {
+	return command(port, voltage);
+}
+
+int32_t motor_move_voltage(int8_t port, int32_t voltage) {
+	return command(port, voltage);
+}
+
+int32_t motor_move_velocity(int8_t port, int32_t velocity) {
+	return command(port, velocity);
+}
+
+int32_t motor_brake(int8_t port) { return command(port, 0); }
+
+int32_t motor_move_absolute(int8_t port, double position, int32_t velocity) {
+	(void)position;
+	return command(port, velocity);
+}
+
+int32_t motor_move_relative(int8_t port, double position, int32_t velocity) {
+	(void)position;
+	return command(port, velocity);
+}
+
+int32_t motor_modify_profiled_velocity(int8_t port, int32_t velocity) {
+	return command(port, velocity);
+}
+
+int32_t motor_get_current_limit(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->current_limit : PROS_ERR;
+}
+
+int32_t motor_get_voltage_limit(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	return m ? m->voltage_limit : PROS_ERR;
+}
+
+int32_t motor_set_current_limit(int8_t port, const int32_t limit) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL || m->limit_writes_fail)
+		return PROS_ERR;
+	m->current_limit = limit;
+	return 1;
+}
+
+int32_t motor_set_voltage_limit(int8_t port, const int32_t limit) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL || m->limit_writes_fail)
+		return PROS_ERR;
+	m->voltage_limit = limit;
+	return 1;
+}
+
+int32_t motor_set_brake_mode(int8_t port, motor_brake_mode_e_t mode) {
+	(void)mode;
+	return motor(port) ? 1 : PROS_ERR;
+}
+
+int32_t motor_set_encoder_units(int8_t port, motor_encoder_units_e_t units) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL)
+		return PROS_ERR;
+	m->encoder_units = units;
+	return 1;
+}
+
+int32_t motor_set_gearing(int8_t port, motor_gearset_e_t gearing) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL)
+		return PROS_ERR;
+	m->gearing = gearing;
+	return 1;
+}
+
+int32_t motor_tare_position(int8_t port) {
+	Rgt_Test_Motor *m = motor(port);
+	if (m == NULL)
+		return PROS_ERR;
+	m->position = 0;
+	return 1;
+}
+
+/*******************************************************************************
+ *                           Battery and Controller                            *
+ ******************************************************************************/
+
+int32_t battery_get_voltage(void) {
+	__atomic_fetch_add(&test_battery_reads, 1, __ATOMIC_RELAXED);
+	return __atomic_load_n(&battery_voltage, __ATOMIC_ACQUIRE);
+}
+
+int32_t controller_rumble(controller_id_e_t id, const char *rumble_pattern) {
+	(void)id;
+	(void)rumble_pattern;
+	__atomic_fetch_add(&test_rumbles, 1, __ATOMIC_RELAXED);
+	return 1;
+}
+
+/*******************************************************************************
+ *                                    RTOS                                     *
+ ******************************************************************************/
+
+uint64_t micros(void) { return test_time_us(); }
+
+uint32_t millis(void) { return (uint32_t)(test_time_us() / 1000); }
+
+void delay(const uint32_t milliseconds) { test_advance_ms(milliseconds); }
+
+void task_delay(const uint32_t milliseconds) { test_advance_ms(milliseconds); }
+
+void task_delay_until(uint32_t *const prev_time, const uint32_t delta) {
+	*prev_time += delta;
+	if (millis() < *prev_time)
+		test_set_time_us((uint64_t)*prev_time * 1000);
+}
+
+// Tasks never run on their own - tests call the task bodies themselves
+task_t task_create(task_fn_t function, void *const parameters, uint32_t prio,
+                   const uint16_t stack_depth, const char *const name) {
+	(void)function;
+	(void)parameters;
+	(void)prio;
+	(void)stack_depth;
+	(void)name;
+	static int task;
+	return &task;
+}
+
+// Each thread is its own task
+task_t task_get_current(void) {
+	static __thread int task;
+	return &task;
+}
+
+uint32_t task_notify(task_t task) {
+	(void)task;
+	return 1;
+}
+
+// Nothing else runs while a test blocks, so waiting just moves the clock
+uint32_t task_notify_take(bool clear_on_exit, uint32_t timeout) {
+	(void)clear_on_exit;
+	test_advance_ms(timeout < 10 ? timeout : 10);
+	return 0;
+}
+
+mutex_t mutex_create(void) {
+	static int mutex;
+	return &mutex;
+}
+
+bool mutex_take(mutex_t mutex, uint32_t timeout) {
+	(void)mutex;
+	(void)timeout;
+	__atomic_fetch_add(&test_mutex_takes, 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+bool mutex_give(mutex_t mutex) {
+	(void)mutex;
+	return true;
+}
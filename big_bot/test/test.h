@@ -0,0 +1,94 @@
+/**
+ * @file test.h
+ *
+ * @brief Shared helpers for Ringtail's host tests and benchmarks
+ *
+ * @details The tests build Ringtail's sources for the host, linked against the
+ * stand-in PROS API in stubs.c instead of the V5 firmware. The stubs simulate
+ * a motor on every smart port and a clock that only moves when a test moves
+ * it, so every run is deterministic. See the Makefile for how to run them.
+ */
+
+#ifndef RINGTAIL_TEST_H_
+#define RINGTAIL_TEST_H_
+
+#include "ringtail/motor_group.h"
+
+#include "pros/motors.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * A simulated motor. Tests set the readings directly, and the stubs record the
+ * commands sent to it.
+ */
+typedef struct {
+	// Readings, as the PROS motor functions return them for an unreversed port
+	double position;      // In the motor's encoder units
+	double velocity;      // In RPM
+	uint32_t timestamp;   // Time (ms) position was recorded
+	int32_t current_draw; // In mA
+	double temperature;   // In degrees C
+	uint32_t faults;
+	uint32_t flags;
+	motor_encoder_units_e_t encoder_units;
+	motor_gearset_e_t gearing;
+	// Every read and command fails with PROS's error value, like an
+	// unplugged motor
+	bool unplugged;
+	// Only motor_get_raw_position fails
+	bool raw_position_fails;
+	// Only the current and voltage limit writes fail
+	bool limit_writes_fail;
+	// The last voltage (mV) or move command, unreversed, and the limits
+	int32_t command;
+	int32_t current_limit;
+	int32_t voltage_limit;
+	// How many commands were sent, and how many times the encoder units or
+	// gearing were read
+	uint32_t commands;
+	uint32_t config_reads;
+} Rgt_Test_Motor;
+
+// The simulated motors, indexed by port - entry 0 is unused
+extern Rgt_Test_Motor test_motors[RGT_MG_SIZE + 1];
+
+// Counters for the other PROS calls tests check on
+extern uint32_t test_rumbles;
+extern uint32_t test_mutex_takes;
+
+// Counts battery_get_voltage calls
+extern uint32_t test_battery_reads;
+
+// Resets every motor and counter, and sets the clock to 1 s
+void test_reset(void);
+
+// Sets the voltage (mV) battery_get_voltage returns. test_reset leaves it alone
+void test_set_battery_voltage(int32_t voltage);
+
+// The simulated clock. It is safe to move from several threads
+uint64_t test_time_us(void);
+void test_set_time_us(uint64_t time);
+void test_advance_us(uint64_t time);
+#define test_advance_ms(ms) test_advance_us((uint64_t)(ms) * 1000)
+
+// The host's monotonic clock, in ns, for benchmarks
+double test_now_ns(void);
+
+/**
+ * Checks a condition, printing the message and counting a failure if it is
+ * false. Tests keep going after a failure, so one run shows every problem.
+ */
+#define CHECK(cond, ...)                                                       \
+	test_check((cond), __FILE__, __LINE__, #cond, __VA_ARGS__)
+
+void test_check(bool passed, const char *file, int line, const char *cond,
+                const char *format, ...)
+    __attribute__((format(printf, 5, 6)));
+
+// Prints the number of checks and failures, and returns main's exit status
+int test_summary(const char *name);
+
+#endif /* RINGTAIL_TEST_H_ */
@@ -0,0 +1,123 @@
+#include "test.h"
+
+#include "ringtail/autotune.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file test_autotune.c
+ *
+ * @brief Runs the relay autotuner on a simulated mechanism and checks what it
+ * measures against the mechanism's analytic ultimate gain and period
+ */
+
+// The controller's period, and the simulation's step, in ms
+#define PERIOD 5
+#define SUBSTEPS 5
+
+/**
+ * A mechanism driven by voltage: velocity lags the voltage with a time
+ * constant, and the voltage takes a dead time to act, like a motor whose
+ * commands arrive a few packets late. Its transfer function, position over
+ * voltage, is GAIN e^(-DELAY s) / (s (TAU s + 1)).
+ */
+#define GAIN 0.1   // Steady velocity (units/s) per mV
+#define TAU 0.1    // s
+#define DELAY 0.03 // s
+#define DELAY_STEPS 30
+
+typedef struct {
+	double position;
+	double velocity;
+	// The last DELAY of voltages, one per ms
+	double voltages[DELAY_STEPS];
+	int next;
+} Plant;
+
+// Applies a voltage for one controller period
+static void plant_step(Plant *p, double voltage) {
+	for (int s = 0; s < SUBSTEPS; s++) {
+		double acting = p->voltages[p->next];
+		p->voltages[p->next] = voltage;
+		p->next = (p->next + 1) % DELAY_STEPS;
+
+		double dt = PERIOD / 1000.0 / SUBSTEPS;
+		p->velocity += (GAIN * acting - p->velocity) * dt / TAU;
+		p->position += p->velocity * dt;
+	}
+	test_advance_ms(PERIOD);
+}
+
+/**
+ * The plant's ultimate frequency is where its phase reaches -180 degrees:
+ * atan(w TAU) + w DELAY = pi/2. The ultimate gain is 1 / |G| there.
+ */
+static void analytic_ultimate(double *gain, double *period) {
+	double low = 0, high = M_PI / 2 / DELAY;
+	for (int k = 0; k < 60; k++) {
+		double w = (low + high) / 2;
+		if (atan(w * TAU) + w * DELAY < M_PI / 2)
+			low = w;
+		else
+			high = w;
+	}
+	double w = (low + high) / 2;
+	*gain = w * sqrt(1 + w * w * TAU * TAU) / GAIN;
+	*period = 2 * M_PI / w;
+}
+
+// Runs an autotune to the end, returning its state
+static Rgt_Autotune_State run(Rgt_Autotune *a, Plant *p) {
+	for (int k = 0; k < 20000 / PERIOD; k++) {
+		double voltage = rgt_autotune_controller(a, 0, p->position, k == 0);
+		if (rgt_autotune_get_state(a) != RGT_AUTOTUNE_RUNNING)
+			break;
+		plant_step(p, voltage);
+	}
+	return rgt_autotune_get_state(a);
+}
+
+static void test_matches_analytic(void) {
+	test_reset();
+	Plant p = {0};
+	Rgt_Autotune a = rgt_autotune_init(6000, 0, 0, 4, 10000);
+	CHECK(run(&a, &p) == RGT_AUTOTUNE_DONE, "autotune didn't finish");
+
+	Rgt_Autotune_Result result;
+	CHECK(rgt_autotune_get_result(&a, &result), "no result");
+	double ku, tu;
+	analytic_ultimate(&ku, &tu);
+	printf("ultimate gain %.1f (analytic %.1f), period %.3f s (analytic "
+	       "%.3f s)\n",
+	       result.ultimate_gain, ku, result.ultimate_period, tu);
+	// The relay method assumes the oscillation is a sine wave, and this one
+	// isn't quite, so neither number is exact
+	CHECK(fabs(result.ultimate_gain - ku) < 0.2 * ku,
+	      "ultimate gain %g, expected %g", result.ultimate_gain, ku);
+	CHECK(fabs(result.ultimate_period - tu) < 0.1 * tu,
+	      "ultimate period %g, expected %g", result.ultimate_period, tu);
+	CHECK(result.cycles == 4, "measured %d cycles", result.cycles);
+}
+
+static void test_zero_cycles(void) {
+	test_reset();
+	Plant p = {0};
+	Rgt_Autotune a = rgt_autotune_init(6000, 0, 0, 0, 10000);
+	CHECK(a.cycles == 1, "asked for 0 cycles, got %d", a.cycles);
+	CHECK(run(&a, &p) == RGT_AUTOTUNE_DONE, "autotune didn't finish");
+
+	Rgt_Autotune_Result result;
+	rgt_autotune_get_result(&a, &result);
+	CHECK(isfinite(result.ultimate_gain) && result.ultimate_gain > 0 &&
+	          isfinite(result.ultimate_period) && result.ultimate_period > 0,
+	      "one cycle measured gain %g, period %g", result.ultimate_gain,
+	      result.ultimate_period);
+}
+
+int main(void) {
+	test_matches_analytic();
+	test_zero_cycles();
+	return test_summary("test_autotune");
+}
@@ -0,0 +1,180 @@
+#include "test.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file test_bangbang.c
+ *
+ * @brief Runs the Rgt_Bangbang modes on simulated mechanisms
+ */
+
+// The controller's period, in ms
+#define PERIOD 10
+
+// A repeatable pseudo-random value from -range to range
+static double random_value(uint32_t *seed, double range) {
+	*seed = *seed * 1664525 + 1013904223;
+	return ((double)(*seed >> 8) / (1 << 24) * 2 - 1) * range;
+}
+
+/**
+ * A flywheel: its velocity approaches 1 RPM per 10 mV with a time constant of
+ * 1 s, and the sensor reading it has noise of up to 15 RPM.
+ */
+typedef struct {
+	double velocity;
+	uint32_t seed;
+} Flywheel;
+
+static double flywheel_read(Flywheel *f) {
+	return f->velocity + random_value(&f->seed, 15);
+}
+
+static void flywheel_step(Flywheel *f, double voltage) {
+	f->velocity += (voltage / 10 - f->velocity) * PERIOD / 1000.0;
+	test_advance_ms(PERIOD);
+}
+
+// Runs a controller on a fresh flywheel, returning how many times the output
+// changed once the flywheel was within 20 RPM of the target, and its average
+// velocity from then on
+static int count_switches(Rgt_Bangbang *b, bool plain, double *average) {
+	const double target = 600;
+	Flywheel f = {.velocity = 0, .seed = 17};
+	double last = NAN, sum = 0;
+	int switches = 0, samples = 0;
+	bool reached = false;
+	for (int k = 0; k < 1000; k++) {
+		double sensed = flywheel_read(&f);
+		double voltage = plain ? bangbang(target, sensed, 12000, 3000)
+		                       : rgt_bangbang_calculate(b, target, sensed);
+		if (f.velocity >= target - 20)
+			reached = true;
+		if (reached) {
+			if (voltage != last)
+				switches++;
+			sum += f.velocity;
+			samples++;
+		}
+		last = voltage;
+		flywheel_step(&f, voltage);
+	}
+	*average = sum / samples;
+	return switches;
+}
+
+static void test_hysteresis(void) {
+	test_reset();
+	double plain_average, average;
+	int plain = count_switches(NULL, true, &plain_average);
+	Rgt_Bangbang b =
+	    rgt_bangbang_init(RGT_BANGBANG_HYSTERESIS, 12000, 3000, 20);
+	int switches = count_switches(&b, false, &average);
+	printf("hysteresis: %d switches (bangbang %d), average %.1f RPM\n",
+	       switches, plain, average);
+	// Noise alone switches bangbang, but never switches past a band wider
+	// than it - the mechanism has to move there
+	CHECK(switches < plain / 3, "%d switches, bangbang %d", switches, plain);
+	CHECK(fabs(average - 600) < 20, "averaged %g RPM", average);
+
+	// The output only changes once the value is past the band
+	b = rgt_bangbang_init(RGT_BANGBANG_HYSTERESIS, 12000, 3000, 20);
+	const double currents[] = {500, 590, 610, 619, 621, 610, 590, 581, 579};
+	const double expected[] = {12000, 12000, 12000, 12000, 3000,
+	                           3000,  3000,  3000,  12000};
+	for (int k = 0; k < 9; k++) {
+		double voltage = rgt_bangbang_calculate(&b, 600, currents[k]);
+		CHECK(voltage == expected[k], "%g gave %g, expected %g", currents[k],
+		      voltage, expected[k]);
+	}
+	// The first update after a reset has no output to keep
+	rgt_bangbang_controller(&b, 600, 610, true);
+	CHECK(!b.on, "came back on above the target after a reset");
+}
+
+static void test_deadband(void) {
+	test_reset();
+	double average;
+	Rgt_Bangbang b = rgt_bangbang_init(RGT_BANGBANG_DEADBAND, 12000, 3000, 20);
+	b.hold_voltage = 6000;
+	int switches = count_switches(&b, false, &average);
+	printf("deadband: %d switches, average %.1f RPM\n", switches, average);
+	// Holding 6000 mV settles the flywheel right on the target, inside the
+	// band, so the output stops changing
+	CHECK(switches <= 10, "%d switches", switches);
+	CHECK(fabs(average - 600) < 20, "averaged %g RPM", average);
+
+	const double currents[] = {579, 581, 600, 619, 621};
+	const double expected[] = {12000, 6000, 6000, 6000, 3000};
+	for (int k = 0; k < 5; k++) {
+		double voltage = rgt_bangbang_calculate(&b, 600, currents[k]);
+		CHECK(voltage == expected[k], "%g gave %g, expected %g", currents[k],
+		      voltage, expected[k]);
+	}
+}
+
+/**
+ * A double integrator: the mechanism accelerates at ACCELERATION units/s^2 at
+ * full voltage, in proportion to the voltage, with no friction.
+ */
+#define ACCELERATION 4000.0
+
+typedef struct {
+	double position;
+	double velocity;
+} Mass;
+
+static void mass_step(Mass *m, double voltage) {
+	double a = ACCELERATION * voltage / 12000;
+	double dt = PERIOD / 1000.0;
+	m->position += m->velocity * dt + a * dt * dt / 2;
+	m->velocity += a * dt;
+	test_advance_ms(PERIOD);
+}
+
+static void test_min_time(double distance) {
+	test_reset();
+	Rgt_Bangbang b = rgt_bangbang_init(RGT_BANGBANG_MIN_TIME, 12000, 0, 2);
+	b.deceleration = ACCELERATION;
+	Mass m = {0, 0};
+
+	double direction = distance > 0 ? 1 : -1;
+	double overshoot = 0;
+	int arrived = -1;
+	for (int k = 0; k < 300; k++) {
+		double voltage = rgt_bangbang_calculate(&b, distance, m.position);
+		if (arrived < 0 && fabs(distance - m.position) <= b.band)
+			arrived = k * PERIOD;
+		mass_step(&m, voltage);
+		double past = (m.position - distance) * direction;
+		if (past > overshoot)
+			overshoot = past;
+	}
+	// Full power halfway, then full brakes
+	double fastest = 2 * sqrt(fabs(distance) / ACCELERATION) * 1000;
+	printf("min time %+.0f: arrived in %d ms (fastest %.0f ms), overshoot "
+	       "%.2f, final speed %.2f\n",
+	       distance, arrived, fastest, overshoot, fabs(m.velocity));
+	// Braking a little early costs a few updates of creeping up
+	CHECK(arrived >= 0 && arrived < fastest + 5 * PERIOD,
+	      "arrived in %d ms, fastest %g ms", arrived, fastest);
+	CHECK(overshoot <= b.band, "overshot by %g", overshoot);
+	// Nothing slows the mass but the brakes, so it only stops if they do
+	CHECK(fabs(m.velocity) < 1e-9 && fabs(distance - m.position) <= b.band,
+	      "still moving at %g, %g from the target", m.velocity,
+	      distance - m.position);
+}
+
+int main(void) {
+	test_hysteresis();
+	test_deadband();
+	test_min_time(1000);
+	test_min_time(-1000);
+	test_min_time(37);
+	test_min_time(-5);
+	return test_summary("test_bangbang");
+}
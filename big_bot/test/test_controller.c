@@ -0,0 +1,344 @@
+#include "test.h"
+
+#include "ringtail/controller.h"
+#include "ringtail/reference_controllers.h"
+
+#include "pros/error.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file test_controller.c
+ *
+ * @brief Checks for the controller loops' settling, coupled timing, and a tank
+ * drive losing a side, and a stress test of the lock-free target, reset,
+ * at_target and timing fields
+ */
+
+// The sensor reading each controller cycle sees
+static double reading;
+
+static double get_reading(void) { return reading; }
+
+static void get_readings(void *context, double *values) {
+	(void)context;
+	values[0] = reading;
+	values[1] = 0;
+}
+
+static double hold(double target, double current, bool reset) {
+	(void)target;
+	(void)current;
+	(void)reset;
+	return 0;
+}
+
+static void hold_coupled(void *context, const double *targets,
+                         const double *values, bool reset, double *voltages) {
+	(void)context;
+	(void)targets;
+	(void)values;
+	(void)reset;
+	voltages[0] = 0;
+}
+
+// The readings for each cycle: 1 is within the threshold, 0 is outside it
+static const char SETTLE_SCRIPT[] = "1110111100111";
+
+static void test_settle_is_consecutive(void) {
+	test_reset();
+	const rgt_motor_group ports = {1};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+
+	Rgt_Controller_Info i =
+	    rgt_controller_info_init(&mg, get_reading, hold, NULL, 5, 4);
+	rgt_controller_set_target(&i, 100);
+
+	const Rgt_Motor_Group *const mgs[] = {&mg};
+	const double thresholds[] = {5, 5};
+	Rgt_Coupled_Controller c = rgt_coupled_controller_init(
+	    mgs, 1, 2, get_readings, NULL, hold_coupled, NULL, thresholds, 4);
+	rgt_coupled_controller_set_targets(&c, (const double[]){100, 0});
+
+	// Three cycles in the band and one out don't settle. The fourth cycle of
+	// the next unbroken run does, and at_target stays set once it is
+	for (int k = 0; SETTLE_SCRIPT[k] != '\0'; k++) {
+		reading = SETTLE_SCRIPT[k] == '1' ? 98 : 120;
+		rgt_controller_step(&i);
+		rgt_coupled_controller_step(&c);
+		test_advance_ms(10);
+
+		bool settled = k >= 7;
+		CHECK(rgt_controller_at_target(&i) == settled,
+		      "at_target %d after cycle %d", rgt_controller_at_target(&i), k);
+		CHECK(rgt_coupled_controller_at_target(&c) == settled,
+		      "coupled at_target %d after cycle %d",
+		      rgt_coupled_controller_at_target(&c), k);
+	}
+}
+
+static void test_coupled_timing(void) {
+	test_reset();
+	const rgt_motor_group ports = {1};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	const Rgt_Motor_Group *const mgs[] = {&mg};
+	const double thresholds[] = {5, 5};
+	Rgt_Coupled_Controller c = rgt_coupled_controller_init(
+	    mgs, 1, 2, get_readings, NULL, hold_coupled, NULL, thresholds, 4);
+
+	// Four cycles on time, then one that starts 3 ms late
+	const uint32_t periods[] = {10, 10, 10, 10, 13};
+	rgt_coupled_controller_step(&c);
+	for (int k = 0; k < 5; k++) {
+		test_advance_ms(periods[k]);
+		rgt_coupled_controller_step(&c);
+	}
+	Rgt_Controller_Timing t = rgt_coupled_controller_get_timing(&c);
+	CHECK(t.cycles == 5 && t.min_period == 10000 && t.max_period == 13000 &&
+	          t.mean_period == 10600 && t.overruns == 1,
+	      "%u cycles, min %u, max %u, mean %f, %u overruns", t.cycles,
+	      t.min_period, t.max_period, t.mean_period, t.overruns);
+
+	// A reset takes effect on the next cycle, which starts a new period
+	rgt_coupled_controller_reset_timing(&c);
+	test_advance_ms(10);
+	rgt_coupled_controller_step(&c);
+	test_advance_ms(10);
+	rgt_coupled_controller_step(&c);
+	t = rgt_coupled_controller_get_timing(&c);
+	CHECK(t.cycles == 1 && t.max_period == 10000 && t.overruns == 0,
+	      "after a reset: %u cycles, max %u, %u overruns", t.cycles,
+	      t.max_period, t.overruns);
+}
+
+// Whether every motor's last command is a voltage the motors accept
+static bool commands_valid(void) {
+	for (uint8_t p = 1; p <= 4; p++) {
+		if (test_motors[p].command < -12000 || test_motors[p].command > 12000)
+			return false;
+	}
+	return true;
+}
+
+static void test_tank_dead_side(void) {
+	test_reset();
+	static Rgt_Motor_Group left, right;
+	const rgt_motor_group left_ports = {1, 2};
+	const rgt_motor_group right_ports = {-3, -4};
+	left = rgt_mg_init(left_ports);
+	right = rgt_mg_init(right_ports);
+	static Rgt_Tank_Drive drive;
+	drive = (Rgt_Tank_Drive){
+	    .left = &left,
+	    .right = &right,
+	    .scale = 1,
+	    .aggregation = RGT_MG_AGGREGATE_MEAN,
+	    .distance_pid = rgt_pid_init(20, 0, 0),
+	    .heading_pid = rgt_pid_init(20, 0, 0),
+	};
+	const Rgt_Motor_Group *const sides[] = {&left, &right};
+	const double thresholds[] = {5, 5};
+	Rgt_Coupled_Controller c =
+	    rgt_coupled_controller_init(sides, 2, 2, rgt_tank_get_sensor_data,
+	                                &drive, rgt_tank_calculate_voltages,
+	                                &drive, thresholds, 4);
+
+	// A side that has never been read leaves the motors alone
+	test_motors[3].unplugged = true;
+	test_motors[4].unplugged = true;
+	double values[2];
+	rgt_tank_get_sensor_data(&drive, values);
+	CHECK(values[0] == PROS_ERR_F && values[1] == PROS_ERR_F,
+	      "read %f and %f without a right side", values[0], values[1]);
+	rgt_coupled_controller_step(&c);
+	CHECK(test_motors[1].commands == 0, "moved without a right side");
+
+	// The left side is 40 ahead, so the drive is at 20 and turned by 20
+	test_motors[3].unplugged = false;
+	test_motors[4].unplugged = false;
+	for (uint8_t p = 1; p <= 4; p++)
+		test_motors[p].position = p <= 2 ? 40 : 0;
+	rgt_coupled_controller_set_targets(&c, (const double[]){100, 0});
+	rgt_coupled_controller_step(&c);
+	rgt_tank_get_sensor_data(&drive, values);
+	CHECK(values[0] == 20 && values[1] == 20, "read %f and %f", values[0],
+	      values[1]);
+
+	// Unplugging the whole right side holds its last distance, and the left
+	// side keeps counting
+	test_motors[3].unplugged = true;
+	test_motors[4].unplugged = true;
+	test_motors[1].position = 60;
+	test_motors[2].position = 60;
+	rgt_tank_get_sensor_data(&drive, values);
+	CHECK(values[0] == 30 && values[1] == 30,
+	      "read %f and %f with the right side unplugged", values[0],
+	      values[1]);
+	rgt_coupled_controller_step(&c);
+	CHECK(commands_valid(), "commanded %d and %d mV with a dead side",
+	      test_motors[1].command, test_motors[2].command);
+	// 70 short of the target and turned by 30
+	CHECK(test_motors[1].command == 20 * 70 - 20 * 30,
+	      "commanded %d mV with a dead side", test_motors[1].command);
+}
+
+/*******************************************************************************
+ *                                 Stress Test                                 *
+ ******************************************************************************/
+
+// The number of targets the writer steps through
+#define GENERATIONS 20000
+
+// The settle threshold and count of the stressed controller
+#define STRESS_THRESHOLD 5
+#define STRESS_SETTLE_COUNT 2
+
+/**
+ * The writer's g-th target. The low bits of both 32-bit halves of the double
+ * are set, so a target torn between two generations isn't any generation's.
+ */
+static double stress_target(uint32_t g) { return g * 1000.0 + 0.3; }
+
+static bool stress_is_target(double target) {
+	double g = round((target - 0.3) / 1000.0);
+	return g >= 0 && g <= GENERATIONS && target == stress_target(g);
+}
+
+static Rgt_Controller_Info stress;
+// The mechanism's position, which jumps to the target each cycle. Only the
+// loop thread writes it
+static double plant;
+// The latest reading the loop took, for the reader to check against
+static double sensed;
+// The latest generation the writer has fully published
+static uint32_t published;
+static bool done;
+// Counted by the loop thread, which can't call CHECK on every cycle
+static uint32_t torn_targets;
+
+static double stress_get_sensor_data(void) {
+	__atomic_store(&sensed, &plant, __ATOMIC_RELEASE);
+	return plant;
+}
+
+static double stress_calculate_voltage(double target, double current,
+                                       bool reset) {
+	(void)current;
+	(void)reset;
+	if (!stress_is_target(target))
+		torn_targets++;
+	plant = target;
+	return 0;
+}
+
+static void *stress_loop(void *arg) {
+	(void)arg;
+	while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		rgt_controller_step(&stress);
+		test_advance_ms(10);
+		sched_yield();
+	}
+	return NULL;
+}
+
+/**
+ * Returns whether the controller is at its target. Once the reset for
+ * generation g is published, at_target can only be true for readings that
+ * settled at g's target or a later one - anything else counts as stale.
+ */
+static bool stress_at_target(uint32_t g, uint32_t *stale) {
+	if (!rgt_controller_at_target(&stress))
+		return false;
+
+	double reading;
+	__atomic_load(&sensed, &reading, __ATOMIC_ACQUIRE);
+	if (reading < stress_target(g) - STRESS_THRESHOLD)
+		(*stale)++;
+	return true;
+}
+
+// Steps through the targets, resetting after each and waiting for it to settle
+static void *stress_writer(void *arg) {
+	uint32_t *stale = arg;
+	for (uint32_t g = 1; g <= GENERATIONS; g++) {
+		rgt_controller_set_target(&stress, stress_target(g));
+		rgt_controller_reset(&stress);
+		__atomic_store_n(&published, g, __ATOMIC_RELEASE);
+		// Polls instead of waiting, so the stubs don't have to wake tasks.
+		// Yielding lets the test run on a single core
+		while (!stress_at_target(g, stale))
+			sched_yield();
+	}
+	__atomic_store_n(&done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *stress_reader(void *arg) {
+	uint32_t *stale = arg;
+	uint32_t last_cycles = 0;
+	while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		stress_at_target(__atomic_load_n(&published, __ATOMIC_ACQUIRE), stale);
+
+		// The loop advances the clock by exactly one period per cycle, so
+		// every consistent snapshot has the same min, max and mean
+		Rgt_Controller_Timing t = rgt_controller_get_timing(&stress);
+		bool consistent = t.cycles >= last_cycles &&
+		                  (t.cycles == 0 || (t.min_period == 10000 &&
+		                                     t.max_period == 10000 &&
+		                                     t.mean_period == 10000));
+		if (!consistent) {
+			CHECK(consistent,
+			      "timing snapshot: %u cycles (was %u), min %u, max %u, mean "
+			      "%f",
+			      t.cycles, last_cycles, t.min_period, t.max_period,
+			      t.mean_period);
+			break;
+		}
+		last_cycles = t.cycles;
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void test_stress(void) {
+	test_reset();
+	const rgt_motor_group ports = {1};
+	static Rgt_Motor_Group mg;
+	mg = rgt_mg_init(ports);
+	stress = rgt_controller_info_init(
+	    &mg, stress_get_sensor_data, stress_calculate_voltage, NULL,
+	    STRESS_THRESHOLD, STRESS_SETTLE_COUNT);
+	rgt_controller_set_target(&stress, stress_target(0));
+
+	uint32_t stale[3] = {0, 0, 0};
+	pthread_t loop, writer, readers[2];
+	pthread_create(&loop, NULL, stress_loop, NULL);
+	pthread_create(&readers[0], NULL, stress_reader, &stale[0]);
+	pthread_create(&readers[1], NULL, stress_reader, &stale[1]);
+	pthread_create(&writer, NULL, stress_writer, &stale[2]);
+	pthread_join(writer, NULL);
+	pthread_join(readers[0], NULL);
+	pthread_join(readers[1], NULL);
+	pthread_join(loop, NULL);
+
+	Rgt_Controller_Timing t = rgt_controller_get_timing(&stress);
+	printf("stress: %u generations over %u cycles\n", GENERATIONS, t.cycles);
+	CHECK(torn_targets == 0, "%u torn targets", torn_targets);
+	CHECK(stale[0] + stale[1] + stale[2] == 0, "%u stale at_target reads",
+	      stale[0] + stale[1] + stale[2]);
+	CHECK(test_mutex_takes == 0, "the controller took its mutex %u times",
+	      test_mutex_takes);
+}
+
+int main(void) {
+	test_settle_is_consecutive();
+	test_coupled_timing();
+	test_tank_dead_side();
+	test_stress();
+	return test_summary("test_controller");
+}
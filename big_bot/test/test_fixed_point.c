@@ -0,0 +1,181 @@
+#include "test.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file test_fixed_point.c
+ *
+ * @brief Checks the float and Q16.16 reference controllers against the double
+ * versions, and that the Q16.16 math saturates instead of wrapping
+ */
+
+#define STEPS 1000
+
+// The size of one Q16.16 step
+#define LSB (1.0 / 65536)
+
+// A repeatable pseudo-random value from -range to range
+static double random_value(uint32_t *seed, double range) {
+	*seed = *seed * 1664525 + 1013904223;
+	return ((double)(*seed >> 8) / (1 << 24) * 2 - 1) * range;
+}
+
+static void test_bangbang(void) {
+	uint32_t seed = 3;
+	bool same = true;
+	for (int k = 0; k < STEPS; k++) {
+		double target = random_value(&seed, 100);
+		double current = random_value(&seed, 100);
+		double expected = bangbang(target, current, 12000, -3000);
+		if (bangbangf(target, current, 12000, -3000) != expected ||
+		    bangbang_q16(rgt_q16_from_double(target),
+		                 rgt_q16_from_double(current), 12000,
+		                 -3000) != RGT_Q16(expected))
+			same = false;
+	}
+	CHECK(same, "bangbang variants disagree");
+}
+
+static void test_pid(void) {
+	const double kP = 20, kI = 0.01, kD = 5;
+	// The Q16.16 gains. 20 and 5 are exact, but 0.01 rounds to the nearest
+	// step, so the fixed-point controller runs slightly different gains
+	const rgt_q16_t qP = RGT_Q16(kP), qI = RGT_Q16(kI), qD = RGT_Q16(kD);
+	const double dP = fabs(rgt_q16_to_double(qP) - kP);
+	const double dI = fabs(rgt_q16_to_double(qI) - kI);
+	const double dD = fabs(rgt_q16_to_double(qD) - kD);
+
+	double integral = 0, prev = 0;
+	float integral_f = 0, prev_f = 0;
+	rgt_q16_t integral_16 = 0, prev_16 = 0;
+	double worst_f = 0, worst_16 = 0, worst_gains = 0;
+	bool within = true;
+
+	uint32_t seed = 11;
+	for (int k = 0; k < STEPS; k++) {
+		// Every error is exactly representable in Q16.16, so the fixed-point
+		// version starts from the same inputs as the double one
+		rgt_q16_t e16 = rgt_q16_from_double(random_value(&seed, 100));
+		double error = rgt_q16_to_double(e16);
+		bool clear = k % 250 == 249;
+
+		double expected = pid(error, kP, kI, kD, &integral, prev, clear);
+		float f = pidf((float)error, kP, kI, kD, &integral_f, prev_f, clear);
+		rgt_q16_t q = pid_q16(e16, qP, qI, qD, &integral_16, prev_16, clear);
+
+		// Float error is relative to the size of the terms being summed
+		double terms = fabs(kP * error) + fabs(kI * integral) +
+		               fabs(kD * (error - prev));
+		// The integral is exact in Q16.16, so the fixed-point output is off
+		// by the gain rounding times each term, plus the rounding of the
+		// three products to within half a step each
+		double gains = dP * fabs(error) + dI * fabs(integral) +
+		               dD * fabs(error - prev);
+		prev = error;
+		prev_f = (float)error;
+		prev_16 = e16;
+		double df = fabs(f - expected) / (1 + terms);
+		if (df > worst_f)
+			worst_f = df;
+		double d16 = fabs(rgt_q16_to_double(q) - expected);
+		if (d16 > worst_16)
+			worst_16 = d16;
+		if (gains > worst_gains)
+			worst_gains = gains;
+		if (d16 > gains + 1.5 * LSB)
+			within = false;
+	}
+	printf("pid: float off by %.2g (relative), Q16.16 off by %.2g mV, "
+	       "%.2g mV of it from the gains\n",
+	       worst_f, worst_16, worst_gains);
+	// Single precision has a 24-bit mantissa, but the float integral gathers
+	// a rounding error on every update
+	CHECK(worst_f < 1e-6, "pidf off by %g", worst_f);
+	CHECK(within, "pid_q16 off by more than its gain and product rounding");
+	// Well under a millivolt, against commands of up to 12000 mV
+	CHECK(worst_16 < 0.1, "pid_q16 off by %g", worst_16);
+}
+
+static void test_tbh(void) {
+	const double kH = 0.75;
+	const rgt_q16_t qH = RGT_Q16(kH);
+
+	double output = 0, taken = 0, prev = 0;
+	float output_f = 0, taken_f = 0, prev_f = 0;
+	rgt_q16_t output_16 = 0, taken_16 = 0, prev_16 = 0;
+	double worst_f = 0, worst_16 = 0;
+
+	uint32_t seed = 5;
+	for (int k = 0; k < STEPS; k++) {
+		rgt_q16_t e16 = rgt_q16_from_double(random_value(&seed, 100));
+		double error = rgt_q16_to_double(e16);
+
+		tbh(error, prev, &output, &taken, kH);
+		tbhf((float)error, prev_f, &output_f, &taken_f, kH);
+		tbh_q16(e16, prev_16, &output_16, &taken_16, qH);
+		prev = error;
+		prev_f = (float)error;
+		prev_16 = e16;
+
+		if (fabs(output_f - output) > worst_f)
+			worst_f = fabs(output_f - output);
+		if (fabs(rgt_q16_to_double(output_16) - output) > worst_16)
+			worst_16 = fabs(rgt_q16_to_double(output_16) - output);
+	}
+	printf("tbh: float off by %.2g, Q16.16 off by %.2f LSB\n", worst_f,
+	       worst_16 / LSB);
+	// Rounding errors accumulate in the output, at most one step per update
+	// for Q16.16 - halving only ever averages them
+	CHECK(worst_f < 1e-3, "tbhf off by %g", worst_f);
+	CHECK(worst_16 <= STEPS * LSB, "tbh_q16 off by %g LSB", worst_16 / LSB);
+}
+
+static void test_q16_saturation(void) {
+	CHECK(rgt_q16_from_double(1e6) == INT32_MAX &&
+	          rgt_q16_from_double(-1e6) == INT32_MIN,
+	      "conversion wrapped");
+	CHECK(RGT_Q16(-0.5) == -32768 && RGT_Q16(1.5) == 98304,
+	      "RGT_Q16 rounded to %d and %d", RGT_Q16(-0.5), RGT_Q16(1.5));
+
+	// A full integral holds at the top of the range instead of flipping sign
+	rgt_q16_t integral = INT32_MAX - 10;
+	rgt_q16_t out = pid_q16(RGT_Q16(1), 0, RGT_Q16(1), 0, &integral, 0, false);
+	CHECK(integral == INT32_MAX && out == INT32_MAX,
+	      "integral %d, output %d at the top", integral, out);
+	integral = INT32_MIN + 10;
+	out = pid_q16(RGT_Q16(-1), 0, RGT_Q16(1), 0, &integral, 0, false);
+	CHECK(integral == INT32_MIN && out == INT32_MIN,
+	      "integral %d, output %d at the bottom", integral, out);
+
+	// Each product and sum saturates: a product over the range, two terms
+	// that only overflow together, and the derivative's difference
+	integral = 0;
+	out = pid_q16(RGT_Q16(30000), RGT_Q16(2), 0, 0, &integral, 0, false);
+	CHECK(out == INT32_MAX, "product saturated to %d", out);
+	integral = 0;
+	out = pid_q16(RGT_Q16(-20000), RGT_Q16(1), 0, RGT_Q16(1), &integral,
+	              RGT_Q16(0), false);
+	CHECK(out == INT32_MIN, "sum saturated to %d", out);
+	integral = 0;
+	out = pid_q16(INT32_MAX, 0, 0, RGT_Q16(1), &integral, INT32_MIN, false);
+	CHECK(out == INT32_MAX, "derivative saturated to %d", out);
+
+	// TBH's output saturates too, and halving a saturated sum doesn't wrap
+	rgt_q16_t output = INT32_MAX - 100, taken = INT32_MAX;
+	tbh_q16(RGT_Q16(1000), RGT_Q16(1), &output, &taken, RGT_Q16(1));
+	CHECK(output == INT32_MAX, "tbh output saturated to %d", output);
+	tbh_q16(RGT_Q16(-1), RGT_Q16(1), &output, &taken, RGT_Q16(1));
+	CHECK(output > 0 && output == taken, "tbh took back half to %d", output);
+}
+
+int main(void) {
+	test_bangbang();
+	test_pid();
+	test_tbh();
+	test_q16_saturation();
+	return test_summary("test_fixed_point");
+}
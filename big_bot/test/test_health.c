@@ -0,0 +1,145 @@
+#include "test.h"
+
+#include "ringtail/health.h"
+#include "ringtail/motor_group.h"
+
+#include <stdint.h>
+
+/**
+ * @file test_health.c
+ *
+ * @brief Checks that the health monitor keeps the user's limits, retries
+ * failed writes, and keeps derating a motor across an unplug
+ */
+
+// Derates from 45 to 55 degrees C, capping the voltage at 8 V
+static const Rgt_Health_Policy policy = {
+    .derate_temperature = 45,
+    .critical_temperature = 55,
+    .max_current_limit = 2500,
+    .min_current_limit = 1250,
+    .voltage_cap = 8000,
+    .alert = true,
+};
+
+// Registrations can't be undone, so each test uses its own ports
+static Rgt_Motor_Group user_limits_group;
+static Rgt_Motor_Group retry_group;
+static Rgt_Motor_Group unplug_group;
+
+static void test_user_limits(void) {
+	test_reset();
+	const rgt_motor_group ports = {1, -2};
+	user_limits_group = rgt_mg_init(ports);
+	rgt_health_register(&user_limits_group, &policy);
+
+	// Limits set before the monitor first sees the motor are kept
+	test_motors[1].current_limit = 1800;
+	test_motors[1].voltage_limit = 10000;
+	rgt_health_step();
+	Rgt_Motor_Health h;
+	rgt_health_get(1, &h);
+	CHECK(test_motors[1].current_limit == 1800 &&
+	          test_motors[1].voltage_limit == 10000,
+	      "user's limits changed to %d mA and %d mV",
+	      test_motors[1].current_limit, test_motors[1].voltage_limit);
+	CHECK(h.current_limit == 1800, "read a limit of %d mA", h.current_limit);
+
+	// 50 degrees is a 1875 mA limit, above the user's, so only the voltage is
+	// capped. 54 degrees is 1375 mA
+	test_motors[1].temperature = 50;
+	test_motors[2].temperature = 50;
+	rgt_health_step();
+	CHECK(test_motors[1].current_limit == 1800,
+	      "raised the user's limit to %d mA", test_motors[1].current_limit);
+	CHECK(test_motors[1].voltage_limit == 8000 &&
+	          test_motors[2].voltage_limit == 8000,
+	      "capped to %d and %d mV", test_motors[1].voltage_limit,
+	      test_motors[2].voltage_limit);
+	CHECK(test_motors[2].current_limit == 1875, "derated to %d mA",
+	      test_motors[2].current_limit);
+	CHECK(test_rumbles == 1, "rumbled %u times for one group", test_rumbles);
+
+	test_motors[1].temperature = 54;
+	rgt_health_step();
+	CHECK(test_motors[1].current_limit == 1375, "derated to %d mA",
+	      test_motors[1].current_limit);
+
+	// Once it cools, the motor gets the user's limits back
+	test_motors[1].temperature = 30;
+	test_motors[2].temperature = 30;
+	rgt_health_step();
+	CHECK(test_motors[1].current_limit == 1800 &&
+	          test_motors[1].voltage_limit == 10000,
+	      "restored %d mA and %d mV", test_motors[1].current_limit,
+	      test_motors[1].voltage_limit);
+	CHECK(test_motors[2].current_limit == 2500 &&
+	          test_motors[2].voltage_limit == 12000,
+	      "restored %d mA and %d mV", test_motors[2].current_limit,
+	      test_motors[2].voltage_limit);
+	CHECK(test_rumbles == 1, "rumbled %u times", test_rumbles);
+}
+
+static void test_retry(void) {
+	test_reset();
+	const rgt_motor_group ports = {3};
+	retry_group = rgt_mg_init(ports);
+	rgt_health_register(&retry_group, &policy);
+	rgt_health_step();
+
+	test_motors[3].temperature = 50;
+	test_motors[3].limit_writes_fail = true;
+	rgt_health_step();
+	rgt_health_step();
+	CHECK(test_motors[3].voltage_limit == 12000, "failed write set %d mV",
+	      test_motors[3].voltage_limit);
+
+	// Nothing changed since the writes failed, but they're sent again
+	test_motors[3].limit_writes_fail = false;
+	rgt_health_step();
+	CHECK(test_motors[3].current_limit == 1875 &&
+	          test_motors[3].voltage_limit == 8000,
+	      "retried to %d mA and %d mV", test_motors[3].current_limit,
+	      test_motors[3].voltage_limit);
+}
+
+static void test_unplug(void) {
+	test_reset();
+	const rgt_motor_group ports = {4};
+	unplug_group = rgt_mg_init(ports);
+	rgt_health_register(&unplug_group, &policy);
+
+	test_motors[4].temperature = 50;
+	rgt_health_step();
+	CHECK(test_rumbles == 1, "rumbled %u times", test_rumbles);
+
+	// An unplugged motor is still as hot as it was
+	test_motors[4].unplugged = true;
+	rgt_health_step();
+	Rgt_Motor_Health h;
+	rgt_health_get(4, &h);
+	CHECK(h.derating, "unplugged motor stopped derating");
+
+	// It comes back with the firmware's default limits, and gets the derated
+	// ones again
+	test_motors[4].unplugged = false;
+	test_motors[4].current_limit = 2500;
+	test_motors[4].voltage_limit = 12000;
+	rgt_health_step();
+	rgt_health_get(4, &h);
+	CHECK(h.derating && h.current_limit == 1875, "replugged at %d mA",
+	      h.current_limit);
+	CHECK(test_motors[4].current_limit == 1875 &&
+	          test_motors[4].voltage_limit == 8000,
+	      "replugged motor limited to %d mA and %d mV",
+	      test_motors[4].current_limit, test_motors[4].voltage_limit);
+	CHECK(test_rumbles == 1, "rumbled %u times across the unplug",
+	      test_rumbles);
+}
+
+int main(void) {
+	test_user_limits();
+	test_retry();
+	test_unplug();
+	return test_summary("test_health");
+}
@@ -0,0 +1,322 @@
+#include "test.h"
+
+#include "ringtail/motion_profile.h"
+#include "ringtail/reference_controllers.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file test_motion_profile.c
+ *
+ * @brief Checks for the motion profiles, retargeting them mid-move, and step
+ * responses with and without them
+ */
+
+// The controller period, in ms
+#define PERIOD 10
+
+// The drivetrain's limits, in wheel degrees
+static const Rgt_Profile_Limits LIMITS = {
+    .max_velocity = 1400, .max_acceleration = 4000, .max_jerk = 24000};
+
+/**
+ * Plans a move starting at velocity and samples it finely, checking that it
+ * stays within the limits, never jumps, and comes to rest exactly at end. A
+ * move from rest also never goes backwards.
+ */
+static void check_move_from(Rgt_Profile_Limits limits, double start,
+                            double velocity, double end) {
+	const char *kind = limits.max_jerk > 0 ? "S-curve" : "trapezoid";
+	Rgt_Motion_Profile p = rgt_profile_init(
+	    limits.max_velocity, limits.max_acceleration, limits.max_jerk);
+	rgt_profile_plan_from(&p, start, velocity, end);
+	double duration = rgt_profile_duration(&p);
+	double distance = fabs(end - start);
+	// Room for rounding, relative to the size of the move
+	double eps = 1e-9 * (1 + distance + fabs(velocity));
+
+	const int samples = 10000;
+	double dt = duration / samples;
+	Rgt_Profile_State prev = rgt_profile_sample(&p, 0);
+	bool within = true, continuous = true, monotonic = true;
+	for (int k = 1; k < samples; k++) {
+		Rgt_Profile_State s = rgt_profile_sample(&p, k * dt);
+		if (fabs(s.velocity) > limits.max_velocity + eps ||
+		    fabs(s.acceleration) > limits.max_acceleration + eps)
+			within = false;
+		if (fabs(s.position - prev.position) >
+		        limits.max_velocity * dt + eps ||
+		    fabs(s.velocity - prev.velocity) >
+		        limits.max_acceleration * dt + eps)
+			continuous = false;
+		if (velocity == 0 &&
+		    (end - start) * (s.position - prev.position) < -eps)
+			monotonic = false;
+		prev = s;
+	}
+	CHECK(within, "%s %g at %g to %g went over its limits", kind, start,
+	      velocity, end);
+	CHECK(continuous, "%s %g at %g to %g jumped", kind, start, velocity, end);
+	CHECK(monotonic, "%s %g to %g went backwards", kind, start, end);
+
+	// Just before the end, the planned phases must already have arrived - the
+	// sample at the end is exact by definition
+	Rgt_Profile_State last = rgt_profile_sample(&p, duration * (1 - 1e-9));
+	CHECK(fabs(last.position - end) < 1e-6 * (1 + distance) &&
+	          fabs(last.velocity) < 1e-3,
+	      "%s %g at %g to %g arrived at %.9f at %.9f/s", kind, start, velocity,
+	      end, last.position, last.velocity);
+	Rgt_Profile_State after = rgt_profile_sample(&p, duration);
+	CHECK(after.position == end && after.velocity == 0 &&
+	          after.acceleration == 0,
+	      "%s %g at %g to %g ended at %f", kind, start, velocity, end,
+	      after.position);
+}
+
+static void check_move(Rgt_Profile_Limits limits, double start, double end) {
+	check_move_from(limits, start, 0, end);
+}
+
+static void test_plan_branches(void) {
+	Rgt_Profile_Limits trapezoid = LIMITS;
+	trapezoid.max_jerk = 0;
+	// A jerk too low to reach the acceleration limit before the velocity one
+	Rgt_Profile_Limits soft = LIMITS;
+	soft.max_jerk = 4000;
+
+	// Long enough to cruise, too short to cruise, too short for full
+	// acceleration, and tiny - in both directions
+	const double distances[] = {3000, 600, 50, 1e-3, 0};
+	for (unsigned k = 0; k < sizeof(distances) / sizeof(*distances); k++) {
+		for (int d = -1; d <= 1; d += 2) {
+			double end = 100 + d * distances[k];
+			check_move(trapezoid, 100, end);
+			check_move(LIMITS, 100, end);
+			check_move(soft, 100, end);
+		}
+	}
+}
+
+static void test_plan_from(void) {
+	Rgt_Profile_Limits trapezoid = LIMITS;
+	trapezoid.max_jerk = 0;
+
+	// Towards the end with room to cruise, too little room to speed up, and
+	// too little room to stop, and moving away from it
+	const double distances[] = {3000, 300, 50, 0};
+	const double velocities[] = {700, 1400, -700};
+	for (unsigned k = 0; k < sizeof(distances) / sizeof(*distances); k++) {
+		for (unsigned v = 0; v < 3; v++) {
+			check_move_from(trapezoid, 100, velocities[v], 100 + distances[k]);
+			check_move_from(LIMITS, 100, velocities[v], 100 + distances[k]);
+			check_move_from(LIMITS, 100, -velocities[v], 100 - distances[k]);
+		}
+	}
+}
+
+static void test_bad_limits(void) {
+	// Limits that can't move anything step straight to the end
+	const Rgt_Profile_Limits bad[] = {
+	    {0, 4000, 24000}, {1400, 0, 24000}, {-1400, -4000, -1}, {NAN, 4000, 0}};
+	for (unsigned k = 0; k < sizeof(bad) / sizeof(*bad); k++) {
+		Rgt_Motion_Profile p = rgt_profile_init(
+		    bad[k].max_velocity, bad[k].max_acceleration, bad[k].max_jerk);
+		rgt_profile_plan_from(&p, 0, 500, 100);
+		Rgt_Profile_State s = rgt_profile_sample(&p, 0.01);
+		CHECK(rgt_profile_duration(&p) == 0 && s.position == 100 &&
+		          s.velocity == 0 && s.acceleration == 0,
+		      "limits %u took %f s, sampled %f at %f", k,
+		      rgt_profile_duration(&p), s.position, s.velocity);
+	}
+
+	// A negative jerk is a trapezoid
+	Rgt_Profile_Limits negative = LIMITS;
+	negative.max_jerk = -1;
+	check_move(negative, 0, 1000);
+}
+
+/**
+ * test_pid's first-order motor model, scaled to the drivetrain's free speed of
+ * 2160 wheel degrees per second
+ */
+typedef struct {
+	double position;
+	double velocity;
+} Plant;
+
+static void plant_update(Plant *p, double voltage) {
+	double free_velocity = voltage / 12000 * 2160;
+	p->velocity += (free_velocity - p->velocity) * 0.125;
+	p->position += p->velocity * PERIOD / 1000.0;
+}
+
+typedef struct {
+	double overshoot; // How far past the target the mechanism went
+	int settle;       // Time (ms) until it stayed within 5, or -1 if never
+	int saturated;    // Cycles spent at full voltage
+	double max_jerk;  // The largest change in setpoint acceleration per cycle
+	double error;     // The largest distance from the moving setpoint
+} Response;
+
+/**
+ * Moves 1000 degrees with the drivetrain's PID, following a profile with
+ * limits if they are given, or with a step target if they are NULL
+ */
+static Response respond(const Rgt_Profile_Limits *limits) {
+	const double target = 1000;
+	Plant plant = {0, 0};
+	Response r = {0, -1, 0, 0, 0};
+	test_reset();
+
+	Rgt_PID pid = rgt_pid_init(20, 2, 5);
+	pid.integral_zone = 50;
+	pid.reset_on_sign_change = true;
+	pid.derivative_on_measurement = true;
+	pid.derivative_filter = 2;
+	pid.nominal_period = PERIOD;
+	const Rgt_Feedforward ff = {.kS = 500, .kV = 5.5, .kA = 0.6};
+
+	Rgt_Profiled_Target profiled = {0};
+	if (limits != NULL)
+		profiled.profile = rgt_profile_init(
+		    limits->max_velocity, limits->max_acceleration, limits->max_jerk);
+
+	double prev_acceleration = 0;
+	for (int t = 0; t < 5000; t += PERIOD) {
+		Rgt_Profile_State s = {.position = target};
+		double voltage = 0;
+		if (limits != NULL) {
+			s = rgt_profiled_target_update(&profiled, target, plant.position);
+			voltage =
+			    rgt_feedforward_calculate(&ff, s.velocity, s.acceleration);
+		}
+		voltage += rgt_pid_calculate_measured(&pid, s.position,
+		                                      plant.position, false);
+		if (fabs(voltage) >= 12000) {
+			voltage = copysign(12000, voltage);
+			r.saturated++;
+		}
+		if (fabs(s.acceleration - prev_acceleration) > r.max_jerk)
+			r.max_jerk = fabs(s.acceleration - prev_acceleration);
+		prev_acceleration = s.acceleration;
+
+		plant_update(&plant, voltage);
+		test_advance_ms(PERIOD);
+
+		if (fabs(s.position - plant.position) > r.error &&
+		    s.position != target)
+			r.error = fabs(s.position - plant.position);
+		if (plant.position - target > r.overshoot)
+			r.overshoot = plant.position - target;
+		if (fabs(target - plant.position) > 5)
+			r.settle = -1;
+		else if (r.settle < 0)
+			r.settle = t + PERIOD;
+	}
+	return r;
+}
+
+static void test_step_vs_profiled(void) {
+	Rgt_Profile_Limits trapezoid = LIMITS;
+	trapezoid.max_jerk = 0;
+
+	Response step = respond(NULL);
+	Response trap = respond(&trapezoid);
+	Response scurve = respond(&LIMITS);
+	printf("step:      overshoot %5.1f settle %4d ms, %3d saturated cycles\n",
+	       step.overshoot, step.settle, step.saturated);
+	printf("trapezoid: overshoot %5.1f settle %4d ms, %3d saturated cycles, "
+	       "tracking error %.1f\n",
+	       trap.overshoot, trap.settle, trap.saturated, trap.error);
+	printf("S-curve:   overshoot %5.1f settle %4d ms, %3d saturated cycles, "
+	       "tracking error %.1f\n",
+	       scurve.overshoot, scurve.settle, scurve.saturated, scurve.error);
+
+	CHECK(trap.settle >= 0 && scurve.settle >= 0,
+	      "profiled moves settled at %d and %d ms", trap.settle,
+	      scurve.settle);
+	CHECK(trap.overshoot < step.overshoot && scurve.overshoot < step.overshoot,
+	      "profiled overshoot %.1f and %.1f, step %.1f", trap.overshoot,
+	      scurve.overshoot, step.overshoot);
+	CHECK(trap.saturated < step.saturated && scurve.saturated < step.saturated,
+	      "profiled moves saturated %d and %d cycles, step %d", trap.saturated,
+	      scurve.saturated, step.saturated);
+	// The S-curve ramps its acceleration in, so the setpoint never jumps in
+	// acceleration like the trapezoid's does
+	CHECK(scurve.max_jerk <= LIMITS.max_jerk * PERIOD / 1000.0 + 1e-9 &&
+	          scurve.max_jerk < trap.max_jerk,
+	      "S-curve acceleration changed by %.1f per cycle, trapezoid %.1f",
+	      scurve.max_jerk, trap.max_jerk);
+	CHECK(scurve.error <= trap.error, "S-curve tracking error %.1f, "
+	                                  "trapezoid %.1f",
+	      scurve.error, trap.error);
+	// On this plant a profiled move takes about as long as the step response
+	// does to settle, so profiles don't settle sooner - but not later either
+	CHECK(trap.settle <= step.settle && scurve.settle <= step.settle,
+	      "profiled moves settled at %d and %d ms, step at %d", trap.settle,
+	      scurve.settle, step.settle);
+}
+
+/**
+ * Follows a profiled target for a while, then gives it a new one, checking
+ * that the setpoint's position and velocity carry over and that the new move
+ * ends at rest on the new target. Returns the setpoint at the retarget.
+ */
+static Rgt_Profile_State check_retarget(double first, int cycles,
+                                        double second) {
+	test_reset();
+	Rgt_Profiled_Target t = {0};
+	t.profile = rgt_profile_init(LIMITS.max_velocity, LIMITS.max_acceleration,
+	                             LIMITS.max_jerk);
+
+	Rgt_Profile_State s = {0};
+	for (int k = 0; k < cycles; k++) {
+		s = rgt_profiled_target_update(&t, first, 0);
+		test_advance_ms(PERIOD);
+	}
+
+	// One cycle later, the old move would have moved on by one cycle's worth
+	double dt = PERIOD / 1000.0;
+	Rgt_Profile_State r = rgt_profiled_target_update(&t, second, 0);
+	CHECK(fabs(r.position - s.position) <= LIMITS.max_velocity * dt &&
+	          fabs(r.velocity - s.velocity) <= LIMITS.max_acceleration * dt,
+	      "retargeting %g to %g jumped from %f at %f to %f at %f", first,
+	      second, s.position, s.velocity, r.position, r.velocity);
+
+	bool within = true;
+	for (int k = 0; k < 500; k++) {
+		test_advance_ms(PERIOD);
+		Rgt_Profile_State n = rgt_profiled_target_update(&t, second, 0);
+		if (fabs(n.velocity) > LIMITS.max_velocity + 1e-9 ||
+		    fabs(n.velocity - r.velocity) >
+		        LIMITS.max_acceleration * dt + 1e-9)
+			within = false;
+		r = n;
+	}
+	CHECK(within, "retargeted move %g to %g went over its limits", first,
+	      second);
+	CHECK(r.position == second && r.velocity == 0,
+	      "retargeted move %g to %g ended at %f at %f", first, second,
+	      r.position, r.velocity);
+	return s;
+}
+
+static void test_retarget(void) {
+	// Further along, back behind, and just ahead of where the move has got to
+	// at full speed, which it has to brake past and come back to
+	Rgt_Profile_State s = check_retarget(3000, 50, 4000);
+	CHECK(s.velocity > 0, "moving at %f after 500 ms", s.velocity);
+	check_retarget(3000, 50, 0);
+	check_retarget(3000, 100, 1200);
+}
+
+int main(void) {
+	test_plan_branches();
+	test_plan_from();
+	test_bad_limits();
+	test_step_vs_profiled();
+	test_retarget();
+	return test_summary("test_motion_profile");
+}
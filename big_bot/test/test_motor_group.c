@@ -0,0 +1,374 @@
+#include "test.h"
+
+#include "ringtail/motor_group.h"
+
+#include "pros/error.h"
+#include "pros/motors.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file test_motor_group.c
+ *
+ * @brief Checks for the motor group's aligned and aggregated readings, its
+ * snapshots, slew and jerk limits, and battery compensation
+ */
+
+/**
+ * Sets a motor as though the mechanism is at position (in the motor's units)
+ * and moving at rpm, as sampled at timestamp. Reversed ports store the
+ * readings negated, so they read back the same as the other motors.
+ */
+static void sample(int8_t port, double position, double rpm,
+                   uint32_t timestamp) {
+	Rgt_Test_Motor *m = &test_motors[port < 0 ? -port : port];
+	double direction = port < 0 ? -1 : 1;
+	m->position = direction * position;
+	m->velocity = direction * rpm;
+	m->timestamp = timestamp;
+}
+
+static void test_skewed_encoders(void) {
+	test_reset();
+	const rgt_motor_group ports = {-1, 2, -3};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	rgt_mg_set_encoder_units(&mg, E_MOTOR_ENCODER_DEGREES);
+
+	// 200 RPM is 1.2 degrees per ms. Each motor's last sample is 5 ms apart,
+	// so the raw readings are 6 degrees apart
+	sample(-1, 1188, 200, 990);
+	sample(2, 1194, 200, 995);
+	sample(-3, 1200, 200, 1000);
+
+	double positions[RGT_MG_SIZE];
+	uint32_t time = rgt_mg_get_aligned_positions(&mg, positions);
+	CHECK(time == 1000, "aligned to %u ms", time);
+	for (uint8_t i = 0; i < mg.count; i++)
+		CHECK(fabs(positions[i] - 1200) < 1e-9, "motor %u aligned to %f", i,
+		      positions[i]);
+
+	double raw = rgt_mg_get_average_position(&mg);
+	double aligned = rgt_mg_get_aligned_average_position(&mg);
+	CHECK(fabs(raw - 1194) < 1e-9, "raw average %f", raw);
+	CHECK(fabs(aligned - 1200) < 1e-9, "aligned average %f", aligned);
+
+	// A motor that stopped reporting is only extrapolated by
+	// RGT_MG_MAX_EXTRAPOLATION
+	sample(2, 1080, 200, 900);
+	rgt_mg_get_aligned_positions(&mg, positions);
+	CHECK(fabs(positions[1] - (1080 + 1.2 * RGT_MG_MAX_EXTRAPOLATION)) < 1e-9,
+	      "stale motor extrapolated to %f", positions[1]);
+
+	// A motor without a timestamp can't be aligned, so it is left out instead
+	// of being extrapolated from time 0
+	sample(2, 1194, 200, 995);
+	test_motors[2].raw_position_fails = true;
+	rgt_mg_get_aligned_positions(&mg, positions);
+	CHECK(positions[1] == PROS_ERR_F, "motor without a timestamp at %f",
+	      positions[1]);
+	aligned = rgt_mg_get_aligned_average_position(&mg);
+	CHECK(fabs(aligned - 1200) < 1e-9, "average without a timestamp %f",
+	      aligned);
+	test_motors[2].raw_position_fails = false;
+
+	// An unplugged motor is left out of the average instead of poisoning it
+	test_motors[2].unplugged = true;
+	aligned = rgt_mg_get_aligned_average_position(&mg);
+	CHECK(fabs(aligned - 1200) < 1e-9, "average with a motor unplugged %f",
+	      aligned);
+	test_motors[1].unplugged = true;
+	test_motors[3].unplugged = true;
+	aligned = rgt_mg_get_aligned_average_position(&mg);
+	CHECK(aligned == PROS_ERR_F, "average with every motor unplugged %f",
+	      aligned);
+}
+
+static void test_units_cache(void) {
+	test_reset();
+	const rgt_motor_group ports = {-1, 2, -3};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+
+	// Counts on a 36:1 cartridge are 1800 per revolution, or 6 per ms at
+	// 200 RPM
+	rgt_mg_set_gearing(&mg, E_MOTOR_GEARSET_36);
+	rgt_mg_set_encoder_units(&mg, E_MOTOR_ENCODER_COUNTS);
+	sample(-1, 5940, 200, 990);
+	sample(2, 5970, 200, 995);
+	sample(-3, 6000, 200, 1000);
+
+	double aligned = 0;
+	for (int k = 0; k < 100; k++)
+		aligned = rgt_mg_get_aligned_average_position(&mg);
+	CHECK(fabs(aligned - 6000) < 1e-9, "aligned average in counts %f",
+	      aligned);
+	// The units and gearing are read once, not on every sample
+	for (int8_t port = 1; port <= 3; port++)
+		CHECK(test_motors[port].config_reads <= 2,
+		      "port %d read its units %u times", port,
+		      test_motors[port].config_reads);
+
+	// Changing the units through the group takes effect on the next sample
+	rgt_mg_set_encoder_units(&mg, E_MOTOR_ENCODER_DEGREES);
+	sample(-1, 1188, 200, 990);
+	sample(2, 1194, 200, 995);
+	sample(-3, 1200, 200, 1000);
+	aligned = rgt_mg_get_aligned_average_position(&mg);
+	CHECK(fabs(aligned - 1200) < 1e-9, "aligned average after a units "
+	                                   "change %f",
+	      aligned);
+}
+
+static void test_current_balance(void) {
+	test_reset();
+	static Rgt_MG_Output output = {
+	    .balance_current = true,
+	    .balance_band = 100,
+	    .balance_gain = 0.5,
+	    .balance_max_trim = 1000,
+	};
+	const rgt_motor_group ports = {-1, 2, -3};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	rgt_mg_set_output(&mg, &output);
+
+	// Motor 1 works harder than motor 3, and motor 2 can't be read
+	test_motors[1].current_draw = 1800;
+	test_motors[2].unplugged = true;
+	test_motors[3].current_draw = 1200;
+	for (int k = 0; k < 20; k++)
+		rgt_mg_move_voltage(&mg, 6000);
+
+	double *trims = output.balance_trims;
+	CHECK(trims[1] == 0, "unplugged motor trimmed by %f", trims[1]);
+	CHECK(trims[0] < 0 && trims[2] > 0, "trims %f and %f", trims[0],
+	      trims[2]);
+	CHECK(fabs(trims[0] + trims[2]) < 1e-9, "trims %f and %f not centered",
+	      trims[0], trims[2]);
+	// The simulated currents don't respond, so the trims run to their limit
+	CHECK(fabs(trims[0]) <= output.balance_max_trim, "trim %f over its limit",
+	      trims[0]);
+	// Both motors are reversed, so their commands are negated
+	CHECK(-test_motors[1].command == 6000 + trims[0] &&
+	          -test_motors[3].command == 6000 + trims[2],
+	      "commands %d and %d", test_motors[1].command,
+	      test_motors[3].command);
+
+	// Once it's back, the motor's trim picks up where it left off
+	test_motors[2].unplugged = false;
+	test_motors[2].current_draw = 1500;
+	rgt_mg_move_voltage(&mg, 6000);
+	CHECK(fabs(trims[0] + trims[1] + trims[2]) < 1e-9,
+	      "trims %f, %f and %f not centered", trims[0], trims[1], trims[2]);
+}
+
+static void test_snapshot(void) {
+	test_reset();
+	const rgt_motor_group ports = {-1, 2, -3};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	for (int8_t port = 1; port <= 3; port++) {
+		sample(port == 2 ? 2 : -port, 100 * port, 10 * port, 1000);
+		test_motors[port].current_draw = 1000 * port;
+		test_motors[port].temperature = 30 + port;
+	}
+
+	// Motor 2 can't be read, so it is left out of every aggregate
+	test_motors[2].unplugged = true;
+	Rgt_Motor_Group_Snapshot snapshot;
+	int32_t ret = rgt_mg_snapshot(&mg, &snapshot);
+	CHECK(ret == PROS_ERR, "snapshot returned %d", ret);
+	CHECK(snapshot.motors[1].position == PROS_ERR_F,
+	      "unplugged motor read %f", snapshot.motors[1].position);
+	CHECK(snapshot.average_position == 200 &&
+	          snapshot.average_velocity == 20,
+	      "averaged %f and %f RPM", snapshot.average_position,
+	      snapshot.average_velocity);
+	CHECK(snapshot.average_current_draw == 2000,
+	      "averaged %f mA", snapshot.average_current_draw);
+	CHECK(snapshot.max_temperature == 33, "hottest motor %f",
+	      snapshot.max_temperature);
+
+	test_motors[1].unplugged = true;
+	test_motors[3].unplugged = true;
+	rgt_mg_snapshot(&mg, &snapshot);
+	CHECK(snapshot.average_position == PROS_ERR_F &&
+	          snapshot.average_current_draw == PROS_ERR_F &&
+	          snapshot.max_temperature == PROS_ERR_F,
+	      "no motors averaged %f and %f mA, hottest %f",
+	      snapshot.average_position, snapshot.average_current_draw,
+	      snapshot.max_temperature);
+}
+
+static void test_slew(void) {
+	test_reset();
+	static Rgt_MG_Output output = {.max_slew = 1000};
+	const rgt_motor_group ports = {1, -2};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	rgt_mg_set_output(&mg, &output);
+
+	// A step ramps at exactly max_slew, and stops on the target
+	for (int k = 1; k <= 14; k++) {
+		rgt_mg_move_voltage(&mg, 12000);
+		int32_t expected = k < 12 ? 1000 * k : 12000;
+		CHECK(test_motors[1].command == expected &&
+		          test_motors[2].command == -expected,
+		      "command %d ramped to %d and %d mV", k, test_motors[1].command,
+		      test_motors[2].command);
+	}
+	CHECK(output.stats.commands == 14 && output.stats.slew_limited == 11 &&
+	          output.stats.jerk_limited == 0,
+	      "%u commands, %u slew and %u jerk limited", output.stats.commands,
+	      output.stats.slew_limited, output.stats.jerk_limited);
+}
+
+/**
+ * Steps a jerk limited output from its current value to target, and checks
+ * that it gets there without ever changing its rate by more than max_jerk or
+ * going past the target
+ */
+static void check_jerk_step(Rgt_Motor_Group *mg, int32_t target) {
+	Rgt_MG_Output *o = mg->output;
+	double start = o->slew_output;
+	double direction = target > start ? 1 : -1;
+	double last_rate = o->slew_rate;
+	double worst_jerk = 0, worst_slew = 0, overshoot = 0;
+
+	for (int k = 0; k < 100; k++) {
+		rgt_mg_move_voltage(mg, target);
+		worst_jerk = fmax(worst_jerk, fabs(o->slew_rate - last_rate));
+		worst_slew = fmax(worst_slew, fabs(o->slew_rate));
+		overshoot = fmax(overshoot, direction * (o->slew_output - target));
+		last_rate = o->slew_rate;
+	}
+	CHECK(worst_jerk <= o->max_jerk + 1e-9,
+	      "%.0f to %d: rate changed by %f", start, target, worst_jerk);
+	CHECK(worst_slew <= o->max_slew + 1e-9, "%.0f to %d: rate of %f", start,
+	      target, worst_slew);
+	CHECK(overshoot <= 0, "%.0f to %d: overshot by %f", start, target,
+	      overshoot);
+	CHECK(test_motors[1].command == target, "%.0f to %d: ended at %d", start,
+	      target, test_motors[1].command);
+}
+
+static void test_jerk(void) {
+	const int32_t jerks[] = {200, 300, 700};
+	const int32_t targets[] = {12000, 7777, 150, -9001};
+	for (int j = 0; j < 3; j++) {
+		test_reset();
+		static Rgt_MG_Output output;
+		output = (Rgt_MG_Output){.max_slew = 1000, .max_jerk = jerks[j]};
+		const rgt_motor_group ports = {1, -2};
+		Rgt_Motor_Group mg = rgt_mg_init(ports);
+		rgt_mg_set_output(&mg, &output);
+
+		for (int t = 0; t < 4; t++)
+			check_jerk_step(&mg, targets[t]);
+		check_jerk_step(&mg, 0);
+		CHECK(output.stats.jerk_limited > 0, "never jerk limited");
+	}
+}
+
+// Reads the battery until the filter has settled on its voltage
+static double settle_battery(int32_t voltage) {
+	test_set_battery_voltage(voltage);
+	for (int k = 0; k < 80; k++) {
+		rgt_mg_get_battery_voltage();
+		test_advance_ms(RGT_MG_BATTERY_UPDATE_INTERVAL);
+	}
+	return rgt_mg_get_battery_voltage();
+}
+
+static void test_battery_compensation(void) {
+	test_reset();
+	const rgt_motor_group ports = {1, -2};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	rgt_mg_set_battery_compensation(true);
+
+	// 12800 / 9600 scales commands by 4/3
+	double battery = settle_battery(9600);
+	CHECK(fabs(battery - 9600) < 1, "filtered to %f mV", battery);
+	rgt_mg_move_voltage(&mg, 6000);
+	CHECK(abs(test_motors[1].command - 8000) <= 1 &&
+	          abs(test_motors[2].command + 8000) <= 1,
+	      "compensated to %d and %d mV", test_motors[1].command,
+	      test_motors[2].command);
+
+	// Commands are still limited to the motors' range
+	rgt_mg_move_voltage(&mg, 10000);
+	CHECK(test_motors[1].command == 12000 && test_motors[2].command == -12000,
+	      "compensated to %d and %d mV", test_motors[1].command,
+	      test_motors[2].command);
+	rgt_mg_move_voltage(&mg, -10000);
+	CHECK(test_motors[1].command == -12000,
+	      "compensated to %d mV", test_motors[1].command);
+	rgt_mg_move(&mg, 100);
+	CHECK(test_motors[1].command == 127, "compensated to %d",
+	      test_motors[1].command);
+
+	// A nearly flat battery only scales commands by RGT_MG_MAX_BATTERY_SCALE
+	settle_battery(6000);
+	rgt_mg_move_voltage(&mg, 4000);
+	CHECK(test_motors[1].command == 6000, "compensated to %d mV",
+	      test_motors[1].command);
+
+	settle_battery(RGT_MG_NOMINAL_BATTERY_VOLTAGE);
+	rgt_mg_set_battery_compensation(false);
+}
+
+#define BATTERY_THREADS 4
+#define BATTERY_CALLS 20000
+
+// Reads the battery while moving the clock, like several tasks sending commands
+static void *battery_reader(void *arg) {
+	bool *rose = arg;
+	double last = rgt_mg_get_battery_voltage();
+	for (int k = 0; k < BATTERY_CALLS; k++) {
+		test_advance_us(100);
+		double battery = rgt_mg_get_battery_voltage();
+		// The battery only sagged, so the filter never moves back up
+		if (battery > last || battery < 9600)
+			*rose = true;
+		last = battery;
+	}
+	return NULL;
+}
+
+static void test_battery_threads(void) {
+	test_reset();
+	settle_battery(RGT_MG_NOMINAL_BATTERY_VOLTAGE);
+	test_set_battery_voltage(9600);
+	test_battery_reads = 0;
+	uint64_t start = test_time_us();
+
+	pthread_t threads[BATTERY_THREADS];
+	bool rose[BATTERY_THREADS] = {false};
+	for (int t = 0; t < BATTERY_THREADS; t++)
+		pthread_create(&threads[t], NULL, battery_reader, &rose[t]);
+	for (int t = 0; t < BATTERY_THREADS; t++)
+		pthread_join(threads[t], NULL);
+
+	// Only one task updates the filter each interval
+	uint64_t intervals = (test_time_us() - start) /
+	                     (RGT_MG_BATTERY_UPDATE_INTERVAL * 1000);
+	CHECK(test_battery_reads <= intervals + 1,
+	      "%u battery reads over %llu intervals", test_battery_reads,
+	      (unsigned long long)intervals);
+	for (int t = 0; t < BATTERY_THREADS; t++)
+		CHECK(!rose[t], "thread %d saw the filter move the wrong way", t);
+
+	settle_battery(RGT_MG_NOMINAL_BATTERY_VOLTAGE);
+}
+
+int main(void) {
+	test_skewed_encoders();
+	test_units_cache();
+	test_current_balance();
+	test_snapshot();
+	test_slew();
+	test_jerk();
+	test_battery_compensation();
+	test_battery_threads();
+	return test_summary("test_motor_group");
+}
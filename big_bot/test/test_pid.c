@@ -0,0 +1,237 @@
+#include "test.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file test_pid.c
+ *
+ * @brief Step responses and unit checks for Rgt_PID
+ */
+
+// The controller period, in ms
+#define PERIOD 10
+
+/**
+ * A motor-driven mechanism whose velocity follows the voltage with a
+ * first-order lag (80 ms), at 0.1 deg/s per mV. There is no standing load, so
+ * any difference between forward and reverse moves comes from the controller.
+ */
+typedef struct {
+	double position;
+	double velocity;
+} Plant;
+
+static void plant_update(Plant *p, double voltage) {
+	double free_velocity = voltage / 12000 * 1200;
+	p->velocity += (free_velocity - p->velocity) * 0.125;
+	p->position += p->velocity * PERIOD / 1000.0;
+}
+
+// The result of a step response
+typedef struct {
+	double overshoot; // How far past the target the mechanism went
+	int settle;       // Time (ms) until it stayed within 5, or -1 if never
+	double final;     // The final error
+} Step;
+
+// The old drivetrain rule: only a large positive error clears the integral
+static double legacy_integral;
+static double legacy_prev_error;
+
+static double legacy(double target, double current) {
+	double error = target - current;
+	double output = pid(error, 20, 2, 5, &legacy_integral, legacy_prev_error,
+	                    error > 50);
+	legacy_prev_error = error;
+	return output;
+}
+
+// The drivetrain's configuration
+static Rgt_PID drive_pid(void) {
+	Rgt_PID p = rgt_pid_init(20, 2, 5);
+	p.integral_zone = 50;
+	p.reset_on_sign_change = true;
+	p.derivative_on_measurement = true;
+	p.derivative_filter = 2;
+	p.nominal_period = PERIOD;
+	return p;
+}
+
+// Runs a 10 s step from 0 to target, with p, or the legacy rule if p is NULL
+static Step step(Rgt_PID *p, double target) {
+	Plant plant = {0, 0};
+	Step s = {0, -1, 0};
+	legacy_integral = 0;
+	legacy_prev_error = 0;
+	test_reset();
+
+	for (int t = 0; t < 10000; t += PERIOD) {
+		double voltage =
+		    p != NULL ? rgt_pid_calculate_measured(p, target, plant.position,
+		                                           false)
+		              : legacy(target, plant.position);
+		if (fabs(voltage) > 12000)
+			voltage = copysign(12000, voltage);
+		plant_update(&plant, voltage);
+		test_advance_ms(PERIOD);
+
+		double error = target - plant.position;
+		double past = target > 0 ? -error : error;
+		if (past > s.overshoot)
+			s.overshoot = past;
+		if (fabs(error) > 5)
+			s.settle = -1;
+		else if (s.settle < 0)
+			s.settle = t + PERIOD;
+	}
+	s.final = target - plant.position;
+	return s;
+}
+
+static void test_step_responses(void) {
+	for (int direction = -1; direction <= 1; direction += 2) {
+		double target = direction * 1000;
+		Rgt_PID p = drive_pid();
+		Step s = step(&p, target);
+		Step old = step(NULL, target);
+		printf("step %+5.0f: Rgt_PID overshoot %.1f settle %d ms, legacy "
+		       "overshoot %.1f settle %d ms\n",
+		       target, s.overshoot, s.settle, old.overshoot, old.settle);
+
+		CHECK(s.settle >= 0 && s.settle <= 4000, "step %+.0f settled at %d",
+		      target, s.settle);
+		CHECK(s.overshoot < 50, "step %+.0f overshot by %.1f", target,
+		      s.overshoot);
+		CHECK(fabs(s.final) < 5, "step %+.0f ended %.1f off", target,
+		      s.final);
+		CHECK(s.overshoot < old.overshoot,
+		      "step %+.0f overshot %.1f, legacy only %.1f", target,
+		      s.overshoot, old.overshoot);
+	}
+}
+
+static void test_integral(void) {
+	// The zone is symmetric - large negative errors don't accumulate either
+	Rgt_PID p = rgt_pid_init(0, 1, 0);
+	p.integral_zone = 50;
+	rgt_pid_calculate(&p, 40, false);
+	rgt_pid_calculate(&p, -60, false);
+	CHECK(p.integral == 0, "integral %.1f outside the zone", p.integral);
+
+	p = rgt_pid_init(0, 1, 0);
+	p.integral_limit = 100;
+	for (int k = 0; k < 1000; k++)
+		rgt_pid_calculate(&p, 10, false);
+	CHECK(fabs(p.kI * p.integral) <= 100, "integral term %.1f over its limit",
+	      p.kI * p.integral);
+
+	p = rgt_pid_init(0, 1, 0);
+	p.reset_on_sign_change = true;
+	rgt_pid_calculate(&p, 10, false);
+	rgt_pid_calculate(&p, 10, false);
+	rgt_pid_calculate(&p, -1, false);
+	CHECK(p.integral == 0, "integral %.1f after the target was crossed",
+	      p.integral);
+}
+
+static void test_saturation(void) {
+	Rgt_PID p = rgt_pid_init(100, 10, 0);
+	double output = 0;
+	for (int k = 0; k < 100; k++)
+		output = rgt_pid_calculate(&p, 500, false);
+	CHECK(output == RGT_PID_MAX_OUTPUT, "output %.0f not saturated", output);
+	// Back-calculation keeps the integral from winding up while saturated, and
+	// never unwinds it past 0
+	CHECK(p.integral >= 0 && p.kI * p.integral <= RGT_PID_MAX_OUTPUT,
+	      "integral term %.0f wound up", p.kI * p.integral);
+
+	p = rgt_pid_init(100, 10, 0);
+	for (int k = 0; k < 100; k++)
+		output = rgt_pid_calculate(&p, -500, false);
+	CHECK(output == -RGT_PID_MAX_OUTPUT, "output %.0f not saturated", output);
+	CHECK(p.integral <= 0 && p.kI * p.integral >= -RGT_PID_MAX_OUTPUT,
+	      "integral term %.0f wound up", p.kI * p.integral);
+}
+
+static void test_derivative(void) {
+	// A new target kicks a derivative of the error, but not of the measurement
+	Rgt_PID error_d = rgt_pid_init(0, 0, 5);
+	Rgt_PID measurement_d = error_d;
+	measurement_d.derivative_on_measurement = true;
+	rgt_pid_calculate_measured(&error_d, 0, 0, false);
+	rgt_pid_calculate_measured(&measurement_d, 0, 0, false);
+	CHECK(rgt_pid_calculate_measured(&error_d, 100, 0, false) == 500,
+	      "no kick from the error's derivative");
+	CHECK(rgt_pid_calculate_measured(&measurement_d, 100, 0, false) == 0,
+	      "kick from the measurement's derivative");
+
+	// Filtering cuts the noise on a measurement moving 10 per update
+	double noise[2];
+	for (int f = 0; f < 2; f++) {
+		Rgt_PID p = rgt_pid_init(0, 0, 5);
+		p.derivative_on_measurement = true;
+		p.derivative_filter = f * 2;
+		double sum = 0, squares = 0;
+		srand(1);
+		for (int k = 0; k < 2000; k++) {
+			double m = 10 * k + (rand() % 601 - 300) / 100.0;
+			double d = rgt_pid_calculate_measured(&p, 0, m, false);
+			if (k > 100) {
+				sum += d;
+				squares += d * d;
+			}
+		}
+		double mean = sum / 1899;
+		noise[f] = sqrt(squares / 1899 - mean * mean);
+		CHECK(fabs(mean + 50) < 1, "derivative mean %.1f, not -50", mean);
+	}
+	CHECK(noise[1] < noise[0] / 2, "filtered noise %.1f, unfiltered %.1f",
+	      noise[1], noise[0]);
+
+	// With a nominal period, a late update gives the same derivative
+	test_reset();
+	Rgt_PID p = rgt_pid_init(0, 0, 1);
+	p.derivative_on_measurement = true;
+	p.nominal_period = PERIOD;
+	rgt_pid_calculate_measured(&p, 0, 0, false);
+	test_advance_ms(PERIOD);
+	double on_time = rgt_pid_calculate_measured(&p, 0, 10, false);
+	test_advance_ms(2 * PERIOD);
+	double late = rgt_pid_calculate_measured(&p, 0, 30, false);
+	CHECK(fabs(on_time - late) < 1e-9, "derivative %.2f late, %.2f on time",
+	      late, on_time);
+}
+
+// With the defaults, Rgt_PID is pid with its output clamped
+static void test_matches_pid(void) {
+	Rgt_PID p = rgt_pid_init(3, 0.5, 2);
+	double integral = 0, prev_error = 0, worst = 0;
+	srand(2);
+	for (int k = 0; k < 1000; k++) {
+		double error = rand() % 2001 - 1000;
+		double expected = pid(error, 3, 0.5, 2, &integral, prev_error, false);
+		prev_error = error;
+		if (fabs(expected) > RGT_PID_MAX_OUTPUT)
+			expected = copysign(RGT_PID_MAX_OUTPUT, expected);
+		double diff = fabs(rgt_pid_calculate(&p, error, false) - expected);
+		if (diff > worst)
+			worst = diff;
+		// Unsaturated, the integrals agree, so keep them in step
+		integral = p.integral;
+	}
+	CHECK(worst < 1e-9, "differs from pid by %g", worst);
+}
+
+int main(void) {
+	test_step_responses();
+	test_integral();
+	test_saturation();
+	test_derivative();
+	test_matches_pid();
+	return test_summary("test_pid");
+}
@@ -0,0 +1,113 @@
+#include "test.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file test_pid_batch.c
+ *
+ * @brief Checks that rgt_pid_batch_calculate matches the scalar path and pid
+ *
+ * @details The Makefile builds this twice: natively, and as test_pid_batch_neon
+ * with the NEON path compiled against the stand-in intrinsics in neon/.
+ */
+
+// Not a multiple of 4, so the NEON build runs its scalar tail too
+#define CONTROLLERS 13
+#define STEPS 2000
+
+// A repeatable pseudo-random float from -range to range
+static float random_error(uint32_t *seed, float range) {
+	*seed = *seed * 1664525 + 1013904223;
+	return ((float)(*seed >> 8) / (1 << 24) * 2 - 1) * range;
+}
+
+// Whether two outputs are the same to within float rounding
+static bool close(float a, float b) {
+	return fabsf(a - b) <= 1e-5f * fmaxf(1, fmaxf(fabsf(a), fabsf(b)));
+}
+
+static void test_neon_matches_scalar(void) {
+	Rgt_PID_Batch vector = {0}, scalar = {0};
+	for (int c = 0; c < CONTROLLERS; c++) {
+		// Some gains saturate the output, some don't
+		float kP = 5 + 3 * c, kI = 0.05f * (c % 4), kD = 2 * (c % 3);
+		rgt_pid_batch_add(&vector, kP, kI, kD);
+		rgt_pid_batch_add(&scalar, kP, kI, kD);
+	}
+	vector.output_limit[2] = scalar.output_limit[2] = INFINITY;
+
+	uint32_t seed = 1;
+	int mismatches = 0;
+	for (int k = 0; k < STEPS; k++) {
+		float errors[CONTROLLERS], a[CONTROLLERS], b[CONTROLLERS];
+		for (int c = 0; c < CONTROLLERS; c++)
+			errors[c] = random_error(&seed, 1000);
+		// The same controller reset on both, mid-run
+		if (k == STEPS / 2) {
+			rgt_pid_batch_reset(&vector, 5);
+			rgt_pid_batch_reset(&scalar, 5);
+		}
+
+		rgt_pid_batch_calculate(&vector, errors, a);
+		rgt_pid_batch_calculate_scalar(&scalar, errors, b);
+		for (int c = 0; c < CONTROLLERS; c++) {
+			if (!close(a[c], b[c]) ||
+			    !close(vector.integral[c], scalar.integral[c])) {
+				if (mismatches++ < 5)
+					printf("step %d controller %d: %f, scalar %f\n", k, c, a[c],
+					       b[c]);
+			}
+		}
+	}
+	CHECK(mismatches == 0, "%d outputs differ from the scalar path",
+	      mismatches);
+}
+
+static void test_matches_pid(void) {
+	Rgt_PID_Batch b = {0};
+	rgt_pid_batch_add(&b, 20, 2, 5);
+	rgt_pid_batch_add(&b, 0.5f, 0.01f, 0);
+	rgt_pid_batch_add(&b, 100, 0, 40);
+	rgt_pid_batch_add(&b, 8, 0.5f, 1);
+	rgt_pid_batch_add(&b, 3, 0, 0);
+	double integrals[5] = {0}, prev_errors[5] = {0};
+
+	uint32_t seed = 7;
+	bool within = true, limited = true;
+	for (int k = 0; k < 500; k++) {
+		float errors[5], outputs[5];
+		for (int c = 0; c < 5; c++)
+			errors[c] = random_error(&seed, 200);
+		rgt_pid_batch_calculate(&b, errors, outputs);
+
+		for (int c = 0; c < 5; c++) {
+			double expected = pid(errors[c], b.kP[c], b.kI[c], b.kD[c],
+			                      &integrals[c], prev_errors[c], false);
+			prev_errors[c] = errors[c];
+			if (fabs(expected) > RGT_PID_MAX_OUTPUT)
+				expected = copysign(RGT_PID_MAX_OUTPUT, expected);
+			// Single precision, so relative to the terms' size
+			if (fabs(outputs[c] - expected) > 1e-4 * (1 + fabs(expected)))
+				within = false;
+			if (fabsf(outputs[c]) > RGT_PID_MAX_OUTPUT)
+				limited = false;
+		}
+	}
+	CHECK(within, "batch outputs differ from pid");
+	CHECK(limited, "batch outputs over RGT_PID_MAX_OUTPUT");
+}
+
+int main(void) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const char *name = "test_pid_batch_neon";
+#else
+	const char *name = "test_pid_batch";
+#endif
+	test_neon_matches_scalar();
+	test_matches_pid();
+	return test_summary(name);
+}
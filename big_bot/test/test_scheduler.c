@@ -0,0 +1,176 @@
+#include "test.h"
+
+#include "ringtail/controller.h"
+#include "ringtail/scheduler.h"
+
+#include "pros/rtos.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file test_scheduler.c
+ *
+ * @brief Checks for the scheduler's registration, dividers and stats, and a
+ * stress test of reading the stats while it runs
+ */
+
+// How long (us) each controller's sensor read takes, and how many ran
+static uint32_t sensor_time = 100;
+static uint32_t fast_runs, slow_runs, coupled_runs;
+
+static double read_fast(void) {
+	test_advance_us(sensor_time);
+	fast_runs++;
+	return 0;
+}
+
+static double read_slow(void) {
+	test_advance_us(sensor_time);
+	slow_runs++;
+	return 0;
+}
+
+static void read_coupled(void *context, double *values) {
+	(void)context;
+	test_advance_us(sensor_time);
+	coupled_runs++;
+	values[0] = 0;
+}
+
+static double hold(double target, double current, bool reset) {
+	(void)target;
+	(void)current;
+	(void)reset;
+	return 0;
+}
+
+static void hold_coupled(void *context, const double *targets,
+                         const double *values, bool reset, double *voltages) {
+	(void)context;
+	(void)targets;
+	(void)values;
+	(void)reset;
+	voltages[0] = 0;
+}
+
+static Rgt_Motor_Group mg;
+static Rgt_Controller_Info fast, slow;
+static Rgt_Coupled_Controller coupled;
+
+static void test_schedule(void) {
+	test_reset();
+	const rgt_motor_group ports = {1};
+	mg = rgt_mg_init(ports);
+	fast = rgt_controller_info_init(&mg, read_fast, hold, NULL, 5, 4);
+	slow = rgt_controller_info_init(&mg, read_slow, hold, NULL, 5, 4);
+	const Rgt_Motor_Group *const mgs[] = {&mg};
+	const double thresholds[] = {5};
+	coupled = rgt_coupled_controller_init(mgs, 1, 1, read_coupled, NULL,
+	                                      hold_coupled, NULL, thresholds, 4);
+	rgt_scheduler_start(10, TASK_PRIORITY_DEFAULT, TASK_STACK_DEPTH_DEFAULT);
+
+	CHECK(rgt_scheduler_add(&fast, 1), "couldn't add a controller");
+	CHECK(!rgt_scheduler_add(&fast, 2), "added a controller twice");
+	CHECK(!rgt_scheduler_add(&slow, 0), "added a controller with divider 0");
+	CHECK(rgt_scheduler_add(&slow, 2), "couldn't add a controller");
+	CHECK(rgt_scheduler_add_coupled(&coupled, 1),
+	      "couldn't add a coupled controller");
+	CHECK(!rgt_scheduler_add_coupled(&coupled, 1),
+	      "added a coupled controller twice");
+
+	for (int k = 0; k < 4; k++)
+		rgt_scheduler_step();
+	CHECK(fast_runs == 4 && slow_runs == 2 && coupled_runs == 4,
+	      "ran %u, %u and %u times", fast_runs, slow_runs, coupled_runs);
+
+	// Only the controllers moved the clock, so the scheduler itself took no
+	// time, and saved 150 wakeups a second
+	Rgt_Scheduler_Stats s = rgt_scheduler_get_stats();
+	CHECK(s.cycles == 4 && s.controllers == 3, "%u cycles of %u controllers",
+	      s.cycles, s.controllers);
+	CHECK(s.last_busy_time == 200 && s.max_busy_time == 300 &&
+	          s.mean_busy_time == 250,
+	      "busy for %u, max %u, mean %f us", s.last_busy_time,
+	      s.max_busy_time, s.mean_busy_time);
+	CHECK(s.last_overhead_time == 0 && s.mean_overhead_time == 0,
+	      "overhead of %u, mean %f us", s.last_overhead_time,
+	      s.mean_overhead_time);
+	CHECK(s.wakeups_saved == 150 &&
+	          s.time_saved == 150 * RGT_SCHEDULER_WAKEUP_TIME,
+	      "saved %d wakeups and %d us a second", s.wakeups_saved,
+	      s.time_saved);
+}
+
+/*******************************************************************************
+ *                                 Stress Test                                 *
+ ******************************************************************************/
+
+#define STRESS_CYCLES 200000
+
+static bool done;
+static uint32_t start_cycles;
+
+// The fast controller's sensor time (us) in the scheduler's n-th cycle
+static uint32_t stress_busy(uint32_t n) { return n % 13 + 1; }
+
+static void *stress_loop(void *arg) {
+	(void)arg;
+	for (uint32_t k = 0; k < STRESS_CYCLES; k++) {
+		sensor_time = stress_busy(start_cycles + k + 1);
+		rgt_scheduler_step();
+		if (k % 64 == 0)
+			sched_yield();
+	}
+	__atomic_store_n(&done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *stress_reader(void *arg) {
+	(void)arg;
+	uint32_t last_cycles = 0;
+	while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		// The busy time is a function of the cycle, so a snapshot mixing two
+		// cycles doesn't match
+		Rgt_Scheduler_Stats s = rgt_scheduler_get_stats();
+		bool consistent = s.cycles >= last_cycles &&
+		                  s.last_busy_time == stress_busy(s.cycles);
+		if (!consistent) {
+			CHECK(consistent, "stats snapshot: %u cycles (was %u), busy %u",
+			      s.cycles, last_cycles, s.last_busy_time);
+			break;
+		}
+		last_cycles = s.cycles;
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void test_stress(void) {
+	// Only the fast controller runs, so each cycle's busy time is its sensor's
+	rgt_scheduler_set_enabled(&slow, false);
+	rgt_scheduler_set_enabled(&coupled, false);
+	sensor_time = stress_busy(rgt_scheduler_get_stats().cycles + 1);
+	rgt_scheduler_step();
+	start_cycles = rgt_scheduler_get_stats().cycles;
+
+	pthread_t loop, readers[2];
+	pthread_create(&loop, NULL, stress_loop, NULL);
+	pthread_create(&readers[0], NULL, stress_reader, NULL);
+	pthread_create(&readers[1], NULL, stress_reader, NULL);
+	pthread_join(loop, NULL);
+	pthread_join(readers[0], NULL);
+	pthread_join(readers[1], NULL);
+
+	Rgt_Scheduler_Stats s = rgt_scheduler_get_stats();
+	CHECK(s.cycles == start_cycles + STRESS_CYCLES, "ran %u cycles",
+	      s.cycles - start_cycles);
+}
+
+int main(void) {
+	test_schedule();
+	test_stress();
+	return test_summary("test_scheduler");
+}
@@ -0,0 +1,243 @@
+#include "test.h"
+
+#include "ringtail/controller.h"
+#include "ringtail/reference_controllers.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file test_tbh.c
+ *
+ * @brief Runs Rgt_TBH as a controller on a simulated conveyor motor, and
+ * checks its first-crossing guess, clamping, at-speed hysteresis, and stopping
+ */
+
+// The controller's period, in ms
+#define PERIOD 10
+
+// The conveyor's gains - 12 V over the 200 RPM free speed
+#define GUESS_GAIN (12000.0 / 200)
+#define KH 3
+
+// A repeatable pseudo-random value from -range to range
+static double random_value(uint32_t *seed, double range) {
+	*seed = *seed * 1664525 + 1013904223;
+	return ((double)(*seed >> 8) / (1 << 24) * 2 - 1) * range;
+}
+
+/**
+ * A green cartridge motor on port 1: its velocity approaches 200 RPM at
+ * 12000 mV, less the load, with a time constant of 150 ms. The reading has
+ * noise of up to noise RPM.
+ */
+typedef struct {
+	double velocity;
+	double load; // RPM lost to the load at any voltage
+	double noise;
+	uint32_t seed;
+} Conveyor;
+
+// Runs one controller cycle on the conveyor, and returns the voltage it used
+static double conveyor_step(Conveyor *c, Rgt_Controller_Info *i) {
+	test_motors[1].velocity = c->velocity + random_value(&c->seed, c->noise);
+	rgt_controller_step(i);
+	double voltage = test_motors[1].command;
+	double free_speed = voltage / GUESS_GAIN - c->load;
+	c->velocity += (free_speed - c->velocity) * PERIOD / 150;
+	test_advance_ms(PERIOD);
+	return voltage;
+}
+
+static void test_first_crossing(void) {
+	test_reset();
+	const rgt_motor_group ports = {1};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	Rgt_TBH t = rgt_tbh_init(&mg, KH, GUESS_GAIN);
+	Rgt_Controller_Info i = rgt_controller_info_init_ctx(
+	    &mg, rgt_tbh_get_sensor_data, &t, rgt_tbh_controller, &t, NULL,
+	    t.at_speed_threshold, 5);
+	Conveyor c = {0};
+
+	// The output saturates on the way up, then jumps to the guess on the
+	// first crossing instead of halving towards 0
+	rgt_controller_set_target(&i, 160);
+	int crossings = 0, k = 0;
+	bool below = true;
+	for (; k < 300 && crossings < 2; k++) {
+		double voltage = conveyor_step(&c, &i);
+		if (below == (test_motors[1].velocity < 160))
+			continue;
+		below = !below;
+		crossings++;
+		if (crossings == 1)
+			CHECK(voltage == 160 * GUESS_GAIN && t.tbh == voltage,
+			      "first crossing output %g, tbh %g", voltage, t.tbh);
+		else
+			// Later crossings take back half as tbh() does
+			CHECK(t.output == t.tbh && voltage < 160 * GUESS_GAIN,
+			      "second crossing output %g, tbh %g", voltage, t.tbh);
+	}
+	CHECK(crossings == 2, "crossed the target %d times", crossings);
+
+	// The guess is the no-load voltage, so it settles on the target
+	for (; k < 300; k++)
+		conveyor_step(&c, &i);
+	CHECK(fabs(c.velocity - 160) < 1, "settled at %g RPM", c.velocity);
+	CHECK(rgt_tbh_at_speed(&t) && rgt_controller_at_target(&i),
+	      "not at speed after settling");
+
+	// A new target guesses again on its own first crossing
+	rgt_controller_set_target(&i, 100);
+	bool guessed = false;
+	for (k = 0; k < 100 && !guessed; k++) {
+		double voltage = conveyor_step(&c, &i);
+		if (test_motors[1].velocity < 100) {
+			guessed = true;
+			CHECK(voltage == 100 * GUESS_GAIN, "new target crossed at %g",
+			      voltage);
+		}
+	}
+	CHECK(guessed, "never crossed the new target");
+
+	// Under a 40 RPM load the integral pushes past the guess to hold speed
+	for (k = 0; k < 300; k++)
+		conveyor_step(&c, &i);
+	c.load = 40;
+	double slowest = c.velocity;
+	for (k = 0; k < 200; k++) {
+		conveyor_step(&c, &i);
+		if (c.velocity < slowest)
+			slowest = c.velocity;
+	}
+	printf("tbh: load step dipped to %.1f RPM, recovered to %.1f RPM\n",
+	       slowest, c.velocity);
+	CHECK(slowest < 95 && fabs(c.velocity - 100) < 2,
+	      "dipped to %g, held %g RPM under load", slowest, c.velocity);
+}
+
+static void test_clamping(void) {
+	test_reset();
+	Rgt_TBH t = rgt_tbh_init(NULL, 50, GUESS_GAIN);
+	t.output_limit = 6000;
+
+	// A target the limit can't reach integrates up to the limit and no further
+	for (int k = 0; k < 50; k++)
+		rgt_tbh_calculate(&t, 160, 50);
+	CHECK(t.output == 6000, "output %g past the limit", t.output);
+
+	// The guess of 9600 mV is past the limit, so it is clamped too, and tbh
+	// with it - otherwise the next take back half would head back past it
+	double output = rgt_tbh_calculate(&t, 160, 170);
+	CHECK(output == 6000 && t.tbh == 6000, "guess clamped to %g, tbh %g",
+	      output, t.tbh);
+
+	// The same going the other way, and while crossing back and forth
+	for (int k = 0; k < 50; k++)
+		output = rgt_tbh_calculate(&t, -160, 0);
+	CHECK(output == -6000, "reversed output %g", output);
+	bool within = true;
+	for (int k = 0; k < 50; k++) {
+		output = rgt_tbh_calculate(&t, -160, k % 10 < 5 ? 0 : -200);
+		if (fabs(output) > 6000 || fabs(t.tbh) > 6000)
+			within = false;
+	}
+	CHECK(within, "crossing output %g, tbh %g", output, t.tbh);
+
+	// Without a limit, the output is whatever the integral reaches
+	Rgt_TBH open = rgt_tbh_init(NULL, 50, 0);
+	open.output_limit = 0;
+	for (int k = 0; k < 50; k++)
+		output = rgt_tbh_calculate(&open, 1000, 0);
+	CHECK(output == 50 * 50 * 1000, "unlimited output %g", output);
+}
+
+static void test_at_speed_hysteresis(void) {
+	test_reset();
+	// A threshold of 5% of 200 RPM, with half that again as hysteresis
+	Rgt_TBH t = rgt_tbh_init(NULL, KH, GUESS_GAIN);
+	CHECK(t.at_speed_threshold == 10 && t.at_speed_hysteresis == 5,
+	      "threshold %g, hysteresis %g", t.at_speed_threshold,
+	      t.at_speed_hysteresis);
+
+	// Set within 10 RPM, and only cleared more than 15 RPM away
+	const double readings[] = {140, 149, 151, 146, 170, 175, 176, 171, 168};
+	const bool expected[] = {false, false, true,  true, true,
+	                         true,  false, false, true};
+	for (int k = 0; k < 9; k++) {
+		rgt_tbh_calculate(&t, 160, readings[k]);
+		CHECK(rgt_tbh_at_speed(&t) == expected[k], "%g RPM gave at_speed %d",
+		      readings[k], rgt_tbh_at_speed(&t));
+	}
+
+	// A reset clears the flag
+	rgt_tbh_reset(&t);
+	CHECK(!rgt_tbh_at_speed(&t), "at_speed survived a reset");
+
+	// Holding speed with noisy readings, the flag doesn't flicker
+	const rgt_motor_group ports = {1};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	t = rgt_tbh_init(&mg, KH, GUESS_GAIN);
+	t.velocity_filter = 2;
+	t.at_speed_threshold = 2;
+	t.at_speed_hysteresis = 2;
+	Rgt_Controller_Info i = rgt_controller_info_init_ctx(
+	    &mg, rgt_tbh_get_sensor_data, &t, rgt_tbh_controller, &t, NULL,
+	    t.at_speed_threshold, 5);
+	Conveyor c = {.noise = 3, .seed = 7};
+	rgt_controller_set_target(&i, 160);
+	for (int k = 0; k < 300; k++)
+		conveyor_step(&c, &i);
+	int flips = 0;
+	bool last = rgt_tbh_at_speed(&t);
+	for (int k = 0; k < 500; k++) {
+		conveyor_step(&c, &i);
+		if (rgt_tbh_at_speed(&t) != last)
+			flips++;
+		last = rgt_tbh_at_speed(&t);
+	}
+	printf("tbh: at_speed changed %d times in 5 s of 3 RPM noise\n", flips);
+	CHECK(last && flips <= 2, "at_speed %d, changed %d times", last, flips);
+}
+
+static void test_stop(void) {
+	test_reset();
+	const rgt_motor_group ports = {1};
+	Rgt_Motor_Group mg = rgt_mg_init(ports);
+	Rgt_TBH t = rgt_tbh_init(&mg, KH, GUESS_GAIN);
+	Rgt_Controller_Info i = rgt_controller_info_init_ctx(
+	    &mg, rgt_tbh_get_sensor_data, &t, rgt_tbh_controller, &t, NULL,
+	    t.at_speed_threshold, 5);
+	Conveyor c = {0};
+	rgt_controller_set_target(&i, 160);
+	for (int k = 0; k < 300; k++)
+		conveyor_step(&c, &i);
+
+	// A target of 0 outputs 0 straight away, and lets the conveyor coast,
+	// rather than driving it backwards to hold it still
+	rgt_controller_set_target(&i, 0);
+	bool zero = true;
+	for (int k = 0; k < 200; k++) {
+		if (conveyor_step(&c, &i) != 0 || t.output != 0 || t.tbh != 0)
+			zero = false;
+	}
+	CHECK(zero, "output %g, tbh %g stopping", t.output, t.tbh);
+	CHECK(fabs(c.velocity) < 1, "still moving at %g RPM", c.velocity);
+
+	// Starting again, the output integrates up from 0
+	rgt_controller_set_target(&i, 160);
+	double voltage = conveyor_step(&c, &i);
+	double expected = KH * (160 - test_motors[1].velocity);
+	CHECK(fabs(voltage - expected) < 1, "restarted at %g mV, expected %g",
+	      voltage, expected);
+}
+
+int main(void) {
+	test_first_crossing();
+	test_clamping();
+	test_at_speed_hysteresis();
+	test_stop();
+	return test_summary("test_tbh");
+}
@@ -0,0 +1,174 @@
+/**
+ * @file autotune.h
+ *
+ * @brief Relay-feedback PID autotuning for Ringtail controllers
+ *
+ * @details The autotuner replaces a controller's feedback with a relay: full
+ * positive voltage below the target, full negative voltage above it. Almost
+ * any mechanism then oscillates steadily around the target, and the size and
+ * period of that oscillation give the mechanism's ultimate gain and period -
+ * the proportional gain at which it would oscillate forever, and how fast. The
+ * classic tuning rules turn those two numbers into PID gains (Astrom and
+ * Hagglund's relay method).
+ *
+ * The autotuner is a calculate_voltage function, so it runs in an ordinary
+ * Ringtail controller or the scheduler. It stops on its own after a set number
+ * of oscillations, after a timeout, or if the mechanism strays too far from
+ * the target, and then outputs 0.
+ */
+
+#ifndef RINGTAIL_AUTOTUNE_H_
+#define RINGTAIL_AUTOTUNE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ringtail/reference_controllers.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The most oscillations an autotune can measure
+#define RGT_AUTOTUNE_MAX_CYCLES 8
+
+typedef enum {
+	// Still oscillating
+	RGT_AUTOTUNE_RUNNING,
+	// Measured every cycle - the result is ready
+	RGT_AUTOTUNE_DONE,
+	// Ran out of time before measuring every cycle
+	RGT_AUTOTUNE_TIMED_OUT,
+	// Strayed further than max_deviation from the target
+	RGT_AUTOTUNE_ABORTED,
+} Rgt_Autotune_State;
+
+/**
+ * The rules for turning the ultimate gain and period into PID gains
+ */
+typedef enum {
+	// Ziegler-Nichols PID - fast, with about 25% overshoot
+	RGT_AUTOTUNE_ZIEGLER_NICHOLS,
+	// Ziegler-Nichols PI, for mechanisms with noisy sensors
+	RGT_AUTOTUNE_ZIEGLER_NICHOLS_PI,
+	// Tyreus-Luyben PID - slower, with much less overshoot
+	RGT_AUTOTUNE_TYREUS_LUYBEN,
+} Rgt_Autotune_Rule;
+
+/**
+ * What an autotune measured
+ */
+typedef struct {
+	// The proportional gain (mV per sensor unit) at which the mechanism
+	// oscillates steadily
+	double ultimate_gain;
+	// The period of that oscillation, in seconds
+	double ultimate_period;
+	// Half the peak-to-peak size of the oscillation, in sensor units
+	double amplitude;
+	// The number of oscillations measured
+	uint8_t cycles;
+} Rgt_Autotune_Result;
+
+/**
+ * An autotune - its settings, state, and result. Use it as the context of
+ * rgt_autotune_controller.
+ */
+typedef struct {
+	// The relay's output, in mV. Pick the smallest that moves the mechanism
+	// clearly - the oscillation grows with it
+	double amplitude;
+	// Voltage added to the relay's output, e.g. to hold up an arm against
+	// gravity
+	double bias;
+	// The relay only switches once the error passes this, in sensor units, so
+	// sensor noise doesn't switch it early
+	double hysteresis;
+	// Stop with RGT_AUTOTUNE_ABORTED if the error gets bigger than this, in
+	// sensor units, or 0 for no limit
+	double max_deviation;
+	// The oscillations to measure, after the first, which is skipped while the
+	// mechanism settles into a steady oscillation
+	uint8_t cycles;
+	// Stop with RGT_AUTOTUNE_TIMED_OUT after this long, in ms
+	uint32_t timeout;
+	// Internal state - use rgt_autotune_get_state and rgt_autotune_get_result
+	Rgt_Autotune_State state;
+	Rgt_Autotune_Result result;
+	// Internal state - whether the autotune and a cycle have started, the
+	// relay's direction, the time (us) the autotune and the current cycle
+	// started, the extremes of the current cycle, and the measured cycles (the
+	// first one is never used)
+	bool started;
+	bool in_cycle;
+	bool relay_high;
+	uint64_t start_time;
+	uint64_t cycle_start;
+	double cycle_max;
+	double cycle_min;
+	uint8_t cycles_seen;
+	double periods[RGT_AUTOTUNE_MAX_CYCLES + 1];
+	double amplitudes[RGT_AUTOTUNE_MAX_CYCLES + 1];
+} Rgt_Autotune;
+
+/**
+ * @brief Creates a Rgt_Autotune struct
+ *
+ * @details The autotune starts on the first cycle of its controller, and can
+ * be restarted by resetting the controller.
+ *
+ * @param amplitude The relay's output, in mV
+ * @param hysteresis The error, in sensor units, past which the relay switches
+ * @param max_deviation The error at which to abort, or 0 for no limit
+ * @param cycles The oscillations to measure, from 1 to
+ * RGT_AUTOTUNE_MAX_CYCLES
+ * @param timeout The most time to run for, in ms
+ */
+Rgt_Autotune rgt_autotune_init(double amplitude, double hysteresis,
+                               double max_deviation, uint8_t cycles,
+                               uint32_t timeout);
+
+/**
+ * @brief Autotuning controller function for use with Ringtail's generic
+ * controller system
+ *
+ * @details Use this as the calculate_voltage of rgt_controller_info_init_ctx,
+ * with a Rgt_Autotune as its context, and set the target to the position to
+ * oscillate around. A reset restarts the autotune.
+ */
+double rgt_autotune_controller(void *autotune, double target, double current,
+                               bool reset);
+
+// Gets the state of an autotune - safe to call from any task
+Rgt_Autotune_State rgt_autotune_get_state(Rgt_Autotune *a);
+
+/**
+ * @brief Gets what an autotune measured
+ *
+ * @param a The autotune
+ * @param result The struct to copy the result into
+ *
+ * @return true if the autotune is done and result was copied, false otherwise
+ */
+bool rgt_autotune_get_result(Rgt_Autotune *a, Rgt_Autotune_Result *result);
+
+/**
+ * @brief Turns an autotune result into PID gains
+ *
+ * @details The gains are for pid and Rgt_PID, whose integral and derivative
+ * are per update, so they depend on how often the controller runs.
+ *
+ * @param result The autotune result
+ * @param rule The tuning rule to use
+ * @param period The period (ms) of the controller the gains are for
+ *
+ * @return A Rgt_PID with the gains, made with rgt_pid_init
+ */
+Rgt_PID rgt_autotune_gains(const Rgt_Autotune_Result *result,
+                           Rgt_Autotune_Rule rule, uint32_t period);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGTAIL_AUTOTUNE_H_ */
@@ -0,0 +1,158 @@
+/**
+ * @file health.h
+ *
+ * @brief Background motor health monitoring and derating
+ *
+ * @details Ringtail can run a low priority task that samples the temperature,
+ * faults, and flags of the motors in registered motor groups. Each group has a
+ * policy that reduces its motors' current limit (and optionally caps their
+ * voltage) as they heat up, so the mechanism slows down gradually instead of
+ * the motor firmware throttling it hard at 55 degrees C. The latest sample for
+ * every port is kept in a table that any task can read without taking a lock.
+ */
+
+#ifndef RINGTAIL_HEALTH_H_
+#define RINGTAIL_HEALTH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ringtail/motor_group.h"
+
+#include "pros/rtos.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The most motor groups that can be registered with the health monitor
+#define RGT_HEALTH_MAX_GROUPS 8
+
+/**
+ * The derating policy for a motor group. Between derate_temperature and
+ * critical_temperature the current limit drops linearly from
+ * max_current_limit to min_current_limit.
+ *
+ * The policy only ever lowers the limits a motor had when the monitor first
+ * read it, so limits set before rgt_health_start are kept. A motor that is
+ * unplugged keeps derating, and gets its limits sent again once it is back.
+ */
+typedef struct {
+	// Temperature (degrees C) at which derating starts
+	double derate_temperature;
+	// Temperature (degrees C) at which the current limit reaches its minimum
+	double critical_temperature;
+	// Current limit (mA) below derate_temperature
+	int32_t max_current_limit;
+	// Current limit (mA) at and above critical_temperature
+	int32_t min_current_limit;
+	// Voltage limit (mV) applied while derating, or 0 to leave the voltage
+	// alone
+	int32_t voltage_cap;
+	// Whether to rumble the master controller when the group starts derating -
+	// once, however many of its motors are
+	bool alert;
+} Rgt_Health_Policy;
+
+/**
+ * A policy for V5 motors: the motor firmware halves its output at 55 degrees
+ * C, so derating starts 10 degrees earlier and bottoms out at half the default
+ * 2500 mA limit.
+ */
+#define RGT_HEALTH_POLICY_DEFAULT                                              \
+	{                                                                          \
+	    .derate_temperature = 45,                                              \
+	    .critical_temperature = 55,                                            \
+	    .max_current_limit = 2500,                                             \
+	    .min_current_limit = 1250,                                             \
+	    .voltage_cap = 0,                                                      \
+	    .alert = true,                                                         \
+	}
+
+/**
+ * The latest health sample for a single motor
+ */
+typedef struct {
+	double temperature;    // Temperature in degrees C
+	uint32_t faults;       // Bitfield of motor_fault_e_t
+	uint32_t flags;        // Bitfield of motor_flag_e_t
+	bool over_temp;        // Whether the motor firmware reports over temp
+	// Whether the policy is currently derating. A motor that can't be read
+	// keeps its last state
+	bool derating;
+	// The current limit (mA) Ringtail last read or applied, or -1 while it is
+	// being restored after the motor was unplugged
+	int32_t current_limit;
+	uint32_t timestamp; // Time (ms) the sample was taken, 0 if never
+} Rgt_Motor_Health;
+
+/**
+ * @brief Registers a motor group with the health monitor
+ *
+ * @details The health task samples every motor in the group and applies the
+ * policy to them. Both the group and the policy are stored by pointer, so they
+ * must outlive the health monitor (i.e. be static).
+ *
+ * @param mg The motor group to monitor
+ * @param policy The derating policy for the group
+ *
+ * @return true if the group was registered, false if RGT_HEALTH_MAX_GROUPS
+ * groups are already registered
+ */
+bool rgt_health_register(const Rgt_Motor_Group *mg,
+                         const Rgt_Health_Policy *policy);
+
+/**
+ * @brief Starts the health monitor as a PROS task
+ *
+ * @details The task runs at TASK_PRIORITY_MIN + 1, so it only uses time that
+ * the control and driver tasks don't need. Calling this more than once
+ * returns the existing task.
+ *
+ * @param period The time between samples, in ms. Motor temperatures change
+ * slowly, so 100 ms or more is plenty.
+ *
+ * @return The health monitor task
+ */
+task_t rgt_health_start(uint32_t period);
+
+/**
+ * @brief Samples every registered motor once and applies their policies
+ *
+ * @details This is one cycle of the health task. Call it from a task of your
+ * own instead of starting the health task, not as well as.
+ */
+void rgt_health_step(void);
+
+/**
+ * @brief Reads the latest health sample for a port without locking
+ *
+ * @details The health task publishes each port's sample to one of two
+ * buffers, then flips which one is current. Readers copy the current buffer
+ * and retry only if the task published again mid-copy, so this never blocks
+ * and never waits on the (low priority) health task.
+ *
+ * @param port The smart port to read, from 1 to 21. Negative ports are
+ * treated as their positive counterparts.
+ * @param health The struct to copy the sample into
+ *
+ * @return true if the port has been sampled, false otherwise
+ */
+bool rgt_health_get(int8_t port, Rgt_Motor_Health *health);
+
+/**
+ * @brief Returns the highest temperature in a motor group
+ *
+ * @details Reads from the health table, so it doesn't touch the motors.
+ *
+ * @param mg The motor group
+ *
+ * @return The hottest motor's temperature, or 0 if none have been sampled
+ */
+double rgt_health_get_max_temperature(const Rgt_Motor_Group *mg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGTAIL_HEALTH_H_ */
@@ -0,0 +1,303 @@
+/**
+ * @file motion_profile.h
+ *
+ * @brief Trapezoidal and S-curve motion profiles for controller targets
+ *
+ * @details Giving a position controller its final target in one step starts it
+ * with a huge error, so it saturates the motors, slips the wheels, and then
+ * overshoots. A motion profile instead moves the controller's target smoothly
+ * from where it is to where it should end up, limiting the velocity and
+ * acceleration (and, for an S-curve, the jerk) on the way. The controller then
+ * only has to follow a target that's always close by.
+ *
+ * A profile is planned once per move - that computes the time of each phase -
+ * and then sampled every controller cycle at a constant cost. The profiled
+ * controller wrappers in this file plan and sample a profile inside the
+ * controller loop, so setting a target is all it takes to start a move. They
+ * can also add feedforward from the profile's velocity and acceleration.
+ */
+
+#ifndef RINGTAIL_MOTION_PROFILE_H_
+#define RINGTAIL_MOTION_PROFILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ringtail/controller.h"
+#include "ringtail/reference_controllers.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The number of phases in a profile: three to brake to a stop if the move has
+// to turn around first, then jerk up, constant acceleration, jerk down,
+// cruise, and the same three mirrored to decelerate
+#define RGT_PROFILE_PHASES 10
+
+/**
+ * Limits on a profile's motion, in the units of the controller's sensor. Times
+ * are in seconds, so e.g. max_velocity is in units per second.
+ */
+typedef struct {
+	double max_velocity;
+	double max_acceleration;
+	// The most jerk (rate of change of acceleration), or 0 for a trapezoidal
+	// profile, which changes the acceleration instantly
+	double max_jerk;
+} Rgt_Profile_Limits;
+
+/**
+ * The target of a profile at a point in time
+ */
+typedef struct {
+	double position;
+	double velocity;
+	double acceleration;
+} Rgt_Profile_State;
+
+/**
+ * A planned motion profile. Create it with rgt_profile_init, then plan moves
+ * with rgt_profile_plan or rgt_profile_plan_from. Every move ends at rest.
+ */
+typedef struct {
+	Rgt_Profile_Limits limits;
+	// Internal state - the move being profiled. The phase states' positions
+	// are relative to start
+	double start;
+	double start_velocity;
+	double end;
+	// Internal state - the time (s) each phase ends, and the state and jerk at
+	// the start of each phase
+	double phase_end[RGT_PROFILE_PHASES];
+	Rgt_Profile_State phase_start[RGT_PROFILE_PHASES];
+	double phase_jerk[RGT_PROFILE_PHASES];
+	// Internal state - the phase of the last sample, so samples at increasing
+	// times don't search from the first phase
+	uint8_t phase;
+} Rgt_Motion_Profile;
+
+/**
+ * @brief Creates a Rgt_Motion_Profile struct
+ *
+ * @details The profile starts planned as a move of length 0 from 0. A profile
+ * without a positive max_velocity and max_acceleration can't move, so all its
+ * moves step straight to the end, as if there were no profile.
+ *
+ * @param max_velocity The most velocity, in units per second
+ * @param max_acceleration The most acceleration, in units per second squared
+ * @param max_jerk The most jerk, in units per second cubed, or 0 for a
+ * trapezoidal profile
+ */
+Rgt_Motion_Profile rgt_profile_init(double max_velocity,
+                                    double max_acceleration, double max_jerk);
+
+/**
+ * @brief Plans a move from rest at start to rest at end
+ *
+ * @details Computes the length of every phase of the move, so samples don't
+ * have to. The move reaches max_velocity if it is long enough, and otherwise
+ * peaks at the highest velocity the acceleration and jerk limits allow.
+ *
+ * @param p The profile
+ * @param start The position to start at
+ * @param end The position to end at
+ */
+void rgt_profile_plan(Rgt_Motion_Profile *p, double start, double end);
+
+/**
+ * @brief Plans a move from start, moving at velocity, to rest at end
+ *
+ * @details Like rgt_profile_plan, but the move starts at velocity, e.g. the
+ * velocity of a move that is being replaced. The move changes speed from there
+ * instead of from rest. If it is moving away from end, or too fast to stop by
+ * it, it first brakes to a stop and then moves back.
+ *
+ * The move always starts with no acceleration, so replacing an S-curve move
+ * while it accelerates changes the acceleration at once.
+ *
+ * @param p The profile
+ * @param start The position to start at
+ * @param velocity The velocity at start, in units per second
+ * @param end The position to end at
+ */
+void rgt_profile_plan_from(Rgt_Motion_Profile *p, double start,
+                           double velocity, double end);
+
+// Returns the time (s) the planned move takes
+double rgt_profile_duration(const Rgt_Motion_Profile *p);
+
+/**
+ * @brief Samples the planned move
+ *
+ * @details Takes constant time when samples are at increasing times, as they
+ * are from a controller loop.
+ *
+ * @param p The profile
+ * @param time The time since the move started, in seconds. Times before the
+ * start give the start, and times after the end give the end.
+ *
+ * @return The position, velocity, and acceleration at the time
+ */
+Rgt_Profile_State rgt_profile_sample(Rgt_Motion_Profile *p, double time);
+
+/**
+ * A controller target that follows a profile. Whenever the target it is given
+ * changes, it plans a move to the new target. A new target mid-move starts the
+ * new move from the old one's setpoint, position and velocity both, so the
+ * setpoint doesn't jump. Any other move starts at rest from the current sensor
+ * value, so moves start from wherever the robot was left.
+ */
+typedef struct {
+	Rgt_Motion_Profile profile;
+	// Internal state - the target of the current move, the time (us) it
+	// started, and whether there has been a move yet
+	double target;
+	uint64_t start_time;
+	bool moving;
+} Rgt_Profiled_Target;
+
+/**
+ * @brief Updates a profiled target
+ *
+ * @details Plans a new move if target has changed, then samples the move at
+ * the current time.
+ *
+ * @param t The profiled target
+ * @param target The final target
+ * @param current The current sensor value
+ *
+ * @return The target for the controller to use this cycle
+ */
+Rgt_Profile_State rgt_profiled_target_update(Rgt_Profiled_Target *t,
+                                             double target, double current);
+
+/**
+ * What a profiled controller did on its last cycle, for telemetry
+ */
+typedef struct {
+	// The profiled target
+	Rgt_Profile_State setpoint;
+	// The feedforward voltage, from the setpoint's velocity and acceleration
+	double feedforward;
+	// The voltage from the wrapped controller function. Coupled controllers
+	// mix their feedback into the voltages, so theirs is always 0
+	double feedback;
+} Rgt_Profiled_Telemetry;
+
+/**
+ * A calculate_voltage context that profiles the target before passing it to
+ * another controller function. See rgt_profiled_controller.
+ */
+typedef struct {
+	Rgt_Profiled_Target target;
+	// The controller function to pass the profiled target to, and its context
+	double (*calculate_voltage)(void *, double, double, bool);
+	void *controller_context;
+	// Feedforward gains, all 0 for no feedforward
+	Rgt_Feedforward feedforward;
+	// Internal state - telemetry, published to alternating buffers like the
+	// timing statistics of Rgt_Controller_Info
+	Rgt_Profiled_Telemetry telemetry[2];
+	uint32_t telemetry_seq;
+} Rgt_Profiled_Controller;
+
+/**
+ * @brief Creates a Rgt_Profiled_Controller struct
+ *
+ * @param limits The limits for the profile
+ * @param calculate_voltage The controller function to pass the profiled
+ * target to
+ * @param controller_context The context pointer for calculate_voltage
+ * @param feedforward The feedforward gains, or NULL for no feedforward
+ */
+Rgt_Profiled_Controller rgt_profiled_controller_init(
+    Rgt_Profile_Limits limits,
+    double (*calculate_voltage)(void *, double, double, bool),
+    void *controller_context, const Rgt_Feedforward *feedforward);
+
+/**
+ * @brief Profiled controller function for use with Ringtail's generic
+ * controller system
+ *
+ * @details Use this as the calculate_voltage of rgt_controller_info_init_ctx,
+ * with a Rgt_Profiled_Controller as its context. Each cycle it moves the
+ * target along the profile, calls the wrapped controller function with it,
+ * and adds the feedforward for the profile's velocity and acceleration to the
+ * result. The controller still settles on the final target, so at_target isn't
+ * set until the move is done.
+ *
+ * @param controller A pointer to a Rgt_Profiled_Controller
+ * @param target The final target
+ * @param current The current sensor value
+ * @param reset Passed to the wrapped controller function
+ */
+double rgt_profiled_controller(void *controller, double target, double current,
+                               bool reset);
+
+/**
+ * @brief Gets the telemetry from a profiled controller's last cycle
+ *
+ * @details Reads without locking, so it never blocks the controller.
+ */
+Rgt_Profiled_Telemetry
+rgt_profiled_controller_get_telemetry(Rgt_Profiled_Controller *c);
+
+/**
+ * The coupled version of Rgt_Profiled_Controller - each axis has its own
+ * profile and feedforward gains. A coupled controller mixes its axes into its
+ * outputs itself, so the feedforward voltages are left in feedforward_voltages
+ * for the wrapped function to add before it mixes - see Rgt_Tank_Drive.
+ */
+typedef struct {
+	Rgt_Profiled_Target targets[RGT_COUPLED_MAX_AXES];
+	uint8_t axis_count;
+	void (*calculate_voltages)(void *, const double *, const double *, bool,
+	                           double *);
+	void *controller_context;
+	Rgt_Feedforward feedforward[RGT_COUPLED_MAX_AXES];
+	// The feedforward voltage for each axis this cycle, updated before
+	// calculate_voltages is called
+	double feedforward_voltages[RGT_COUPLED_MAX_AXES];
+	// Internal state - telemetry, published like Rgt_Profiled_Controller's
+	Rgt_Profiled_Telemetry telemetry[2][RGT_COUPLED_MAX_AXES];
+	uint32_t telemetry_seq;
+} Rgt_Profiled_Coupled_Controller;
+
+/**
+ * @brief Creates a Rgt_Profiled_Coupled_Controller struct
+ *
+ * @param limits The limits for each axis's profile
+ * @param axis_count The number of axes of the coupled controller
+ * @param calculate_voltages The controller function to pass the profiled
+ * targets to
+ * @param controller_context The context pointer for calculate_voltages
+ * @param feedforward The feedforward gains for each axis, or NULL for no
+ * feedforward
+ */
+Rgt_Profiled_Coupled_Controller rgt_profiled_coupled_controller_init(
+    const Rgt_Profile_Limits *limits, uint8_t axis_count,
+    void (*calculate_voltages)(void *, const double *, const double *, bool,
+                               double *),
+    void *controller_context, const Rgt_Feedforward *feedforward);
+
+/**
+ * @brief The coupled version of rgt_profiled_controller
+ *
+ * @details Use this as the calculate_voltages of rgt_coupled_controller_init,
+ * with a Rgt_Profiled_Coupled_Controller as its context.
+ */
+void rgt_profiled_coupled_controller(void *controller, const double *targets,
+                                     const double *values, bool reset,
+                                     double *voltages);
+
+// Gets the telemetry for one axis from a profiled coupled controller's last
+// cycle, without locking
+Rgt_Profiled_Telemetry rgt_profiled_coupled_controller_get_telemetry(
+    Rgt_Profiled_Coupled_Controller *c, uint8_t axis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGTAIL_MOTION_PROFILE_H_ */
@@ -5,7 +5,17 @@
  * controllers.
  */
 
+#ifndef RINGTAIL_REFERENCE_CONTROLLERS_H_
+#define RINGTAIL_REFERENCE_CONTROLLERS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ringtail/motor_group.h"
+
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -63,3 +73,529 @@ double pid(double error, double kP, double kI, double kD, double *integral,
 
 void tbh(double error, double prev_error, double *output, double *tbh,
          double kH);
+
+/**
+ * Single precision versions of bangbang, pid, and tbh, with the same
+ * semantics. Floats are plenty for signals that end up as ±12000 mV commands,
+ * and cheaper than doubles on the V5.
+ */
+float bangbangf(float target, float current, int16_t on_voltage,
+                int16_t off_voltage);
+float pidf(float error, float kP, float kI, float kD, float *integral,
+           float prev_error, bool clear_integral);
+void tbhf(float error, float prev_error, float *output, float *tbh, float kH);
+
+/**
+ * A Q16.16 fixed-point number: an int32_t holding the value times 65536. It
+ * covers about ±32767 to a resolution of 1/65536.
+ */
+typedef int32_t rgt_q16_t;
+
+// The Q16.16 value of a constant, e.g. RGT_Q16(0.5)
+#define RGT_Q16(x) ((rgt_q16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+// Converts a value to Q16.16, saturating at the ends of its range
+static inline rgt_q16_t rgt_q16_from_double(double x) {
+	double q = x * 65536.0;
+	if (q >= INT32_MAX)
+		return INT32_MAX;
+	if (q <= INT32_MIN)
+		return INT32_MIN;
+	return (rgt_q16_t)(q >= 0 ? q + 0.5 : q - 0.5);
+}
+
+static inline double rgt_q16_to_double(rgt_q16_t x) { return x / 65536.0; }
+
+/**
+ * Fixed-point versions of bangbang, pid, and tbh, with the same semantics.
+ * Every argument and result is Q16.16 (except the bangbang voltages). Products
+ * are rounded to nearest, and sums and products saturate at the ends of the
+ * range instead of wrapping, so a large integral holds instead of flipping
+ * sign.
+ */
+rgt_q16_t bangbang_q16(rgt_q16_t target, rgt_q16_t current,
+                       int16_t on_voltage, int16_t off_voltage);
+rgt_q16_t pid_q16(rgt_q16_t error, rgt_q16_t kP, rgt_q16_t kI, rgt_q16_t kD,
+                  rgt_q16_t *integral, rgt_q16_t prev_error,
+                  bool clear_integral);
+void tbh_q16(rgt_q16_t error, rgt_q16_t prev_error, rgt_q16_t *output,
+             rgt_q16_t *tbh, rgt_q16_t kH);
+
+// The largest voltage (mV) the motors accept, the default PID output limit
+#define RGT_PID_MAX_OUTPUT 12000
+
+/**
+ * A PID controller instance - its gains, limits, and state together, so any
+ * number of PID controllers can share the same functions. Arrays of them can be
+ * updated in one call with rgt_pid_calculate_all.
+ */
+typedef struct {
+	double kP; // The Proportional constant
+	double kI; // The Integral constant
+	double kD; // The Derivative constant
+	// The largest output magnitude, or 0 for no limit
+	double output_limit;
+	// The integral only accumulates while the error's magnitude is within
+	// this, and is cleared outside it. 0 for no zone
+	double integral_zone;
+	// The largest magnitude of the integral term (kI * integral), or 0 for no
+	// limit
+	double integral_limit;
+	// While the output is limited, the integral is unwound by this fraction of
+	// the excess output (back-calculation anti-windup), never past 0. 0 turns
+	// it off
+	double windup_gain;
+	// Whether to clear the integral when the error changes sign, i.e. when the
+	// target is crossed
+	bool reset_on_sign_change;
+	// Whether to differentiate the measurement instead of the error, so a
+	// change of target doesn't kick the output. Needs the measurement - see
+	// rgt_pid_calculate_measured
+	bool derivative_on_measurement;
+	// Time constant of a first-order low-pass filter on the derivative, in
+	// update periods, or 0 for no filtering
+	double derivative_filter;
+	// The period (ms) the gains are tuned for, or 0 to treat every update as
+	// one period. When set, the integral and derivative are scaled by the
+	// measured time since the last update, so late updates don't change the
+	// gains' effect
+	double nominal_period;
+	// State - the accumulated error and the error from the last update
+	double integral;
+	double prev_error;
+	// State - the filtered derivative, the measurement from the last update
+	// and whether there was one, and the time (us) of the last update, 0 if
+	// none
+	double derivative;
+	double prev_measurement;
+	bool has_prev_measurement;
+	uint64_t last_time;
+} Rgt_PID;
+
+/**
+ * @brief Creates a Rgt_PID with the given gains and cleared state
+ *
+ * @details The output is limited to RGT_PID_MAX_OUTPUT with full
+ * back-calculation anti-windup. There is no integral zone, integral limit,
+ * sign change reset, derivative filter, or period measurement, and the
+ * derivative is of the error - set those fields after creating the instance.
+ */
+Rgt_PID rgt_pid_init(double kP, double kI, double kD);
+
+// Clears the PID's integral, derivative, and previous error and measurement
+void rgt_pid_reset(Rgt_PID *p);
+
+/**
+ * @brief Updates a PID instance with a new error
+ *
+ * @details Computes the same output as pid, using and updating the state in
+ * the instance, with the integral zone, integral limit, and sign change reset
+ * applied to the integral, and the derivative filtered and scaled by the
+ * measured period. The output is then limited to output_limit, and the
+ * integral unwound by the excess. There's no measurement, so the derivative is
+ * always of the error.
+ *
+ * @param p The PID instance
+ * @param error The error between the target value and current value
+ * @param clear_integral Whether to clear the integral instead of accumulating
+ * this error
+ *
+ * @return The controller output
+ */
+double rgt_pid_calculate(Rgt_PID *p, double error, bool clear_integral);
+
+/**
+ * @brief Updates a PID instance with a new target and measurement
+ *
+ * @details The same as rgt_pid_calculate, with target - current as the error,
+ * except that the derivative is of current if derivative_on_measurement is
+ * set. The first update after a reset then has no derivative.
+ *
+ * @param p The PID instance
+ * @param target The target value
+ * @param current The current sensor value
+ * @param clear_integral Whether to clear the integral instead of accumulating
+ * this error
+ *
+ * @return The controller output
+ */
+double rgt_pid_calculate_measured(Rgt_PID *p, double target, double current,
+                                  bool clear_integral);
+
+/**
+ * @brief Updates an array of PID instances
+ *
+ * @details Equivalent to calling rgt_pid_calculate on each instance (without
+ * clearing the integral), but in a single loop over contiguous state.
+ *
+ * @param pids The PID instances
+ * @param errors The error for each instance
+ * @param outputs Where to store the output of each instance
+ * @param count The number of instances
+ */
+void rgt_pid_calculate_all(Rgt_PID *pids, const double *errors,
+                           double *outputs, size_t count);
+
+// The most controllers in a Rgt_PID_Batch, a multiple of 4 for NEON
+#define RGT_PID_BATCH_MAX 16
+
+/**
+ * A batch of single precision PID controllers, stored as one array per field
+ * so rgt_pid_batch_calculate can update four of them per NEON instruction.
+ * Zero-initialize it, then add controllers with rgt_pid_batch_add.
+ */
+typedef struct {
+	uint8_t count; // The number of controllers in the batch
+	float kP[RGT_PID_BATCH_MAX];
+	float kI[RGT_PID_BATCH_MAX];
+	float kD[RGT_PID_BATCH_MAX];
+	// The largest output magnitude - INFINITY for no limit
+	float output_limit[RGT_PID_BATCH_MAX];
+	// State - the accumulated error and the error from the last update
+	float integral[RGT_PID_BATCH_MAX];
+	float prev_error[RGT_PID_BATCH_MAX];
+} Rgt_PID_Batch;
+
+/**
+ * @brief Adds a controller to a batch
+ *
+ * @details The controller's output is limited to RGT_PID_MAX_OUTPUT, and its
+ * state starts cleared.
+ *
+ * @return The controller's index in the batch, or -1 if the batch is full
+ */
+int rgt_pid_batch_add(Rgt_PID_Batch *b, float kP, float kI, float kD);
+
+// Clears the integral and previous error of one controller in a batch
+void rgt_pid_batch_reset(Rgt_PID_Batch *b, uint8_t index);
+
+/**
+ * @brief Updates every controller in a batch
+ *
+ * @details Each controller computes the same output as pid (in single
+ * precision), limited to its output_limit. When built for NEON (as for the
+ * V5), four controllers are updated at a time, otherwise one at a time.
+ *
+ * @param b The batch
+ * @param errors The error for each controller, in index order
+ * @param outputs Where to store the output of each controller
+ */
+void rgt_pid_batch_calculate(Rgt_PID_Batch *b, const float *errors,
+                             float *outputs);
+
+/**
+ * @brief Updates every controller in a batch one at a time
+ *
+ * @details The same as rgt_pid_batch_calculate without NEON, even when built
+ * for it. Results match the NEON path to within float rounding, so this is
+ * mostly for checking and benchmarking it.
+ */
+void rgt_pid_batch_calculate_scalar(Rgt_PID_Batch *b, const float *errors,
+                                    float *outputs);
+
+/**
+ * @brief calculate_voltage function for Ringtail's generic controller system
+ *
+ * @details Pass this and a Rgt_PID pointer as the context to
+ * rgt_controller_info_init_ctx to use a PID instance as a controller. A reset
+ * clears the instance's state.
+ */
+double rgt_pid_controller(void *pid, double target, double current,
+                          bool reset);
+
+/**
+ * A take back half velocity controller instance, for flywheels, rollers, and
+ * anything else that has to hold a speed under a changing load. It wraps tbh
+ * with everything a velocity loop needs around it: the velocity sensor, a
+ * filter on its readings, a better first guess, an output limit, and an
+ * at-speed flag.
+ */
+typedef struct {
+	// The motor group whose average velocity (RPM) rgt_tbh_get_sensor_data
+	// reads, or NULL if the controller uses another sensor
+	const Rgt_Motor_Group *mg;
+	double kH; // The gain the error is integrated into the output with
+	// The voltage per unit of target velocity that holds the target, e.g.
+	// 12000 / free speed. On the first crossing of a new target the output
+	// and tbh jump to the target times this instead of halving towards 0, so
+	// the controller starts from a close guess. 0 to just take back half
+	double guess_gain;
+	// The largest output magnitude, or 0 for no limit
+	double output_limit;
+	// Time constant of a first-order low-pass filter on the velocity, in
+	// update periods, or 0 for no filtering. Motor velocity readings are
+	// noisy, and the noise is integrated straight into the output
+	double velocity_filter;
+	// at_speed is set once the filtered velocity is within at_speed_threshold
+	// of the target, and cleared once it is more than at_speed_threshold +
+	// at_speed_hysteresis away, so it doesn't flicker at the edge
+	double at_speed_threshold;
+	double at_speed_hysteresis;
+	// State - the output, the tbh quantity, and the error and target from the
+	// last update
+	double output;
+	double tbh;
+	double prev_error;
+	double prev_target;
+	// State - the filtered velocity, whether there has been an update since
+	// the last reset, and whether the target has been crossed since it was
+	// set
+	double velocity;
+	bool started;
+	bool crossed;
+	// State - whether the velocity is at the target. Read it with
+	// rgt_tbh_at_speed
+	bool at_speed;
+} Rgt_TBH;
+
+/**
+ * @brief Creates a Rgt_TBH with the given gains and cleared state
+ *
+ * @details The output is limited to RGT_PID_MAX_OUTPUT. There is no velocity
+ * filter, and at_speed is set within 5% of RGT_PID_MAX_OUTPUT / guess_gain,
+ * or 10 units with no guess, with half that again as hysteresis - set those
+ * fields after creating the instance.
+ *
+ * @param mg The motor group to read the velocity of, or NULL
+ * @param kH The gain
+ * @param guess_gain The voltage per unit of target velocity, or 0
+ */
+Rgt_TBH rgt_tbh_init(const Rgt_Motor_Group *mg, double kH, double guess_gain);
+
+// Clears the TBH's output, tbh quantity, filter, and at-speed flag
+void rgt_tbh_reset(Rgt_TBH *t);
+
+/**
+ * @brief Updates a TBH instance with a new velocity reading
+ *
+ * @details Filters the velocity, integrates the error into the output, and
+ * takes back half each time the target is crossed. A new target starts over
+ * from the first crossing. A target of 0 stops the mechanism by outputting 0
+ * rather than holding it still.
+ *
+ * @param t The TBH instance
+ * @param target The target velocity
+ * @param current The measured velocity
+ *
+ * @return The output voltage
+ */
+double rgt_tbh_calculate(Rgt_TBH *t, double target, double current);
+
+// Gets whether a TBH instance's velocity is at its target - safe to call from
+// any task
+bool rgt_tbh_at_speed(Rgt_TBH *t);
+
+/**
+ * @brief get_sensor_data function for Ringtail's generic controller system
+ *
+ * @details Pass this and a Rgt_TBH pointer as the sensor context to
+ * rgt_controller_info_init_ctx. Returns the average velocity of the TBH's
+ * motor group.
+ */
+double rgt_tbh_get_sensor_data(void *tbh);
+
+/**
+ * @brief calculate_voltage function for Ringtail's generic controller system
+ *
+ * @details Pass this and a Rgt_TBH pointer as the controller context to
+ * rgt_controller_info_init_ctx to use a TBH instance as a velocity controller.
+ * A reset clears the instance's state. The controller's at_target sees the
+ * raw velocity - use rgt_tbh_at_speed, which sees the filtered one.
+ */
+double rgt_tbh_controller(void *tbh, double target, double current,
+                          bool reset);
+
+/**
+ * The ways a Rgt_Bangbang decides its output. bangbang switches every update
+ * the current value crosses the target, so sensor noise alone chatters the
+ * motors between full on and off - these modes don't.
+ */
+typedef enum {
+	// on_voltage once the current value is band below the target, and
+	// off_voltage once it is band above it. In between, the output stays
+	// whatever it last was
+	RGT_BANGBANG_HYSTERESIS,
+	// on_voltage more than band below the target, off_voltage more than band
+	// above it, and hold_voltage in between
+	RGT_BANGBANG_DEADBAND,
+	// Drives towards the target at on_voltage (negated below it), and brakes
+	// with brake_voltage once the mechanism would only just stop at the target
+	// at the given deceleration. Within band of the target it brakes until
+	// the mechanism stops, then outputs hold_voltage. This is the fastest way
+	// to the target a mechanism with only full power and brakes has
+	RGT_BANGBANG_MIN_TIME,
+} Rgt_Bangbang_Mode;
+
+/**
+ * A bang-bang controller instance with a mode that doesn't chatter around the
+ * target. See Rgt_Bangbang_Mode.
+ */
+typedef struct {
+	Rgt_Bangbang_Mode mode;
+	double on_voltage;
+	double off_voltage;
+	// The distance from the target, in sensor units, that the modes switch at
+	double band;
+	// The voltage within band of the target in the deadband and minimum time
+	// modes, e.g. 0 or enough to hold an arm against gravity
+	double hold_voltage;
+	// Minimum time mode - the voltage applied against the motion to brake,
+	// and the deceleration (units per second squared) it brakes at. A
+	// deceleration of 0 never brakes
+	double brake_voltage;
+	double deceleration;
+	// Minimum time mode - time constant of a first-order low-pass filter on
+	// the velocity, which is estimated from the change in the sensor value,
+	// in update periods, or 0 for no filtering
+	double velocity_filter;
+	// State - whether the output is on, for the hysteresis mode
+	bool on;
+	// State - the velocity estimate (units per second), the sensor value from
+	// the last update and whether there was one, and the time (us) of the
+	// last update
+	double velocity;
+	double prev_current;
+	bool has_prev_current;
+	uint64_t last_time;
+} Rgt_Bangbang;
+
+/**
+ * @brief Creates a Rgt_Bangbang with the given mode and cleared state
+ *
+ * @details hold_voltage starts at 0, and brake_voltage at on_voltage. The
+ * minimum time mode also needs its deceleration set - set those fields after
+ * creating the instance. The velocity isn't filtered.
+ *
+ * @param mode The mode
+ * @param on_voltage The voltage below the target
+ * @param off_voltage The voltage above the target. Unused in minimum time mode
+ * @param band The distance from the target that the mode switches at
+ */
+Rgt_Bangbang rgt_bangbang_init(Rgt_Bangbang_Mode mode, double on_voltage,
+                               double off_voltage, double band);
+
+// Clears the bang-bang controller's output state and velocity estimate
+void rgt_bangbang_reset(Rgt_Bangbang *b);
+
+/**
+ * @brief Updates a bang-bang instance with a new sensor value
+ *
+ * @param b The bang-bang instance
+ * @param target The target value
+ * @param current The current sensor value
+ *
+ * @return The output voltage
+ */
+double rgt_bangbang_calculate(Rgt_Bangbang *b, double target, double current);
+
+/**
+ * @brief calculate_voltage function for Ringtail's generic controller system
+ *
+ * @details Pass this and a Rgt_Bangbang pointer as the context to
+ * rgt_controller_info_init_ctx to use a bang-bang instance as a controller. A
+ * reset clears the instance's state.
+ */
+double rgt_bangbang_controller(void *bangbang, double target, double current,
+                               bool reset);
+
+/**
+ * Feedforward gains. Feedforward finds the voltage a mechanism needs to move
+ * at a velocity and acceleration from a model of it, instead of from its
+ * error. Added to a feedback controller's output, it leaves the feedback only
+ * the part the model misses, so the controller doesn't lag behind a moving
+ * target. Gains of 0 give no feedforward.
+ */
+typedef struct {
+	// Voltage to overcome static friction, applied in the direction of motion
+	double kS;
+	double kV; // Voltage per unit of velocity
+	double kA; // Voltage per unit of acceleration
+} Rgt_Feedforward;
+
+/**
+ * @brief Calculates the feedforward voltage for a velocity and acceleration
+ *
+ * @details Returns kS * sign(velocity) + kV * velocity + kA * acceleration.
+ * The velocity and acceleration usually come from a motion profile - see
+ * Rgt_Profiled_Controller.
+ *
+ * @param ff The feedforward gains
+ * @param velocity The velocity the mechanism should move at
+ * @param acceleration The acceleration the mechanism should move at
+ */
+double rgt_feedforward_calculate(const Rgt_Feedforward *ff, double velocity,
+                                 double acceleration);
+
+/**
+ * A tank drive for the reference coupled controller. Its two axes are distance
+ * (the mean of the sides' distances) and heading, and its two outputs are the
+ * left and right motor groups, in that order. Heading is clockwise-positive,
+ * like the PROS IMU heading.
+ */
+typedef struct {
+	const Rgt_Motor_Group *left;
+	const Rgt_Motor_Group *right;
+	// Converts the motors' positions to distance, e.g. a gear ratio
+	double scale;
+	// How each side's motor positions are combined. See rgt_mg_aggregate
+	Rgt_MG_Aggregation aggregation;
+	double aggregation_threshold;
+	// Function that returns the heading (e.g. from an IMU), or NULL to use half
+	// the difference between the sides' distances, in distance units
+	double (*get_heading)(void);
+	// Controllers for each axis
+	Rgt_PID distance_pid;
+	Rgt_PID heading_pid;
+	// Feedforward voltages for the distance and heading axes, added to the
+	// PID outputs before they are mixed, or NULL for none. Usually the
+	// feedforward of a Rgt_Profiled_Coupled_Controller
+	const double *feedforward;
+	// Internal state - each side's last distance that could be read, and
+	// whether it has been read yet. Can be left zeroed
+	double held_distances[2];
+	bool held[2];
+} Rgt_Tank_Drive;
+
+/**
+ * @brief get_sensor_data function for a tank drive coupled controller
+ *
+ * @details Pass this and a Rgt_Tank_Drive pointer as the context to
+ * rgt_coupled_controller_init. Stores the distance in values[0] and the
+ * heading in values[1].
+ *
+ * While none of a side's motors can be read (e.g. its cable is out), the side
+ * holds its last distance. Until both sides have been read once, both values
+ * are PROS_ERR_F, and the coupled controller skips its cycles.
+ */
+void rgt_tank_get_sensor_data(void *tank, double *values);
+
+/**
+ * @brief Combines distance and heading outputs into left and right voltages
+ *
+ * @details Stores the left voltage in voltages[0] and the right voltage in
+ * voltages[1]. If the sum would saturate the motors, the distance output is
+ * reduced first, so the drive keeps its heading correction at full speed.
+ *
+ * @param distance The distance controller's output
+ * @param heading The heading controller's output, clockwise-positive
+ * @param voltages Where to store the voltages
+ */
+void rgt_tank_mix(double distance, double heading, double *voltages);
+
+/**
+ * @brief calculate_voltages function for a tank drive coupled controller
+ *
+ * @details Pass this and a Rgt_Tank_Drive pointer as the context to
+ * rgt_coupled_controller_init. Runs the distance and heading PID instances,
+ * adds the feedforward, and combines the outputs with rgt_tank_mix. A reset
+ * clears both instances.
+ */
+void rgt_tank_calculate_voltages(void *tank, const double *targets,
+                                 const double *values, bool reset,
+                                 double *voltages);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGTAIL_REFERENCE_CONTROLLERS_H_ */
@@ -11,11 +11,12 @@
  * conveyor
  */
 
-static rgt_motor_group conveyor_run = {8};
+// Shares port 8 with the intake pivot - see intake.c
+static Rgt_Motor_Group conveyor_run = RGT_MOTOR_GROUP(8);
 
-void conveyor_up(void) { rgt_mg_move(conveyor_run, 127); }
+void conveyor_up(void) { rgt_mg_move(&conveyor_run, 127); }
 
-void conveyor_down(void) { rgt_mg_move(conveyor_run, -127); }
+void conveyor_down(void) { rgt_mg_move(&conveyor_run, -127); }
 
 void conveyor_opcontrol(controller_digital_e_t up_button,
                         controller_digital_e_t down_button) {
@@ -25,6 +26,6 @@ void conveyor_opcontrol(controller_digital_e_t up_button,
 		conveyor_down();
 	} else {
 		// Turn off if no inputs
-		rgt_mg_move(conveyor_run, 0);
+		rgt_mg_move(&conveyor_run, 0);
 	}
 }
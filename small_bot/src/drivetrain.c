@@ -15,8 +15,8 @@
  */
 
 // Motor groups for each side of the drivetrain
-static rgt_motor_group left_motors = {-11, -12, -13};
-static rgt_motor_group right_motors = {14, 15, 16};
+static Rgt_Motor_Group left_motors = RGT_MOTOR_GROUP(-11, -12, -13);
+static Rgt_Motor_Group right_motors = RGT_MOTOR_GROUP(14, 15, 16);
 
 /**
  * Ringtail task variables and function prototypes for each side of the
@@ -58,10 +58,11 @@ void drivetrain_init(void) {
 	left_mutex = mutex_create();
 	right_mutex = mutex_create();
 
-	left_pid_info = rgt_controller_info_init(
-	    left_motors, left_mg_get_pos, left_mg_controller, left_mutex, 5.0, 20);
+	left_pid_info =
+	    rgt_controller_info_init(&left_motors, left_mg_get_pos,
+	                             left_mg_controller, left_mutex, 5.0, 20);
 	right_pid_info =
-	    rgt_controller_info_init(right_motors, right_mg_get_pos,
+	    rgt_controller_info_init(&right_motors, right_mg_get_pos,
 	                             right_mg_controller, right_mutex, 5.0, 20);
 
 	left_pid_task = rgt_controller_create(&left_pid_info, TASK_PRIORITY_DEFAULT,
@@ -74,8 +75,8 @@ void drivetrain_init(void) {
 
 void drivetrain_opcontrol(controller_analog_e_t left,
                           controller_analog_e_t right) {
-	rgt_mg_move(left_motors, controller_get_analog(E_CONTROLLER_MASTER, left));
-	rgt_mg_move(right_motors,
+	rgt_mg_move(&left_motors, controller_get_analog(E_CONTROLLER_MASTER, left));
+	rgt_mg_move(&right_motors,
 	            controller_get_analog(E_CONTROLLER_MASTER, right));
 }
 
@@ -95,12 +96,12 @@ void drivetrain_turn_angle(double angle) {
 double left_mg_get_pos(void) {
 	// Return average motor encoder position, accounting for 5:3 gear ratio from
 	// motor to wheel
-	return rgt_mg_get_average_position(left_motors) * GEAR_RATIO;
+	return rgt_mg_get_average_position(&left_motors) * GEAR_RATIO;
 }
 double right_mg_get_pos(void) {
 	// Return average motor encoder position, accounting for 5:3 gear ratio from
 	// motor to wheel
-	return rgt_mg_get_average_position(right_motors) * GEAR_RATIO;
+	return rgt_mg_get_average_position(&right_motors) * GEAR_RATIO;
 }
 
 double left_mg_controller(double target, double current, bool reset) {
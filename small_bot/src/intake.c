@@ -11,20 +11,25 @@
  * intake
  */
 
-static rgt_motor_group intake_pivot = {8};
-static rgt_motor_group intake_motors = {-9};
+/**
+ * The pivot is on port 8, the same port as the conveyor. The command cache is
+ * kept per port, so the two groups share its entry, and only one of them may
+ * command the motor - the pivot stays disabled while the conveyor drives it.
+ */
+static Rgt_Motor_Group intake_pivot = RGT_MOTOR_GROUP(8);
+static Rgt_Motor_Group intake_motors = RGT_MOTOR_GROUP(-9);
 
 void intake_up(void) {
-	// rgt_mg_move(intake_pivot, 127);  // todo fix voltages
+	// rgt_mg_move(&intake_pivot, 127);  // todo fix voltages
 }
 
 void intake_down() {
-	// rgt_mg_move(intake_pivot, -127);
+	// rgt_mg_move(&intake_pivot, -127);
 }
 
-void intake_in() { rgt_mg_move(intake_motors, 127); }
+void intake_in() { rgt_mg_move(&intake_motors, 127); }
 
-void intake_out() { rgt_mg_move(intake_motors, -127); }
+void intake_out() { rgt_mg_move(&intake_motors, -127); }
 
 void intake_opcontrol(controller_digital_e_t up_button,
                       controller_digital_e_t down_button,
@@ -40,7 +45,7 @@ void intake_opcontrol(controller_digital_e_t up_button,
 		intake_out();
 	} else {
 		// Turn off if no inputs
-		rgt_mg_move(intake_motors, 0);
-		// rgt_mg_move(intake_pivot, 0);
+		rgt_mg_move(&intake_motors, 0);
+		// rgt_mg_move(&intake_pivot, 0);
 	}
 }
@@ -2,6 +2,7 @@
 #include "conveyor.h"
 #include "intake.h"
 #include "pros/misc.h"
+#include "ringtail/motor_group.h"
 #include "spike.h"
 
 #include "drivetrain.h"
@@ -13,6 +14,9 @@
  * to keep execution time for this mode under a few seconds.
  */
 void initialize() {
+	// Skip repeated identical motor commands from the opcontrol loop, but
+	// re-send them every 100 ms in case a motor reconnected
+	rgt_mg_command_cache_enable(100);
 	spike_init(); // Initialize the spike
 }
 
@@ -0,0 +1,163 @@
+#include "ringtail/autotune.h"
+
+#include "ringtail/reference_controllers.h"
+
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file autotune.c
+ *
+ * @brief Function implementations for Ringtail's relay-feedback autotuner
+ */
+
+Rgt_Autotune rgt_autotune_init(double amplitude, double hysteresis,
+                               double max_deviation, uint8_t cycles,
+                               uint32_t timeout) {
+	// At least one cycle, so the result is an average of something
+	if (cycles < 1)
+		cycles = 1;
+	if (cycles > RGT_AUTOTUNE_MAX_CYCLES)
+		cycles = RGT_AUTOTUNE_MAX_CYCLES;
+	return (Rgt_Autotune){
+	    .amplitude = amplitude,
+	    .bias = 0,
+	    .hysteresis = hysteresis,
+	    .max_deviation = max_deviation,
+	    .cycles = cycles,
+	    .timeout = timeout,
+	    .state = RGT_AUTOTUNE_RUNNING,
+	    .result = {0, 0, 0, 0},
+	    .started = false,
+	    .in_cycle = false,
+	};
+}
+
+// Ends the autotune. The result is written before the state is published
+static void rgt_autotune_finish(Rgt_Autotune *a, Rgt_Autotune_State state) {
+	if (state == RGT_AUTOTUNE_DONE) {
+		double period = 0;
+		double amplitude = 0;
+		// The first cycle is skipped - the mechanism was still settling
+		for (uint8_t c = 1; c <= a->cycles; c++) {
+			period += a->periods[c];
+			amplitude += a->amplitudes[c];
+		}
+		period /= a->cycles;
+		amplitude /= a->cycles;
+
+		// The relay's describing function, corrected for the hysteresis
+		double effective = amplitude > a->hysteresis
+		                       ? sqrt(amplitude * amplitude -
+		                              a->hysteresis * a->hysteresis)
+		                       : amplitude;
+		a->result = (Rgt_Autotune_Result){
+		    .ultimate_gain = 4 * a->amplitude / (M_PI * effective),
+		    .ultimate_period = period,
+		    .amplitude = amplitude,
+		    .cycles = a->cycles,
+		};
+	}
+	__atomic_store_n(&a->state, state, __ATOMIC_RELEASE);
+}
+
+double rgt_autotune_controller(void *autotune, double target, double current,
+                               bool reset) {
+	Rgt_Autotune *a = (Rgt_Autotune *)autotune;
+	uint64_t now = micros();
+	double error = target - current;
+
+	if (reset || !a->started) {
+		a->started = true;
+		a->in_cycle = false;
+		a->relay_high = error > 0;
+		a->start_time = now;
+		a->cycles_seen = 0;
+		__atomic_store_n(&a->state, RGT_AUTOTUNE_RUNNING, __ATOMIC_RELEASE);
+	}
+	if (a->state != RGT_AUTOTUNE_RUNNING)
+		return 0;
+
+	if (a->max_deviation > 0 && fabs(error) > a->max_deviation) {
+		rgt_autotune_finish(a, RGT_AUTOTUNE_ABORTED);
+		return 0;
+	}
+	if (now - a->start_time >= (uint64_t)a->timeout * 1000) {
+		rgt_autotune_finish(a, RGT_AUTOTUNE_TIMED_OUT);
+		return 0;
+	}
+
+	if (current > a->cycle_max)
+		a->cycle_max = current;
+	if (current < a->cycle_min)
+		a->cycle_min = current;
+
+	if (!a->relay_high && error > a->hysteresis) {
+		// Every switch to high ends one oscillation and starts the next
+		a->relay_high = true;
+		if (a->in_cycle) {
+			a->periods[a->cycles_seen] = (now - a->cycle_start) / 1e6;
+			a->amplitudes[a->cycles_seen] = (a->cycle_max - a->cycle_min) / 2;
+			a->cycles_seen++;
+			if (a->cycles_seen > a->cycles) {
+				rgt_autotune_finish(a, RGT_AUTOTUNE_DONE);
+				return 0;
+			}
+		}
+		a->in_cycle = true;
+		a->cycle_start = now;
+		a->cycle_max = current;
+		a->cycle_min = current;
+	} else if (a->relay_high && error < -a->hysteresis) {
+		a->relay_high = false;
+	}
+
+	return a->bias + (a->relay_high ? a->amplitude : -a->amplitude);
+}
+
+Rgt_Autotune_State rgt_autotune_get_state(Rgt_Autotune *a) {
+	return __atomic_load_n(&a->state, __ATOMIC_ACQUIRE);
+}
+
+bool rgt_autotune_get_result(Rgt_Autotune *a, Rgt_Autotune_Result *result) {
+	if (rgt_autotune_get_state(a) != RGT_AUTOTUNE_DONE)
+		return false;
+	*result = a->result;
+	return true;
+}
+
+Rgt_PID rgt_autotune_gains(const Rgt_Autotune_Result *result,
+                           Rgt_Autotune_Rule rule, uint32_t period) {
+	double ku = result->ultimate_gain;
+	double tu = result->ultimate_period;
+
+	// The gain, integral time, and derivative time of each rule
+	double kp;
+	double ti;
+	double td;
+	switch (rule) {
+	case RGT_AUTOTUNE_ZIEGLER_NICHOLS_PI:
+		kp = 0.45 * ku;
+		ti = tu / 1.2;
+		td = 0;
+		break;
+	case RGT_AUTOTUNE_TYREUS_LUYBEN:
+		kp = ku / 2.2;
+		ti = 2.2 * tu;
+		td = tu / 6.3;
+		break;
+	case RGT_AUTOTUNE_ZIEGLER_NICHOLS:
+	default:
+		kp = 0.6 * ku;
+		ti = tu / 2;
+		td = tu / 8;
+		break;
+	}
+
+	// pid's integral and derivative are per update, not per second
+	double dt = period / 1000.0;
+	return rgt_pid_init(kp, ti > 0 ? kp * dt / ti : 0, kp * td / dt);
+}
@@ -0,0 +1,668 @@
+#include "ringtail/controller.h"
+
+#include "ringtail/motor_group.h"
+
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @file controller.c
+ *
+ * @brief Function implementations for Ringtail's generic controller system
+ */
+
+/**
+ * The controller's shared fields are plain types so the header works from C++
+ * too, and are accessed with GCC's __atomic builtins. The target is a double,
+ * which needs 64-bit atomics to be lock-free - the V5's Cortex-A9 has them.
+ */
+_Static_assert(__atomic_always_lock_free(sizeof(double), 0),
+               "Controller targets must be lock-free");
+
+/**
+ * Records the start of a cycle in a controller's timing statistics, given the
+ * controller's timing fields. Only called by the controller loop, which is the
+ * only task that publishes them.
+ */
+static void rgt_controller_record_timing(Rgt_Controller_Timing timing[2],
+                                         uint32_t *timing_seq,
+                                         bool *timing_reset,
+                                         uint64_t *last_cycle_time,
+                                         uint32_t period_ms) {
+	uint64_t now = micros();
+	uint64_t last = *last_cycle_time;
+	*last_cycle_time = now;
+
+	uint32_t seq = __atomic_load_n(timing_seq, __ATOMIC_RELAXED);
+	Rgt_Controller_Timing t = timing[seq & 1];
+	if (__atomic_exchange_n(timing_reset, false, __ATOMIC_ACQUIRE)) {
+		t = (Rgt_Controller_Timing){0};
+		last = 0;
+	}
+	if (last != 0) {
+		uint32_t period = (uint32_t)(now - last);
+		t.cycles++;
+		if (t.cycles == 1 || period < t.min_period)
+			t.min_period = period;
+		if (period > t.max_period)
+			t.max_period = period;
+		t.mean_period += (period - t.mean_period) / t.cycles;
+		if (period > period_ms * 1000 + RGT_CONTROLLER_OVERRUN_MARGIN)
+			t.overruns++;
+	}
+
+	// Readers only look at timing[timing_seq & 1], so the other one is free
+	timing[(seq + 1) & 1] = t;
+	__atomic_store_n(timing_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static void rgt_controller_record_cycle(Rgt_Controller_Info *i) {
+	rgt_controller_record_timing(i->timing, &i->timing_seq, &i->timing_reset,
+	                             &i->last_cycle_time, i->period);
+}
+
+// Reads a controller's timing statistics without locking
+static Rgt_Controller_Timing
+rgt_controller_read_timing(const Rgt_Controller_Timing timing[2],
+                           const uint32_t *timing_seq) {
+	Rgt_Controller_Timing t;
+	uint32_t seq;
+	do {
+		// Retry only if the loop published again while this was copying
+		seq = __atomic_load_n(timing_seq, __ATOMIC_ACQUIRE);
+		t = timing[seq & 1];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(timing_seq, __ATOMIC_RELAXED) != seq);
+	return t;
+}
+
+/*******************************************************************************
+ *                                  Profiling                                  *
+ ******************************************************************************/
+
+#if RGT_CONTROLLER_PROFILING
+/**
+ * Adds a duration to a histogram. Only the controller loop writes to its
+ * histograms, so plain reads are enough here - the stores are atomic so
+ * readers never see a torn value.
+ */
+static void rgt_controller_histogram_add(Rgt_Controller_Histogram *h,
+                                         uint32_t duration) {
+	uint8_t bucket =
+	    duration == 0 ? 0 : (uint8_t)(32 - __builtin_clz(duration));
+	if (bucket >= RGT_CONTROLLER_HISTOGRAM_BUCKETS)
+		bucket = RGT_CONTROLLER_HISTOGRAM_BUCKETS - 1;
+
+	__atomic_store_n(&h->counts[bucket], h->counts[bucket] + 1,
+	                 __ATOMIC_RELAXED);
+	__atomic_store_n(&h->samples, h->samples + 1, __ATOMIC_RELAXED);
+	if (duration > h->max)
+		__atomic_store_n(&h->max, duration, __ATOMIC_RELAXED);
+	__atomic_store_n(&h->total, h->total + duration, __ATOMIC_RELAXED);
+}
+
+/**
+ * Starts profiling a cycle: records how late it started, and returns the time
+ * (us) it started. period is the controller's period, in ms.
+ */
+static uint64_t rgt_controller_profile_begin(Rgt_Controller_Profiler *p,
+                                             uint32_t period) {
+	uint64_t now = micros();
+	if (__atomic_exchange_n(&p->reset, false, __ATOMIC_ACQUIRE)) {
+		memset(&p->profile, 0, sizeof(p->profile));
+		p->next_cycle_time = 0;
+	}
+
+	uint64_t scheduled = now;
+	if (p->next_cycle_time != 0) {
+		uint32_t lateness = now > p->next_cycle_time
+		                        ? (uint32_t)(now - p->next_cycle_time)
+		                        : 0;
+		rgt_controller_histogram_add(&p->profile.lateness, lateness);
+		// A cycle more than a period late means cycles were missed (or the
+		// controller was paused), so restart the schedule from this one
+		if (lateness <= period * 1000)
+			scheduled = p->next_cycle_time;
+	}
+	p->next_cycle_time = scheduled + period * 1000;
+	return now;
+}
+
+/**
+ * Records the time since *start in a histogram, and moves *start to now, so
+ * consecutive calls time consecutive stages of a cycle
+ */
+static void rgt_controller_profile_stage(Rgt_Controller_Histogram *h,
+                                         uint64_t *start) {
+	uint64_t now = micros();
+	rgt_controller_histogram_add(h, (uint32_t)(now - *start));
+	*start = now;
+}
+
+// Copies a histogram without locking - see Rgt_Controller_Profiler
+static void rgt_controller_histogram_copy(const Rgt_Controller_Histogram *from,
+                                          Rgt_Controller_Histogram *to) {
+	for (uint8_t b = 0; b < RGT_CONTROLLER_HISTOGRAM_BUCKETS; b++)
+		to->counts[b] = __atomic_load_n(&from->counts[b], __ATOMIC_RELAXED);
+	to->samples = __atomic_load_n(&from->samples, __ATOMIC_RELAXED);
+	to->max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+	to->total = __atomic_load_n(&from->total, __ATOMIC_RELAXED);
+}
+
+static void rgt_controller_profile_copy(const Rgt_Controller_Profile *from,
+                                        Rgt_Controller_Profile *to) {
+	rgt_controller_histogram_copy(&from->sensor, &to->sensor);
+	rgt_controller_histogram_copy(&from->compute, &to->compute);
+	rgt_controller_histogram_copy(&from->actuate, &to->actuate);
+	rgt_controller_histogram_copy(&from->lateness, &to->lateness);
+}
+
+// Times the stages of a cycle. Compiled out along with the profiling
+#define RGT_PROFILE_BEGIN(profiler, period)                                    \
+	uint64_t profile_start = rgt_controller_profile_begin(                     \
+	    profiler, __atomic_load_n(&(period), __ATOMIC_RELAXED))
+#define RGT_PROFILE_STAGE(profiler, stage)                                     \
+	rgt_controller_profile_stage(&(profiler)->profile.stage, &profile_start)
+#else
+#define RGT_PROFILE_BEGIN(profiler, period)
+#define RGT_PROFILE_STAGE(profiler, stage)
+#endif
+
+uint32_t rgt_controller_histogram_percentile(const Rgt_Controller_Histogram *h,
+                                             double percentile) {
+	if (h->samples == 0)
+		return 0;
+
+	// The number of samples at or below the percentile, rounded up
+	uint32_t rank = (uint32_t)ceil(h->samples * percentile / 100);
+	if (rank == 0)
+		rank = 1;
+	uint32_t seen = 0;
+	for (uint8_t b = 0; b < RGT_CONTROLLER_HISTOGRAM_BUCKETS; b++) {
+		seen += h->counts[b];
+		if (seen >= rank) {
+			uint32_t upper = b == 0 ? 0 : (UINT32_C(1) << b) - 1;
+			return upper < h->max ? upper : h->max;
+		}
+	}
+	return h->max;
+}
+
+/*******************************************************************************
+ *                                 Controllers                                 *
+ ******************************************************************************/
+
+// Wakes every task waiting on a controller
+static void rgt_controller_notify_waiters(task_t *waiters) {
+	for (uint8_t w = 0; w < RGT_CONTROLLER_MAX_WAITERS; w++) {
+		task_t waiter = __atomic_load_n(&waiters[w], __ATOMIC_ACQUIRE);
+		if (waiter != NULL)
+			task_notify(waiter);
+	}
+}
+
+void rgt_controller_step(Rgt_Controller_Info *i) {
+	rgt_controller_record_cycle(i);
+	RGT_PROFILE_BEGIN(&i->profiler, i->period);
+
+	double current = i->get_sensor_data_ctx != NULL
+	                     ? i->get_sensor_data_ctx(i->sensor_context)
+	                     : i->get_sensor_data();
+	RGT_PROFILE_STAGE(&i->profiler, sensor);
+	double target;
+	__atomic_load(&i->target, &target, __ATOMIC_ACQUIRE);
+
+	if (fabs(target - current) <= i->error_settle_threshold) {
+		i->error_below_thresh_cnt++;
+		if (i->error_below_thresh_cnt >= i->error_below_thresh_max_cnt &&
+		    !__atomic_exchange_n(&i->at_target, true, __ATOMIC_ACQ_REL))
+			rgt_controller_notify_waiters(i->waiters);
+	} else {
+		// The count is of consecutive cycles, so leaving the band restarts it
+		i->error_below_thresh_cnt = 0;
+	}
+
+	bool reset = __atomic_load_n(&i->reset, __ATOMIC_ACQUIRE);
+	if (reset) {
+		// Clear at_target before the reset flag, so readers that see the flag
+		// cleared never see the old at_target
+		__atomic_store_n(&i->at_target, false, __ATOMIC_RELEASE);
+		__atomic_store_n(&i->reset, false, __ATOMIC_RELEASE);
+		i->error_below_thresh_cnt = 0;
+	}
+
+	double voltage =
+	    i->calculate_voltage_ctx != NULL
+	        ? i->calculate_voltage_ctx(i->controller_context, target, current,
+	                                   reset)
+	        : i->calculate_voltage(target, current, reset);
+
+	// Clamp the voltage to the range the motors accept
+	if (voltage > 12000)
+		voltage = 12000;
+	else if (voltage < -12000)
+		voltage = -12000;
+	RGT_PROFILE_STAGE(&i->profiler, compute);
+
+	rgt_mg_move_voltage(i->mg, (int16_t)voltage);
+	RGT_PROFILE_STAGE(&i->profiler, actuate);
+}
+
+/**
+ * The function run by every Ringtail controller task. The parameter is the
+ * Rgt_Controller_Info pointer passed to rgt_controller_create.
+ */
+void rgt_controller_fn(void *param) {
+	Rgt_Controller_Info *i = (Rgt_Controller_Info *)param;
+	uint32_t now = millis();
+
+	while (true) {
+		rgt_controller_step(i);
+		task_delay_until(&now, __atomic_load_n(&i->period, __ATOMIC_RELAXED));
+	}
+}
+
+Rgt_Controller_Info
+rgt_controller_info_init(const Rgt_Motor_Group *mg,
+                         double (*get_sensor_data)(void),
+                         double (*calculate_voltage)(double, double, bool),
+                         mutex_t mutex, double error_settle_threshold,
+                         uint32_t error_below_thresh_max_cnt) {
+	return (Rgt_Controller_Info){
+	    .mg = mg,
+	    .get_sensor_data = get_sensor_data,
+	    .calculate_voltage = calculate_voltage,
+	    .get_sensor_data_ctx = NULL,
+	    .calculate_voltage_ctx = NULL,
+	    .sensor_context = NULL,
+	    .controller_context = NULL,
+	    .target = 0,
+	    .reset = false,
+	    .at_target = false,
+	    .error_settle_threshold = error_settle_threshold,
+	    .error_below_thresh_max_cnt = error_below_thresh_max_cnt,
+	    .mutex = mutex,
+	    .error_below_thresh_cnt = 0,
+	    .period = RGT_CONTROLLER_DEFAULT_PERIOD,
+	    .timing = {{0}, {0}},
+	    .timing_seq = 0,
+	    .timing_reset = false,
+	    .last_cycle_time = 0,
+	    .waiters = {NULL},
+#if RGT_CONTROLLER_PROFILING
+	    .profiler = {.reset = false, .next_cycle_time = 0},
+#endif
+	};
+}
+
+Rgt_Controller_Info rgt_controller_info_init_ctx(
+    const Rgt_Motor_Group *mg, double (*get_sensor_data)(void *),
+    void *sensor_context,
+    double (*calculate_voltage)(void *, double, double, bool),
+    void *controller_context, mutex_t mutex, double error_settle_threshold,
+    uint32_t error_below_thresh_max_cnt) {
+	Rgt_Controller_Info i =
+	    rgt_controller_info_init(mg, NULL, NULL, mutex, error_settle_threshold,
+	                             error_below_thresh_max_cnt);
+	i.get_sensor_data_ctx = get_sensor_data;
+	i.calculate_voltage_ctx = calculate_voltage;
+	i.sensor_context = sensor_context;
+	i.controller_context = controller_context;
+	return i;
+}
+
+task_t rgt_controller_create(Rgt_Controller_Info *i, uint8_t priority,
+                             uint16_t stack_depth, const char *name) {
+	return task_create(rgt_controller_fn, i, priority, stack_depth, name);
+}
+
+void rgt_controller_set_period(Rgt_Controller_Info *i, uint32_t period) {
+	__atomic_store_n(&i->period, period, __ATOMIC_RELAXED);
+}
+
+Rgt_Controller_Timing rgt_controller_get_timing(Rgt_Controller_Info *i) {
+	return rgt_controller_read_timing(i->timing, &i->timing_seq);
+}
+
+void rgt_controller_reset_timing(Rgt_Controller_Info *i) {
+	__atomic_store_n(&i->timing_reset, true, __ATOMIC_RELEASE);
+}
+
+bool rgt_controller_get_profile(Rgt_Controller_Info *i,
+                                Rgt_Controller_Profile *profile) {
+#if RGT_CONTROLLER_PROFILING
+	rgt_controller_profile_copy(&i->profiler.profile, profile);
+	return true;
+#else
+	(void)i;
+	memset(profile, 0, sizeof(*profile));
+	return false;
+#endif
+}
+
+void rgt_controller_reset_profile(Rgt_Controller_Info *i) {
+#if RGT_CONTROLLER_PROFILING
+	__atomic_store_n(&i->profiler.reset, true, __ATOMIC_RELEASE);
+#else
+	(void)i;
+#endif
+}
+
+bool rgt_controller_at_target(Rgt_Controller_Info *i) {
+	// A pending reset means the controller hasn't evaluated the new state yet.
+	// The flag is read first - see rgt_controller_step
+	if (__atomic_load_n(&i->reset, __ATOMIC_ACQUIRE))
+		return false;
+	return __atomic_load_n(&i->at_target, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Adds a task to a controller's waiters. Returns false if every slot is
+ * taken.
+ */
+static bool rgt_controller_add_waiter(task_t *waiters, task_t task) {
+	for (uint8_t w = 0; w < RGT_CONTROLLER_MAX_WAITERS; w++) {
+		task_t expected = NULL;
+		if (__atomic_compare_exchange_n(&waiters[w], &expected, task, false,
+		                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return true;
+	}
+	return false;
+}
+
+static void rgt_controller_remove_waiter(task_t *waiters, task_t task) {
+	for (uint8_t w = 0; w < RGT_CONTROLLER_MAX_WAITERS; w++) {
+		task_t expected = task;
+		if (__atomic_compare_exchange_n(&waiters[w], &expected, NULL, false,
+		                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return;
+	}
+}
+
+/**
+ * Waits for all (or any) of the controllers to reach their targets. Returns 0
+ * when all settled, the index of the first settled controller for any, or -1
+ * on timeout. waiters and at_target get a controller's waiter slots and
+ * at_target value, so this works for every kind of controller.
+ */
+static int rgt_controller_wait(void *const *controllers, uint8_t count,
+                               task_t *(*waiters)(void *),
+                               bool (*at_target)(void *), bool all,
+                               uint32_t timeout, uint32_t *elapsed) {
+	uint32_t start = millis();
+	task_t self = task_get_current();
+
+	// Registering before the first check means a target reached in between
+	// still sends a notification
+	bool registered = true;
+	for (uint8_t c = 0; c < count; c++)
+		registered &= rgt_controller_add_waiter(waiters(controllers[c]), self);
+
+	int result = -1;
+	while (true) {
+		uint8_t settled = 0;
+		for (uint8_t c = 0; c < count; c++) {
+			if (at_target(controllers[c])) {
+				settled++;
+				if (!all && result < 0)
+					result = c;
+			}
+		}
+		if (all && settled == count)
+			result = 0;
+		if (result >= 0)
+			break;
+
+		uint32_t waited = millis() - start;
+		if (timeout != TIMEOUT_MAX && waited >= timeout)
+			break;
+
+		uint32_t block =
+		    timeout == TIMEOUT_MAX ? TIMEOUT_MAX : timeout - waited;
+		// Without a waiter slot on every controller, fall back to polling
+		if (!registered && block > RGT_CONTROLLER_DEFAULT_PERIOD)
+			block = RGT_CONTROLLER_DEFAULT_PERIOD;
+		task_notify_take(true, block);
+	}
+
+	for (uint8_t c = 0; c < count; c++)
+		rgt_controller_remove_waiter(waiters(controllers[c]), self);
+
+	if (elapsed != NULL)
+		*elapsed = millis() - start;
+	return result;
+}
+
+static task_t *rgt_controller_waiters(void *i) {
+	return ((Rgt_Controller_Info *)i)->waiters;
+}
+
+static bool rgt_controller_settled(void *i) {
+	return rgt_controller_at_target((Rgt_Controller_Info *)i);
+}
+
+bool rgt_controller_wait_settled(Rgt_Controller_Info *i, uint32_t timeout,
+                                 uint32_t *elapsed) {
+	return rgt_controller_wait((void *const *)&i, 1, rgt_controller_waiters,
+	                           rgt_controller_settled, true, timeout,
+	                           elapsed) >= 0;
+}
+
+bool rgt_controller_wait_all(Rgt_Controller_Info *const *infos, uint8_t count,
+                             uint32_t timeout, uint32_t *elapsed) {
+	return rgt_controller_wait((void *const *)infos, count,
+	                           rgt_controller_waiters, rgt_controller_settled,
+	                           true, timeout, elapsed) >= 0;
+}
+
+int rgt_controller_wait_any(Rgt_Controller_Info *const *infos, uint8_t count,
+                            uint32_t timeout, uint32_t *elapsed) {
+	return rgt_controller_wait((void *const *)infos, count,
+	                           rgt_controller_waiters, rgt_controller_settled,
+	                           false, timeout, elapsed);
+}
+
+void rgt_controller_reset(Rgt_Controller_Info *i) {
+	__atomic_store_n(&i->reset, true, __ATOMIC_RELEASE);
+}
+
+void rgt_controller_set_target(Rgt_Controller_Info *i, double target) {
+	__atomic_store(&i->target, &target, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+ *                             Coupled Controllers                             *
+ ******************************************************************************/
+
+Rgt_Coupled_Controller rgt_coupled_controller_init(
+    const Rgt_Motor_Group *const *mgs, uint8_t output_count,
+    uint8_t axis_count, void (*get_sensor_data)(void *, double *),
+    void *sensor_context,
+    void (*calculate_voltages)(void *, const double *, const double *, bool,
+                               double *),
+    void *controller_context, const double *error_settle_thresholds,
+    uint32_t error_below_thresh_max_cnt) {
+	Rgt_Coupled_Controller c = {
+	    .mgs = {NULL},
+	    .output_count = output_count,
+	    .axis_count = axis_count,
+	    .get_sensor_data = get_sensor_data,
+	    .sensor_context = sensor_context,
+	    .calculate_voltages = calculate_voltages,
+	    .controller_context = controller_context,
+	    .error_settle_thresholds = {0},
+	    .error_below_thresh_max_cnt = error_below_thresh_max_cnt,
+	    .period = RGT_CONTROLLER_DEFAULT_PERIOD,
+	    .targets = {{0}, {0}},
+	    .target_seq = 0,
+	    .timing = {{0}, {0}},
+	    .timing_seq = 0,
+	    .timing_reset = false,
+	    .last_cycle_time = 0,
+	    .reset = false,
+	    .at_target = false,
+	    .error_below_thresh_cnt = 0,
+	    .waiters = {NULL},
+#if RGT_CONTROLLER_PROFILING
+	    .profiler = {.reset = false, .next_cycle_time = 0},
+#endif
+	};
+	for (uint8_t o = 0; o < output_count && o < RGT_COUPLED_MAX_OUTPUTS; o++)
+		c.mgs[o] = mgs[o];
+	for (uint8_t a = 0; a < axis_count && a < RGT_COUPLED_MAX_AXES; a++)
+		c.error_settle_thresholds[a] = error_settle_thresholds[a];
+	return c;
+}
+
+void rgt_coupled_controller_step(Rgt_Coupled_Controller *c) {
+	rgt_controller_record_timing(c->timing, &c->timing_seq, &c->timing_reset,
+	                             &c->last_cycle_time, c->period);
+	RGT_PROFILE_BEGIN(&c->profiler, c->period);
+
+	double values[RGT_COUPLED_MAX_AXES];
+	c->get_sensor_data(c->sensor_context, values);
+	RGT_PROFILE_STAGE(&c->profiler, sensor);
+	// A value that couldn't be read (PROS_ERR_F, or NaN from one) would become
+	// a wild voltage, so skip the cycle and leave the motors as they are
+	for (uint8_t a = 0; a < c->axis_count; a++) {
+		if (!isfinite(values[a]))
+			return;
+	}
+
+	// Copy the targets, retrying only if new ones were published mid-copy
+	double targets[RGT_COUPLED_MAX_AXES];
+	uint32_t seq;
+	do {
+		seq = __atomic_load_n(&c->target_seq, __ATOMIC_ACQUIRE);
+		for (uint8_t a = 0; a < c->axis_count; a++)
+			targets[a] = c->targets[seq & 1][a];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&c->target_seq, __ATOMIC_RELAXED) != seq);
+
+	bool settled = true;
+	for (uint8_t a = 0; a < c->axis_count; a++) {
+		if (fabs(targets[a] - values[a]) > c->error_settle_thresholds[a])
+			settled = false;
+	}
+	if (settled) {
+		c->error_below_thresh_cnt++;
+		if (c->error_below_thresh_cnt >= c->error_below_thresh_max_cnt &&
+		    !__atomic_exchange_n(&c->at_target, true, __ATOMIC_ACQ_REL))
+			rgt_controller_notify_waiters(c->waiters);
+	} else {
+		c->error_below_thresh_cnt = 0;
+	}
+
+	bool reset = __atomic_load_n(&c->reset, __ATOMIC_ACQUIRE);
+	if (reset) {
+		// Same order as rgt_controller_step
+		__atomic_store_n(&c->at_target, false, __ATOMIC_RELEASE);
+		__atomic_store_n(&c->reset, false, __ATOMIC_RELEASE);
+		c->error_below_thresh_cnt = 0;
+	}
+
+	double voltages[RGT_COUPLED_MAX_OUTPUTS];
+	c->calculate_voltages(c->controller_context, targets, values, reset,
+	                      voltages);
+	RGT_PROFILE_STAGE(&c->profiler, compute);
+
+	// Every voltage is computed before any group moves, so the groups are
+	// commanded back to back from the same sensor reading
+	for (uint8_t o = 0; o < c->output_count; o++) {
+		double voltage = voltages[o];
+		if (voltage > 12000)
+			voltage = 12000;
+		else if (voltage < -12000)
+			voltage = -12000;
+		rgt_mg_move_voltage(c->mgs[o], (int16_t)voltage);
+	}
+	RGT_PROFILE_STAGE(&c->profiler, actuate);
+}
+
+// The function run by every Ringtail coupled controller task
+static void rgt_coupled_controller_fn(void *param) {
+	Rgt_Coupled_Controller *c = (Rgt_Coupled_Controller *)param;
+	uint32_t now = millis();
+
+	while (true) {
+		rgt_coupled_controller_step(c);
+		task_delay_until(&now, __atomic_load_n(&c->period, __ATOMIC_RELAXED));
+	}
+}
+
+task_t rgt_coupled_controller_create(Rgt_Coupled_Controller *c,
+                                     uint8_t priority, uint16_t stack_depth,
+                                     const char *name) {
+	return task_create(rgt_coupled_controller_fn, c, priority, stack_depth,
+	                   name);
+}
+
+void rgt_coupled_controller_set_targets(Rgt_Coupled_Controller *c,
+                                        const double *targets) {
+	uint32_t next = __atomic_load_n(&c->target_seq, __ATOMIC_RELAXED) + 1;
+
+	// The loop only reads targets[target_seq & 1], so the other one is free
+	for (uint8_t a = 0; a < c->axis_count; a++)
+		c->targets[next & 1][a] = targets[a];
+	__atomic_store_n(&c->target_seq, next, __ATOMIC_RELEASE);
+}
+
+void rgt_coupled_controller_reset(Rgt_Coupled_Controller *c) {
+	__atomic_store_n(&c->reset, true, __ATOMIC_RELEASE);
+}
+
+bool rgt_coupled_controller_at_target(Rgt_Coupled_Controller *c) {
+	if (__atomic_load_n(&c->reset, __ATOMIC_ACQUIRE))
+		return false;
+	return __atomic_load_n(&c->at_target, __ATOMIC_ACQUIRE);
+}
+
+static task_t *rgt_coupled_controller_waiters(void *c) {
+	return ((Rgt_Coupled_Controller *)c)->waiters;
+}
+
+static bool rgt_coupled_controller_settled(void *c) {
+	return rgt_coupled_controller_at_target((Rgt_Coupled_Controller *)c);
+}
+
+bool rgt_coupled_controller_wait_settled(Rgt_Coupled_Controller *c,
+                                         uint32_t timeout, uint32_t *elapsed) {
+	return rgt_controller_wait((void *const *)&c, 1,
+	                           rgt_coupled_controller_waiters,
+	                           rgt_coupled_controller_settled, true, timeout,
+	                           elapsed) >= 0;
+}
+
+Rgt_Controller_Timing
+rgt_coupled_controller_get_timing(Rgt_Coupled_Controller *c) {
+	return rgt_controller_read_timing(c->timing, &c->timing_seq);
+}
+
+void rgt_coupled_controller_reset_timing(Rgt_Coupled_Controller *c) {
+	__atomic_store_n(&c->timing_reset, true, __ATOMIC_RELEASE);
+}
+
+bool rgt_coupled_controller_get_profile(Rgt_Coupled_Controller *c,
+                                        Rgt_Controller_Profile *profile) {
+#if RGT_CONTROLLER_PROFILING
+	rgt_controller_profile_copy(&c->profiler.profile, profile);
+	return true;
+#else
+	(void)c;
+	memset(profile, 0, sizeof(*profile));
+	return false;
+#endif
+}
+
+void rgt_coupled_controller_reset_profile(Rgt_Coupled_Controller *c) {
+#if RGT_CONTROLLER_PROFILING
+	__atomic_store_n(&c->profiler.reset, true, __ATOMIC_RELEASE);
+#else
+	(void)c;
+#endif
+}
@@ -0,0 +1,242 @@
+#include "ringtail/health.h"
+
+#include "ringtail/motor_group.h"
+
+#include "pros/error.h"
+#include "pros/misc.h"
+#include "pros/motors.h"
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file health.c
+ *
+ * @brief Function implementations for the motor health monitor
+ */
+
+/**
+ * The current limit only gets re-sent when it changes by at least this much
+ * (mA), so temperature noise doesn't turn into a stream of motor commands.
+ */
+#define RGT_HEALTH_LIMIT_STEP 50
+
+// The voltage limit (mV) of a motor with none set
+#define RGT_HEALTH_NO_VOLTAGE_LIMIT 12000
+
+/**
+ * A port's entry in the health table. seq counts the samples published for the
+ * port, and its lowest bit selects which buffer holds the latest one. seq is
+ * only accessed with GCC's __atomic builtins.
+ *
+ * The rest is only touched by the health task: the limits the motor had before
+ * the monitor first read it (the user's, 0 if not read yet), the voltage limit
+ * last applied, and whether the limits the motor holds are known. A motor that
+ * was unplugged may have rebooted with the firmware's defaults, so they aren't.
+ */
+typedef struct {
+	uint32_t seq;
+	Rgt_Motor_Health buffers[2];
+	int32_t user_current_limit;
+	int32_t user_voltage_limit;
+	int32_t voltage_limit;
+	bool limits_known;
+} Rgt_Health_Entry;
+
+static Rgt_Health_Entry health_table[RGT_MG_SIZE];
+
+static const Rgt_Motor_Group *groups[RGT_HEALTH_MAX_GROUPS];
+static const Rgt_Health_Policy *policies[RGT_HEALTH_MAX_GROUPS];
+// Whether any motor in each group was derating at the last update
+static bool group_derating[RGT_HEALTH_MAX_GROUPS];
+// Published with release order after the group's slot is filled in
+static uint8_t group_count = 0;
+
+static task_t health_task = NULL;
+static uint32_t health_period = 100;
+
+// Publishes a sample - only ever called from the health task
+static void rgt_health_publish(uint8_t index, const Rgt_Motor_Health *h) {
+	Rgt_Health_Entry *e = &health_table[index];
+	uint32_t next = __atomic_load_n(&e->seq, __ATOMIC_RELAXED) + 1;
+
+	// Readers only look at buffers[seq & 1], so the other one is free
+	e->buffers[next & 1] = *h;
+	__atomic_store_n(&e->seq, next, __ATOMIC_RELEASE);
+}
+
+bool rgt_health_get(int8_t port, Rgt_Motor_Health *health) {
+	int index = abs(port) - 1;
+	if (index < 0 || index >= RGT_MG_SIZE)
+		return false;
+
+	Rgt_Health_Entry *e = &health_table[index];
+	uint32_t before, after;
+	do {
+		before = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+		*health = e->buffers[before & 1];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+	} while (before != after);
+
+	return before != 0;
+}
+
+double rgt_health_get_max_temperature(const Rgt_Motor_Group *mg) {
+	double max = 0;
+	Rgt_Motor_Health h;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (rgt_health_get(mg->ports[i], &h) && h.temperature > max)
+			max = h.temperature;
+	}
+	return max;
+}
+
+// Determines the current limit a policy calls for at a temperature
+static int32_t rgt_health_current_limit(const Rgt_Health_Policy *p,
+                                        double temperature) {
+	if (temperature <= p->derate_temperature)
+		return p->max_current_limit;
+	if (temperature >= p->critical_temperature)
+		return p->min_current_limit;
+
+	double fraction = (temperature - p->derate_temperature) /
+	                  (p->critical_temperature - p->derate_temperature);
+	return p->max_current_limit -
+	       fraction * (p->max_current_limit - p->min_current_limit);
+}
+
+/**
+ * Reads the limits the user set on a motor, the first time it can be read, so
+ * the policy only ever lowers them
+ */
+static void rgt_health_read_user_limits(int8_t port, Rgt_Health_Entry *e,
+                                        const Rgt_Health_Policy *p) {
+	int32_t current = motor_get_current_limit(port);
+	int32_t voltage = motor_get_voltage_limit(port);
+	e->user_current_limit = current == PROS_ERR ? p->max_current_limit
+	                                             : current;
+	e->user_voltage_limit = voltage == PROS_ERR || voltage <= 0
+	                            ? RGT_HEALTH_NO_VOLTAGE_LIMIT
+	                            : voltage;
+	e->voltage_limit = e->user_voltage_limit;
+	e->limits_known = current != PROS_ERR && voltage != PROS_ERR;
+}
+
+/**
+ * Samples a single motor and applies the group's policy to it. Returns whether
+ * the motor is derating.
+ */
+static bool rgt_health_update(int8_t port, const Rgt_Health_Policy *p) {
+	uint8_t index = abs(port) - 1;
+	Rgt_Health_Entry *e = &health_table[index];
+	// The health task is the only writer, so it can read its own last sample
+	// directly
+	Rgt_Motor_Health prev =
+	    e->buffers[__atomic_load_n(&e->seq, __ATOMIC_RELAXED) & 1];
+
+	Rgt_Motor_Health h = {
+	    .temperature = motor_get_temperature(port),
+	    .faults = motor_get_faults(port),
+	    .flags = motor_get_flags(port),
+	    .over_temp = motor_is_over_temp(port) == 1,
+	    .derating = prev.derating,
+	    .current_limit = prev.current_limit,
+	    .timestamp = millis(),
+	};
+
+	// Don't act on a motor that can't be read (e.g. unplugged). It is still as
+	// hot as it was, so it keeps derating, and its limits are sent again once
+	// it is back
+	if (h.temperature == PROS_ERR_F) {
+		e->limits_known = false;
+		rgt_health_publish(index, &h);
+		return h.derating;
+	}
+
+	if (e->user_current_limit == 0) {
+		rgt_health_read_user_limits(port, e, p);
+		h.current_limit = e->user_current_limit;
+	}
+	// -1 never matches a limit, so both are sent
+	if (!e->limits_known) {
+		h.current_limit = -1;
+		e->voltage_limit = -1;
+		e->limits_known = true;
+	}
+
+	h.derating = h.temperature > p->derate_temperature;
+
+	int32_t limit = rgt_health_current_limit(p, h.temperature);
+	if (limit > e->user_current_limit)
+		limit = e->user_current_limit;
+	if (abs(limit - h.current_limit) >= RGT_HEALTH_LIMIT_STEP ||
+	    (limit != h.current_limit &&
+	     (limit == e->user_current_limit || limit == p->min_current_limit))) {
+		if (motor_set_current_limit(port, limit) == 1)
+			h.current_limit = limit;
+	}
+
+	// A failed write leaves voltage_limit as it was, so it is retried on the
+	// next sample
+	int32_t voltage_limit = e->user_voltage_limit;
+	if (h.derating && p->voltage_cap > 0 && p->voltage_cap < voltage_limit)
+		voltage_limit = p->voltage_cap;
+	if (voltage_limit != e->voltage_limit &&
+	    motor_set_voltage_limit(port, voltage_limit) == 1)
+		e->voltage_limit = voltage_limit;
+
+	rgt_health_publish(index, &h);
+	return h.derating;
+}
+
+void rgt_health_step(void) {
+	uint8_t count = __atomic_load_n(&group_count, __ATOMIC_ACQUIRE);
+	for (uint8_t g = 0; g < count; g++) {
+		bool derating = false;
+		for (uint8_t i = 0; i < groups[g]->count; i++)
+			derating |= rgt_health_update(groups[g]->ports[i], policies[g]);
+
+		// Rumble once when the group starts derating, however many of its
+		// motors crossed the threshold
+		if (derating && !group_derating[g] && policies[g]->alert)
+			controller_rumble(E_CONTROLLER_MASTER, "-");
+		group_derating[g] = derating;
+	}
+}
+
+// The function run by the health monitor task
+static void rgt_health_fn(void *param) {
+	(void)param;
+	uint32_t now = millis();
+
+	while (true) {
+		rgt_health_step();
+		task_delay_until(&now, health_period);
+	}
+}
+
+bool rgt_health_register(const Rgt_Motor_Group *mg,
+                         const Rgt_Health_Policy *policy) {
+	if (group_count >= RGT_HEALTH_MAX_GROUPS)
+		return false;
+
+	// Fill in the slot before publishing it to the health task
+	groups[group_count] = mg;
+	policies[group_count] = policy;
+	__atomic_store_n(&group_count, group_count + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+task_t rgt_health_start(uint32_t period) {
+	if (health_task != NULL)
+		return health_task;
+
+	health_period = period;
+	health_task = task_create(rgt_health_fn, NULL, TASK_PRIORITY_MIN + 1,
+	                          TASK_STACK_DEPTH_DEFAULT, "Ringtail Health");
+	return health_task;
+}
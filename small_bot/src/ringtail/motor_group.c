@@ -0,0 +1,872 @@
+#include "ringtail/motor_group.h"
+
+#include "pros/error.h"
+#include "pros/misc.h"
+#include "pros/motors.h"
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @file motor_group.c
+ *
+ * @brief Function implementations for Ringtail's motor group
+ */
+
+Rgt_Motor_Group rgt_mg_init(const rgt_motor_group ports) {
+	Rgt_Motor_Group mg = {
+	    .count = 0, .ports = {0}, .reversed = 0, .output = NULL};
+
+	for (; mg.count < RGT_MG_SIZE && ports[mg.count] != 0; mg.count++) {
+		int8_t port = ports[mg.count];
+		if (port < 0) {
+			mg.reversed |= (uint32_t)1 << mg.count;
+			port = -port;
+		}
+		mg.ports[mg.count] = port;
+	}
+
+	return mg;
+}
+
+void rgt_mg_set_output(Rgt_Motor_Group *mg, Rgt_MG_Output *output) {
+	if (output != NULL) {
+		for (uint8_t i = 0; i < RGT_MG_SIZE; i++)
+			output->balance_trims[i] = 0;
+		output->slew_output = 0;
+		output->slew_rate = 0;
+		output->stats = (Rgt_MG_Output_Stats){0, 0, 0};
+	}
+	mg->output = output;
+}
+
+/*******************************************************************************
+ *                                Command Cache                                *
+ ******************************************************************************/
+
+// The kinds of commands tracked by the command cache
+enum {
+	RGT_MG_CMD_NONE = 0,
+	RGT_MG_CMD_BRAKE,
+	RGT_MG_CMD_MOVE,
+	RGT_MG_CMD_VELOCITY,
+	RGT_MG_CMD_VOLTAGE
+};
+
+// The last command sent to a single smart port
+typedef struct {
+	int8_t port;   // Signed port the command was sent with
+	uint8_t kind;  // One of the RGT_MG_CMD_* values
+	int32_t value; // The command's argument
+	uint32_t time; // Time (ms) the command was sent
+} Rgt_MG_Cached_Command;
+
+// One entry per smart port, indexed by port - 1, and shared by every group
+// that drives the port
+static Rgt_MG_Cached_Command command_cache[RGT_MG_SIZE];
+static bool command_cache_enabled = false;
+static uint32_t command_cache_refresh_interval = 0;
+static Rgt_MG_Command_Stats command_stats = {0, 0};
+
+static Rgt_MG_Cached_Command *rgt_mg_cache_entry(int8_t port) {
+	int index = abs(port) - 1;
+	if (index < 0 || index >= RGT_MG_SIZE)
+		return NULL;
+	return &command_cache[index];
+}
+
+/**
+ * Returns true if the command is identical to the last one sent to the port,
+ * and that command is younger than the refresh interval - i.e. the command can
+ * be skipped.
+ *
+ * command_cache and command_stats are plain globals with no locking, so a port
+ * must only be driven from one task at a time, whichever groups it is in. Two
+ * tasks moving the same port at once can each see a stale entry and skip a
+ * command the motor needed.
+ */
+static bool rgt_mg_command_is_redundant(int8_t port, uint8_t kind,
+                                        int32_t value, uint32_t now) {
+	if (!command_cache_enabled)
+		return false;
+
+	Rgt_MG_Cached_Command *c = rgt_mg_cache_entry(port);
+	if (c == NULL || c->kind != kind || c->port != port || c->value != value ||
+	    now - c->time >= command_cache_refresh_interval)
+		return false;
+
+	command_stats.suppressed++;
+	return true;
+}
+
+/**
+ * Records a command that was sent to a port. Failed commands clear the entry
+ * so the next command is always sent.
+ */
+static void rgt_mg_command_sent(int8_t port, uint8_t kind, int32_t value,
+                                uint32_t now, bool success) {
+	command_stats.issued++;
+
+	Rgt_MG_Cached_Command *c = rgt_mg_cache_entry(port);
+	if (c == NULL)
+		return;
+
+	if (success)
+		*c = (Rgt_MG_Cached_Command){port, kind, value, now};
+	else
+		c->kind = RGT_MG_CMD_NONE;
+}
+
+void rgt_mg_command_cache_enable(uint32_t refresh_interval) {
+	command_cache_refresh_interval = refresh_interval;
+	command_cache_enabled = true;
+}
+
+void rgt_mg_command_cache_disable(void) { command_cache_enabled = false; }
+
+void rgt_mg_command_cache_invalidate(const Rgt_Motor_Group *mg) {
+	for (uint8_t i = 0; i < mg->count; i++) {
+		Rgt_MG_Cached_Command *c = rgt_mg_cache_entry(rgt_mg_port(mg, i));
+		if (c != NULL)
+			c->kind = RGT_MG_CMD_NONE;
+	}
+}
+
+Rgt_MG_Command_Stats rgt_mg_get_command_stats(void) { return command_stats; }
+
+void rgt_mg_reset_command_stats(void) {
+	command_stats = (Rgt_MG_Command_Stats){0, 0};
+}
+
+/*******************************************************************************
+ *                             Battery Compensation                            *
+ ******************************************************************************/
+
+// Weight of each new reading in the battery voltage filter
+#define RGT_MG_BATTERY_FILTER_GAIN 0.2
+// Limit on the compensation scale, so a bad reading can't max out the motors
+#define RGT_MG_MAX_BATTERY_SCALE 1.5
+
+static bool battery_compensation = false;
+static int32_t battery_nominal = RGT_MG_NOMINAL_BATTERY_VOLTAGE;
+/**
+ * The filter state, shared by every task that sends commands. Both are only
+ * accessed with GCC's __atomic builtins, and only the task that claims an
+ * update by moving battery_last_update forward writes battery_filtered.
+ */
+static float battery_filtered = 0;
+static uint32_t battery_last_update = 0;
+
+void rgt_mg_set_battery_compensation(bool enabled) {
+	battery_compensation = enabled;
+}
+
+void rgt_mg_set_nominal_battery_voltage(int32_t nominal_voltage) {
+	battery_nominal = nominal_voltage;
+}
+
+double rgt_mg_get_battery_voltage(void) {
+	// Read the clock after the last update, so another task claiming one in
+	// between can't leave now behind it
+	uint32_t last = __atomic_load_n(&battery_last_update, __ATOMIC_ACQUIRE);
+	uint32_t now = millis();
+	float filtered;
+	__atomic_load(&battery_filtered, &filtered, __ATOMIC_ACQUIRE);
+
+	if ((filtered == 0 || now - last >= RGT_MG_BATTERY_UPDATE_INTERVAL) &&
+	    __atomic_compare_exchange_n(&battery_last_update, &last, now, false,
+	                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+		int32_t reading = battery_get_voltage();
+		if (reading != PROS_ERR && reading > 0) {
+			if (filtered == 0)
+				filtered = reading;
+			else
+				filtered +=
+				    RGT_MG_BATTERY_FILTER_GAIN * (reading - filtered);
+			__atomic_store(&battery_filtered, &filtered, __ATOMIC_RELEASE);
+		} else {
+			// Let the next call try again
+			__atomic_store_n(&battery_last_update, last, __ATOMIC_RELEASE);
+		}
+	}
+
+	return filtered == 0 ? PROS_ERR_F : filtered;
+}
+
+// Returns true if the group's outputs should be battery compensated
+static bool rgt_mg_compensates(const Rgt_Motor_Group *mg) {
+	return battery_compensation ||
+	       (mg->output != NULL && mg->output->compensate_battery);
+}
+
+/**
+ * Applies the group's battery compensation to a command, limiting the result
+ * to +-limit, the range of the command
+ */
+static int32_t rgt_mg_compensate(const Rgt_Motor_Group *mg, int32_t value,
+                                 int32_t limit) {
+	if (value == 0 || !rgt_mg_compensates(mg))
+		return value;
+
+	double battery = rgt_mg_get_battery_voltage();
+	if (battery == PROS_ERR_F)
+		return value;
+
+	double scale = battery_nominal / battery;
+	if (scale > RGT_MG_MAX_BATTERY_SCALE)
+		scale = RGT_MG_MAX_BATTERY_SCALE;
+
+	int32_t compensated = lround(value * scale);
+	if (compensated > limit)
+		return limit;
+	if (compensated < -limit)
+		return -limit;
+	return compensated;
+}
+
+/*******************************************************************************
+ *                            Slew and Jerk Limiting                           *
+ ******************************************************************************/
+
+/**
+ * Moves the group's output towards voltage (mV), limited by the output's
+ * max_slew and max_jerk, and returns the new output.
+ */
+static int32_t rgt_mg_slew(const Rgt_Motor_Group *mg, int32_t voltage) {
+	Rgt_MG_Output *o = mg->output;
+	if (o == NULL || o->max_slew <= 0)
+		return voltage;
+
+	o->stats.commands++;
+	double distance = voltage - o->slew_output;
+	double rate = distance;
+
+	if (o->max_jerk > 0) {
+		// Fastest rate that can still slow down to 0 by the target, dropping by
+		// max_jerk per command. Slowing down from n * max_jerk covers
+		// max_jerk * n * (n + 1) / 2
+		double left = fabs(distance);
+		double steps = floor((sqrt(1 + 8 * left / o->max_jerk) - 1) / 2);
+		double stopping_rate =
+		    (left + o->max_jerk * steps * (steps + 1) / 2) / (steps + 1);
+		if (fabs(rate) > stopping_rate)
+			rate = copysign(stopping_rate, distance);
+
+		double jerk_limited = rate;
+		if (jerk_limited > o->slew_rate + o->max_jerk)
+			jerk_limited = o->slew_rate + o->max_jerk;
+		else if (jerk_limited < o->slew_rate - o->max_jerk)
+			jerk_limited = o->slew_rate - o->max_jerk;
+		// Only count the clamp when the slew limit doesn't cut the rate back
+		// further anyway
+		if (jerk_limited != rate && fabs(jerk_limited) < o->max_slew)
+			o->stats.jerk_limited++;
+		rate = jerk_limited;
+	}
+
+	if (fabs(rate) > o->max_slew) {
+		rate = copysign(o->max_slew, rate);
+		o->stats.slew_limited++;
+	}
+
+	// Never step past the target, even if the jerk limit is still slowing down
+	if ((distance >= 0 && rate > distance) ||
+	    (distance <= 0 && rate < distance))
+		rate = distance;
+
+	o->slew_rate = rate;
+	o->slew_output += rate;
+	return lround(o->slew_output);
+}
+
+// Resets the slew limiter after a command it doesn't track
+static void rgt_mg_slew_reset(const Rgt_Motor_Group *mg) {
+	if (mg->output == NULL)
+		return;
+	mg->output->slew_output = 0;
+	mg->output->slew_rate = 0;
+}
+
+/*******************************************************************************
+ *                              Movement Functions                             *
+ ******************************************************************************/
+
+/**
+ * Sends a command to a single motor through the command cache. send is the
+ * PROS function for the command. Returns false if the command failed.
+ */
+static bool rgt_mg_send_one(int8_t port, uint8_t kind, int32_t value,
+                            uint32_t now, int32_t (*send)(int8_t, int32_t)) {
+	if (rgt_mg_command_is_redundant(port, kind, value, now))
+		return true;
+
+	bool success = send(port, value) == 1;
+	rgt_mg_command_sent(port, kind, value, now, success);
+	return success;
+}
+
+// Sends the same command to every motor in the group through the cache
+static int32_t rgt_mg_send_cached(const Rgt_Motor_Group *mg, uint8_t kind,
+                                  int32_t value,
+                                  int32_t (*send)(int8_t, int32_t)) {
+	int32_t ret = 1;
+	if (!command_cache_enabled) {
+		// Without the cache there is nothing to look up, and no need for the
+		// time
+		command_stats.issued += mg->count;
+		for (uint8_t i = 0; i < mg->count; i++) {
+			if (send(rgt_mg_port(mg, i), value) != 1)
+				ret = PROS_ERR;
+		}
+		return ret;
+	}
+
+	uint32_t now = millis();
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (!rgt_mg_send_one(rgt_mg_port(mg, i), kind, value, now, send))
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+/**
+ * Updates the current balancing trims of a group from the motors' current
+ * draws. The trims are integrated, so a motor that keeps drawing more current
+ * keeps losing voltage until it is back within the band or hits the max trim.
+ */
+static void rgt_mg_update_balance(const Rgt_Motor_Group *mg, Rgt_MG_Output *o) {
+	double currents[RGT_MG_SIZE];
+	rgt_mg_get_current_draws(mg, currents);
+
+	double mean = rgt_mg_aggregate(currents, mg->count, RGT_MG_AGGREGATE_MEAN,
+	                               0, NULL);
+	if (mean == PROS_ERR_F)
+		return;
+
+	double trim_sum = 0;
+	uint8_t valid = 0;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (currents[i] == PROS_ERR_F)
+			continue;
+
+		double error = currents[i] - mean;
+		if (error > o->balance_band)
+			o->balance_trims[i] -= o->balance_gain * (error - o->balance_band);
+		else if (error < -o->balance_band)
+			o->balance_trims[i] -= o->balance_gain * (error + o->balance_band);
+		trim_sum += o->balance_trims[i];
+		valid++;
+	}
+
+	// Keep the trims of the motors that were read centered on 0, so the
+	// group's total effort is unchanged. A motor that couldn't be read keeps
+	// its trim until it can be
+	double trim_mean = trim_sum / valid;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (currents[i] == PROS_ERR_F)
+			continue;
+		double trim = o->balance_trims[i] - trim_mean;
+		if (trim > o->balance_max_trim)
+			trim = o->balance_max_trim;
+		else if (trim < -o->balance_max_trim)
+			trim = -o->balance_max_trim;
+		o->balance_trims[i] = trim;
+	}
+}
+
+// motor_brake doesn't take a value, so it needs an adapter for the cache
+static int32_t rgt_mg_send_brake(int8_t port, int32_t value) {
+	(void)value;
+	return motor_brake(port);
+}
+
+int32_t rgt_mg_brake(const Rgt_Motor_Group *mg) {
+	rgt_mg_slew_reset(mg);
+	return rgt_mg_send_cached(mg, RGT_MG_CMD_BRAKE, 0, rgt_mg_send_brake);
+}
+
+int32_t rgt_mg_move(const Rgt_Motor_Group *mg, const int8_t voltage) {
+	int32_t value = rgt_mg_compensate(mg, voltage, 127);
+	if (mg->output != NULL && mg->output->max_slew > 0)
+		// The slew limits are in mV, so the command has to be converted
+		value = lround(rgt_mg_slew(mg, value * 12000 / 127) * 127 / 12000.0);
+
+	return rgt_mg_send_cached(mg, RGT_MG_CMD_MOVE, value, motor_move);
+}
+
+int32_t rgt_mg_move_absolute(const Rgt_Motor_Group *mg, const double position,
+                             const int32_t velocity) {
+	// Profiled movements replace whatever command the motor was following
+	rgt_mg_command_cache_invalidate(mg);
+	rgt_mg_slew_reset(mg);
+
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_move_absolute(rgt_mg_port(mg, i), position, velocity) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+int32_t rgt_mg_move_relative(const Rgt_Motor_Group *mg, const double position,
+                             const int32_t velocity) {
+	rgt_mg_command_cache_invalidate(mg);
+	rgt_mg_slew_reset(mg);
+
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_move_relative(rgt_mg_port(mg, i), position, velocity) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+int32_t rgt_mg_move_velocity(const Rgt_Motor_Group *mg,
+                             const int32_t velocity) {
+	rgt_mg_slew_reset(mg);
+	return rgt_mg_send_cached(mg, RGT_MG_CMD_VELOCITY, velocity,
+	                          motor_move_velocity);
+}
+
+/**
+ * rgt_mg_move_voltage with compensation, output shaping, or the cache. It is
+ * kept out of line so the plain path doesn't pay for its stack frame.
+ */
+__attribute__((noinline)) static int32_t
+rgt_mg_move_voltage_shaped(const Rgt_Motor_Group *mg, const int16_t command) {
+	int32_t voltage = rgt_mg_slew(mg, rgt_mg_compensate(mg, command, 12000));
+
+	Rgt_MG_Output *o = mg->output;
+	if (o == NULL || !o->balance_current)
+		return rgt_mg_send_cached(mg, RGT_MG_CMD_VOLTAGE, voltage,
+		                          motor_move_voltage);
+
+	// Below the max trim, trimming could reverse a motor, and a stopped group
+	// has no current to balance
+	bool trim = abs(voltage) > o->balance_max_trim;
+	if (trim)
+		rgt_mg_update_balance(mg, o);
+
+	int32_t ret = 1;
+	uint32_t now = millis();
+	for (uint8_t i = 0; i < mg->count; i++) {
+		int32_t v = voltage;
+		// Trims act on the voltage's magnitude, whichever way the group runs
+		if (trim)
+			v += (voltage > 0 ? 1 : -1) * lround(o->balance_trims[i]);
+		if (v > 12000)
+			v = 12000;
+		else if (v < -12000)
+			v = -12000;
+
+		if (!rgt_mg_send_one(rgt_mg_port(mg, i), RGT_MG_CMD_VOLTAGE, v, now,
+		                     motor_move_voltage))
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+int32_t rgt_mg_move_voltage(const Rgt_Motor_Group *mg,
+                            const int16_t command) {
+	if (mg->output != NULL || battery_compensation || command_cache_enabled)
+		return rgt_mg_move_voltage_shaped(mg, command);
+
+	// With no output shaping, compensation or cache, go straight to the
+	// motors - this is every opcontrol loop's hot path
+	// motor_move_voltage could change *mg as far as the compiler knows, so the
+	// group is read into locals instead of on every motor
+	int32_t ret = 1;
+	uint8_t count = mg->count;
+	uint32_t reversed = mg->reversed;
+	command_stats.issued += count;
+	for (uint8_t i = 0; i < count; i++, reversed >>= 1) {
+		int8_t port = (int8_t)mg->ports[i];
+		if (motor_move_voltage(reversed & 1 ? -port : port, command) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+int32_t rgt_mg_modify_profiled_velocity(const Rgt_Motor_Group *mg,
+                                        const int32_t velocity) {
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_modify_profiled_velocity(rgt_mg_port(mg, i), velocity) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+/*******************************************************************************
+ *                             Telemetry Functions                             *
+ ******************************************************************************/
+
+double rgt_mg_get_average_current_draw(const Rgt_Motor_Group *mg) {
+	double sum = 0;
+	for (uint8_t i = 0; i < mg->count; i++)
+		sum += motor_get_current_draw(rgt_mg_port(mg, i));
+	return sum / mg->count;
+}
+
+void rgt_mg_get_current_draws(const Rgt_Motor_Group *mg,
+                              double *current_draws) {
+	for (uint8_t i = 0; i < mg->count; i++) {
+		// The reading is an int32_t, so a failed one is PROS_ERR, not
+		// PROS_ERR_F like the other double readings
+		int32_t current = motor_get_current_draw(rgt_mg_port(mg, i));
+		current_draws[i] = current == PROS_ERR ? PROS_ERR_F : current;
+	}
+}
+
+double rgt_mg_get_average_position(const Rgt_Motor_Group *mg) {
+	double sum = 0;
+	for (uint8_t i = 0; i < mg->count; i++)
+		sum += motor_get_position(rgt_mg_port(mg, i));
+	return sum / mg->count;
+}
+
+void rgt_mg_get_positions(const Rgt_Motor_Group *mg, double *positions) {
+	for (uint8_t i = 0; i < mg->count; i++)
+		positions[i] = motor_get_position(rgt_mg_port(mg, i));
+}
+
+/**
+ * Encoder units per output shaft revolution for each port, or 0 if it hasn't
+ * been read yet. The encoder units and gearing only change through
+ * rgt_mg_set_encoder_units and rgt_mg_set_gearing, so they are read from the
+ * motor once instead of on every sample. A uint16_t is read and written in one
+ * access, so tasks sharing a port can't see a torn value.
+ */
+static uint16_t units_per_rev[RGT_MG_SIZE];
+
+// Clears the cached encoder units for the group, so they are read again
+static void rgt_mg_units_invalidate(const Rgt_Motor_Group *mg) {
+	for (uint8_t i = 0; i < mg->count; i++) {
+		uint8_t port = mg->ports[i];
+		if (port >= 1 && port <= RGT_MG_SIZE)
+			units_per_rev[port - 1] = 0;
+	}
+}
+
+// Reads the encoder units per output shaft revolution from the motor, or
+// returns 0 if the motor couldn't be read
+static uint16_t rgt_mg_read_units_per_rev(int8_t port) {
+	switch (motor_get_encoder_units(port)) {
+	case E_MOTOR_ENCODER_DEGREES:
+		return 360;
+	case E_MOTOR_ENCODER_ROTATIONS:
+		return 1;
+	case E_MOTOR_ENCODER_COUNTS:
+		// Encoder counts per output shaft revolution depend on the cartridge
+		switch (motor_get_gearing(port)) {
+		case E_MOTOR_GEARSET_36:
+			return 1800;
+		case E_MOTOR_GEARSET_18:
+			return 900;
+		case E_MOTOR_GEARSET_06:
+			return 300;
+		default:
+			return 0;
+		}
+	default:
+		return 0;
+	}
+}
+
+// Converts a velocity in RPM to the motor's encoder units per millisecond
+static double rgt_mg_rpm_to_units_per_ms(int8_t port, double rpm) {
+	int index = abs(port) - 1;
+	if (index < 0 || index >= RGT_MG_SIZE)
+		return rpm * 360 / 60000.0;
+
+	uint16_t units = units_per_rev[index];
+	if (units == 0) {
+		// A failed read isn't cached, so the motor is asked again next time.
+		// Until then, assume degrees, PROS's default
+		units = rgt_mg_read_units_per_rev(port);
+		units_per_rev[index] = units;
+		if (units == 0)
+			units = 360;
+	}
+	return rpm * units / 60000.0;
+}
+
+uint32_t rgt_mg_get_aligned_positions(const Rgt_Motor_Group *mg,
+                                      double *positions) {
+	double velocities[RGT_MG_SIZE];
+	uint32_t timestamps[RGT_MG_SIZE];
+	uint32_t latest = 0;
+
+	// Read the timestamp first - if a new sample arrives partway through, the
+	// position is newer than its timestamp rather than older
+	for (uint8_t i = 0; i < mg->count; i++) {
+		int8_t port = rgt_mg_port(mg, i);
+		if (motor_get_raw_position(port, &timestamps[i]) == PROS_ERR) {
+			// Without its timestamp, the motor's position can't be aligned
+			positions[i] = PROS_ERR_F;
+			continue;
+		}
+		positions[i] = motor_get_position(port);
+		velocities[i] = motor_get_actual_velocity(port);
+		if (timestamps[i] > latest)
+			latest = timestamps[i];
+	}
+
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (positions[i] == PROS_ERR_F)
+			continue;
+		if (velocities[i] == PROS_ERR_F) {
+			positions[i] = PROS_ERR_F;
+			continue;
+		}
+
+		uint32_t dt = latest - timestamps[i];
+		if (dt > RGT_MG_MAX_EXTRAPOLATION)
+			dt = RGT_MG_MAX_EXTRAPOLATION;
+
+		positions[i] +=
+		    rgt_mg_rpm_to_units_per_ms(rgt_mg_port(mg, i), velocities[i]) * dt;
+	}
+
+	return latest;
+}
+
+double rgt_mg_get_aligned_average_position(const Rgt_Motor_Group *mg) {
+	double positions[RGT_MG_SIZE];
+	rgt_mg_get_aligned_positions(mg, positions);
+	return rgt_mg_aggregate(positions, mg->count, RGT_MG_AGGREGATE_MEAN, 0,
+	                        NULL);
+}
+
+/**
+ * Sorts the indices in order by the values they refer to. Groups have at most
+ * 21 motors, so an insertion sort is plenty.
+ */
+static void rgt_mg_sort_indices(const double *values, uint8_t *order,
+                                uint8_t n) {
+	for (uint8_t i = 1; i < n; i++) {
+		uint8_t index = order[i];
+		uint8_t j = i;
+		for (; j > 0 && values[order[j - 1]] > values[index]; j--)
+			order[j] = order[j - 1];
+		order[j] = index;
+	}
+}
+
+double rgt_mg_aggregate(const double *values, uint8_t count,
+                        Rgt_MG_Aggregation policy, double threshold,
+                        uint32_t *valid) {
+	// Indices of the usable readings
+	uint8_t order[RGT_MG_SIZE];
+	uint8_t n = 0;
+	uint32_t mask = 0;
+
+	if (count > RGT_MG_SIZE)
+		count = RGT_MG_SIZE;
+
+	// Error readings are never used
+	for (uint8_t i = 0; i < count; i++) {
+		if (values[i] == PROS_ERR_F || isnan(values[i]))
+			continue;
+		order[n++] = i;
+		mask |= (uint32_t)1 << i;
+	}
+
+	if (n == 0) {
+		if (valid != NULL)
+			*valid = 0;
+		return PROS_ERR_F;
+	}
+
+	double median = 0;
+	if (policy != RGT_MG_AGGREGATE_MEAN) {
+		rgt_mg_sort_indices(values, order, n);
+		median = n % 2 ? values[order[n / 2]]
+		               : (values[order[n / 2 - 1]] + values[order[n / 2]]) / 2;
+	}
+
+	// The range of order that goes into the mean
+	uint8_t first = 0, last = n;
+
+	switch (policy) {
+	case RGT_MG_AGGREGATE_MEDIAN:
+		if (valid != NULL)
+			*valid = mask;
+		return median;
+	case RGT_MG_AGGREGATE_TRIMMED_MEAN:
+		if (n >= 3) {
+			mask &= ~((uint32_t)1 << order[0]);
+			mask &= ~((uint32_t)1 << order[n - 1]);
+			first = 1;
+			last = n - 1;
+		}
+		break;
+	case RGT_MG_AGGREGATE_EXCLUDE_OUTLIERS:
+		for (uint8_t i = 0; i < n; i++) {
+			if (fabs(values[order[i]] - median) > threshold)
+				mask &= ~((uint32_t)1 << order[i]);
+		}
+		// With an even number of readings that disagree, every reading can be
+		// rejected - fall back to the middle readings, i.e. the median
+		if (mask == 0) {
+			mask |= (uint32_t)1 << order[(n - 1) / 2];
+			mask |= (uint32_t)1 << order[n / 2];
+		}
+		break;
+	default:
+		break;
+	}
+
+	double sum = 0;
+	uint8_t used = 0;
+	for (uint8_t i = first; i < last; i++) {
+		if (mask & ((uint32_t)1 << order[i])) {
+			sum += values[order[i]];
+			used++;
+		}
+	}
+
+	if (valid != NULL)
+		*valid = mask;
+	return sum / used;
+}
+
+double rgt_mg_get_aggregate_position(const Rgt_Motor_Group *mg,
+                                     Rgt_MG_Aggregation policy,
+                                     double threshold, uint32_t *valid) {
+	double positions[RGT_MG_SIZE];
+	rgt_mg_get_aligned_positions(mg, positions);
+	return rgt_mg_aggregate(positions, mg->count, policy, threshold, valid);
+}
+
+double rgt_mg_get_average_velocity(const Rgt_Motor_Group *mg) {
+	double sum = 0;
+	for (uint8_t i = 0; i < mg->count; i++)
+		sum += motor_get_actual_velocity(rgt_mg_port(mg, i));
+	return sum / mg->count;
+}
+
+void rgt_mg_get_velocities(const Rgt_Motor_Group *mg, double *velocities) {
+	for (uint8_t i = 0; i < mg->count; i++)
+		velocities[i] = motor_get_actual_velocity(rgt_mg_port(mg, i));
+}
+
+double rgt_mg_get_aggregate_velocity(const Rgt_Motor_Group *mg,
+                                     Rgt_MG_Aggregation policy,
+                                     double threshold, uint32_t *valid) {
+	double velocities[RGT_MG_SIZE];
+	rgt_mg_get_velocities(mg, velocities);
+	return rgt_mg_aggregate(velocities, mg->count, policy, threshold, valid);
+}
+
+// Divides a sum by the number of readings in it, or PROS_ERR_F without any
+static double rgt_mg_average(double sum, uint8_t n) {
+	return n == 0 ? PROS_ERR_F : sum / n;
+}
+
+int32_t rgt_mg_snapshot(const Rgt_Motor_Group *mg,
+                        Rgt_Motor_Group_Snapshot *snapshot) {
+	int32_t ret = 1;
+	double position_sum = 0, velocity_sum = 0;
+	double current_sum = 0, voltage_sum = 0;
+	uint8_t positions = 0, velocities = 0, currents = 0, voltages = 0;
+	double max_temperature = PROS_ERR_F;
+
+	snapshot->timestamp = millis();
+
+	for (uint8_t i = 0; i < mg->count; i++) {
+		int8_t port = rgt_mg_port(mg, i);
+		Rgt_Motor_Sample *s = &snapshot->motors[i];
+
+		s->position = motor_get_position(port);
+		s->velocity = motor_get_actual_velocity(port);
+		s->current_draw = motor_get_current_draw(port);
+		s->voltage = motor_get_voltage(port);
+		s->temperature = motor_get_temperature(port);
+		s->raw_position = motor_get_raw_position(port, &s->timestamp);
+
+		if (s->position == PROS_ERR_F || s->velocity == PROS_ERR_F ||
+		    s->current_draw == PROS_ERR || s->voltage == PROS_ERR ||
+		    s->temperature == PROS_ERR_F || s->raw_position == PROS_ERR)
+			ret = PROS_ERR;
+
+		// Failed reads are left out of the aggregates, like
+		// rgt_mg_aggregate does
+		if (s->position != PROS_ERR_F) {
+			position_sum += s->position;
+			positions++;
+		}
+		if (s->velocity != PROS_ERR_F) {
+			velocity_sum += s->velocity;
+			velocities++;
+		}
+		if (s->current_draw != PROS_ERR) {
+			current_sum += s->current_draw;
+			currents++;
+		}
+		if (s->voltage != PROS_ERR) {
+			voltage_sum += s->voltage;
+			voltages++;
+		}
+		if (s->temperature != PROS_ERR_F &&
+		    (max_temperature == PROS_ERR_F || s->temperature > max_temperature))
+			max_temperature = s->temperature;
+	}
+
+	snapshot->count = mg->count;
+	snapshot->average_position = rgt_mg_average(position_sum, positions);
+	snapshot->average_velocity = rgt_mg_average(velocity_sum, velocities);
+	snapshot->average_current_draw = rgt_mg_average(current_sum, currents);
+	snapshot->average_voltage = rgt_mg_average(voltage_sum, voltages);
+	snapshot->max_temperature = max_temperature;
+
+	return ret;
+}
+
+/*******************************************************************************
+ *                           Configuration Functions                           *
+ ******************************************************************************/
+
+int32_t rgt_mg_set_brake_mode(const Rgt_Motor_Group *mg,
+                              const motor_brake_mode_e_t brake_mode) {
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_set_brake_mode(rgt_mg_port(mg, i), brake_mode) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
+
+int32_t rgt_mg_set_encoder_units(const Rgt_Motor_Group *mg,
+                                 const motor_encoder_units_e_t encoder_units) {
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_set_encoder_units(rgt_mg_port(mg, i), encoder_units) != 1)
+			ret = PROS_ERR;
+	}
+	rgt_mg_units_invalidate(mg);
+	return ret;
+}
+
+int32_t rgt_mg_set_gearing(const Rgt_Motor_Group *mg,
+                           const motor_gearset_e_t gearing) {
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_set_gearing(rgt_mg_port(mg, i), gearing) != 1)
+			ret = PROS_ERR;
+	}
+	rgt_mg_units_invalidate(mg);
+	return ret;
+}
+
+int32_t rgt_mg_reset_positions(const Rgt_Motor_Group *mg) {
+	int32_t ret = 1;
+	for (uint8_t i = 0; i < mg->count; i++) {
+		if (motor_tare_position(rgt_mg_port(mg, i)) != 1)
+			ret = PROS_ERR;
+	}
+	return ret;
+}
@@ -0,0 +1,37 @@
+#include "ringtail/pneumatics.h"
+
+#include "pros/adi.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file pneumatics.c
+ *
+ * @brief Function implementations for controlling pneumatic pistons
+ */
+
+// Writes the piston's state variable out to its ADI port
+static void rgt_pneumatic_update_state(Rgt_Pneumatic_Piston *p) {
+	adi_digital_write(p->port, p->extended);
+}
+
+Rgt_Pneumatic_Piston rgt_pneumatic_init(uint8_t port) {
+	adi_port_set_config(port, E_ADI_DIGITAL_OUT);
+	return (Rgt_Pneumatic_Piston){.port = port, .extended = false};
+}
+
+void rgt_pneumatic_extend(Rgt_Pneumatic_Piston *p) {
+	p->extended = true;
+	rgt_pneumatic_update_state(p);
+}
+
+void rgt_pneumatic_retract(Rgt_Pneumatic_Piston *p) {
+	p->extended = false;
+	rgt_pneumatic_update_state(p);
+}
+
+void rgt_pneumatic_toggle(Rgt_Pneumatic_Piston *p) {
+	p->extended = !p->extended;
+	rgt_pneumatic_update_state(p);
+}
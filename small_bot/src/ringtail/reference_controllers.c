@@ -0,0 +1,573 @@
+#include "ringtail/reference_controllers.h"
+
+#include "ringtail/motor_group.h"
+
+#include "pros/error.h"
+#include "pros/rtos.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/**
+ * @file reference_controllers.c
+ *
+ * @brief Implementations of Ringtail's reference controller math
+ */
+
+double bangbang(double target, double current, int16_t on_voltage,
+                int16_t off_voltage) {
+	return target > current ? on_voltage : off_voltage;
+}
+
+double pid(double error, double kP, double kI, double kD, double *integral,
+           double prev_error, bool clear_integral) {
+	if (clear_integral)
+		*integral = 0;
+	else
+		*integral += error;
+
+	return kP * error + kI * *integral + kD * (error - prev_error);
+}
+
+void tbh(double error, double prev_error, double *output, double *tbh,
+         double kH) {
+	*output += error * kH;
+
+	// The error has crossed the target - take back half
+	if (signbit(error) != signbit(prev_error)) {
+		*output = (*output + *tbh) / 2;
+		*tbh = *output;
+	}
+}
+
+float bangbangf(float target, float current, int16_t on_voltage,
+                int16_t off_voltage) {
+	return target > current ? on_voltage : off_voltage;
+}
+
+float pidf(float error, float kP, float kI, float kD, float *integral,
+           float prev_error, bool clear_integral) {
+	if (clear_integral)
+		*integral = 0;
+	else
+		*integral += error;
+
+	return kP * error + kI * *integral + kD * (error - prev_error);
+}
+
+void tbhf(float error, float prev_error, float *output, float *tbh, float kH) {
+	*output += error * kH;
+
+	if (signbit(error) != signbit(prev_error)) {
+		*output = (*output + *tbh) / 2;
+		*tbh = *output;
+	}
+}
+
+// Clamps a 64-bit intermediate to the Q16.16 range
+static rgt_q16_t rgt_q16_saturate(int64_t x) {
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return (rgt_q16_t)x;
+}
+
+static rgt_q16_t rgt_q16_add(rgt_q16_t a, rgt_q16_t b) {
+	return rgt_q16_saturate((int64_t)a + b);
+}
+
+// Multiplies, rounding the product to nearest (GCC shifts signed values
+// arithmetically, so this rounds halves up)
+static rgt_q16_t rgt_q16_mul(rgt_q16_t a, rgt_q16_t b) {
+	return rgt_q16_saturate(((int64_t)a * b + 0x8000) >> 16);
+}
+
+rgt_q16_t bangbang_q16(rgt_q16_t target, rgt_q16_t current,
+                       int16_t on_voltage, int16_t off_voltage) {
+	return (target > current ? on_voltage : off_voltage) * 65536;
+}
+
+rgt_q16_t pid_q16(rgt_q16_t error, rgt_q16_t kP, rgt_q16_t kI, rgt_q16_t kD,
+                  rgt_q16_t *integral, rgt_q16_t prev_error,
+                  bool clear_integral) {
+	if (clear_integral)
+		*integral = 0;
+	else
+		*integral = rgt_q16_add(*integral, error);
+
+	rgt_q16_t derivative = rgt_q16_saturate((int64_t)error - prev_error);
+	rgt_q16_t output = rgt_q16_mul(kP, error);
+	output = rgt_q16_add(output, rgt_q16_mul(kI, *integral));
+	return rgt_q16_add(output, rgt_q16_mul(kD, derivative));
+}
+
+void tbh_q16(rgt_q16_t error, rgt_q16_t prev_error, rgt_q16_t *output,
+             rgt_q16_t *tbh, rgt_q16_t kH) {
+	*output = rgt_q16_add(*output, rgt_q16_mul(error, kH));
+
+	if ((error < 0) != (prev_error < 0)) {
+		// Halving the sum in 64 bits can't overflow
+		*output = (rgt_q16_t)(((int64_t)*output + *tbh) / 2);
+		*tbh = *output;
+	}
+}
+
+Rgt_PID rgt_pid_init(double kP, double kI, double kD) {
+	return (Rgt_PID){
+	    .kP = kP,
+	    .kI = kI,
+	    .kD = kD,
+	    .output_limit = RGT_PID_MAX_OUTPUT,
+	    .integral_zone = 0,
+	    .integral_limit = 0,
+	    .windup_gain = 1,
+	    .reset_on_sign_change = false,
+	    .derivative_on_measurement = false,
+	    .derivative_filter = 0,
+	    .nominal_period = 0,
+	    .integral = 0,
+	    .prev_error = 0,
+	    .derivative = 0,
+	    .prev_measurement = 0,
+	    .has_prev_measurement = false,
+	    .last_time = 0,
+	};
+}
+
+void rgt_pid_reset(Rgt_PID *p) {
+	p->integral = 0;
+	p->prev_error = 0;
+	p->derivative = 0;
+	p->has_prev_measurement = false;
+	p->last_time = 0;
+}
+
+/**
+ * Updates a PID instance. has_measurement says whether current is valid, so
+ * the derivative can be of the measurement.
+ */
+static double rgt_pid_update(Rgt_PID *p, double error, double current,
+                             bool has_measurement, bool clear_integral) {
+	// The time since the last update, in the periods the gains are tuned for
+	double periods = 1;
+	if (p->nominal_period > 0) {
+		uint64_t now = micros();
+		if (p->last_time != 0)
+			periods = (now - p->last_time) / (p->nominal_period * 1000);
+		p->last_time = now;
+	}
+
+	if (p->integral_zone > 0 && fabs(error) > p->integral_zone)
+		clear_integral = true;
+	// The target was crossed - the integral that got it there would overshoot
+	if (p->reset_on_sign_change && p->prev_error != 0 &&
+	    signbit(error) != signbit(p->prev_error))
+		clear_integral = true;
+	if (clear_integral)
+		p->integral = 0;
+	else
+		p->integral += error * periods;
+
+	// With a constant target, the error changes by minus the change in the
+	// measurement - but a new target doesn't kick it
+	double change = error - p->prev_error;
+	if (p->derivative_on_measurement && has_measurement) {
+		change = p->has_prev_measurement ? p->prev_measurement - current : 0;
+		p->prev_measurement = current;
+		p->has_prev_measurement = true;
+	}
+	p->prev_error = error;
+
+	double derivative = periods > 0 ? change / periods : 0;
+	if (p->derivative_filter > 0) {
+		double alpha = p->derivative_filter / (p->derivative_filter + periods);
+		derivative = alpha * p->derivative + (1 - alpha) * derivative;
+	}
+	p->derivative = derivative;
+
+	if (p->integral_limit > 0 && p->kI != 0 &&
+	    fabs(p->kI * p->integral) > p->integral_limit)
+		p->integral = copysign(p->integral_limit / fabs(p->kI), p->integral);
+
+	double output = p->kP * error + p->kI * p->integral + p->kD * derivative;
+
+	if (p->output_limit > 0 && fabs(output) > p->output_limit) {
+		double limited = copysign(p->output_limit, output);
+		// Unwind the integral by the output that couldn't be applied, so it
+		// doesn't keep growing while saturated and overshoot later. It is
+		// only ever shrunk - unwinding past 0 would turn it against the error
+		if (p->windup_gain > 0 && p->kI != 0) {
+			double unwound =
+			    p->integral + p->windup_gain * (limited - output) / p->kI;
+			if (unwound * p->integral <= 0)
+				p->integral = 0;
+			else if (fabs(unwound) < fabs(p->integral))
+				p->integral = unwound;
+		}
+		output = limited;
+	}
+	return output;
+}
+
+double rgt_pid_calculate(Rgt_PID *p, double error, bool clear_integral) {
+	return rgt_pid_update(p, error, 0, false, clear_integral);
+}
+
+double rgt_pid_calculate_measured(Rgt_PID *p, double target, double current,
+                                  bool clear_integral) {
+	return rgt_pid_update(p, target - current, current, true, clear_integral);
+}
+
+void rgt_pid_calculate_all(Rgt_PID *pids, const double *errors,
+                           double *outputs, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		outputs[i] = rgt_pid_calculate(&pids[i], errors[i], false);
+}
+
+int rgt_pid_batch_add(Rgt_PID_Batch *b, float kP, float kI, float kD) {
+	if (b->count >= RGT_PID_BATCH_MAX)
+		return -1;
+
+	uint8_t i = b->count++;
+	b->kP[i] = kP;
+	b->kI[i] = kI;
+	b->kD[i] = kD;
+	b->output_limit[i] = RGT_PID_MAX_OUTPUT;
+	rgt_pid_batch_reset(b, i);
+	return i;
+}
+
+void rgt_pid_batch_reset(Rgt_PID_Batch *b, uint8_t index) {
+	b->integral[index] = 0;
+	b->prev_error[index] = 0;
+}
+
+// Updates the controllers in a batch from first on, one at a time
+static void rgt_pid_batch_scalar(Rgt_PID_Batch *b, const float *errors,
+                                 float *outputs, uint8_t first) {
+	for (uint8_t i = first; i < b->count; i++) {
+		float error = errors[i];
+		b->integral[i] += error;
+		float output = b->kP[i] * error + b->kI[i] * b->integral[i] +
+		               b->kD[i] * (error - b->prev_error[i]);
+		b->prev_error[i] = error;
+
+		if (output > b->output_limit[i])
+			output = b->output_limit[i];
+		else if (output < -b->output_limit[i])
+			output = -b->output_limit[i];
+		outputs[i] = output;
+	}
+}
+
+void rgt_pid_batch_calculate(Rgt_PID_Batch *b, const float *errors,
+                             float *outputs) {
+	uint8_t i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	for (; i + 4 <= b->count; i += 4) {
+		float32x4_t error = vld1q_f32(&errors[i]);
+		float32x4_t integral = vaddq_f32(vld1q_f32(&b->integral[i]), error);
+		float32x4_t derivative = vsubq_f32(error, vld1q_f32(&b->prev_error[i]));
+
+		float32x4_t output = vmulq_f32(vld1q_f32(&b->kP[i]), error);
+		output = vmlaq_f32(output, vld1q_f32(&b->kI[i]), integral);
+		output = vmlaq_f32(output, vld1q_f32(&b->kD[i]), derivative);
+
+		float32x4_t limit = vld1q_f32(&b->output_limit[i]);
+		output = vmaxq_f32(vminq_f32(output, limit), vnegq_f32(limit));
+
+		vst1q_f32(&b->integral[i], integral);
+		vst1q_f32(&b->prev_error[i], error);
+		vst1q_f32(&outputs[i], output);
+	}
+#endif
+	// Everything without NEON, and the last few controllers with it
+	rgt_pid_batch_scalar(b, errors, outputs, i);
+}
+
+void rgt_pid_batch_calculate_scalar(Rgt_PID_Batch *b, const float *errors,
+                                    float *outputs) {
+	rgt_pid_batch_scalar(b, errors, outputs, 0);
+}
+
+double rgt_pid_controller(void *pid, double target, double current,
+                          bool reset) {
+	Rgt_PID *p = (Rgt_PID *)pid;
+	if (reset)
+		rgt_pid_reset(p);
+	return rgt_pid_calculate_measured(p, target, current, reset);
+}
+
+Rgt_TBH rgt_tbh_init(const Rgt_Motor_Group *mg, double kH, double guess_gain) {
+	// 5% of the target velocity that needs the full output
+	double threshold =
+	    guess_gain != 0 ? 0.05 * RGT_PID_MAX_OUTPUT / fabs(guess_gain) : 10;
+	return (Rgt_TBH){
+	    .mg = mg,
+	    .kH = kH,
+	    .guess_gain = guess_gain,
+	    .output_limit = RGT_PID_MAX_OUTPUT,
+	    .velocity_filter = 0,
+	    .at_speed_threshold = threshold,
+	    .at_speed_hysteresis = threshold / 2,
+	    .output = 0,
+	    .tbh = 0,
+	    .prev_error = 0,
+	    .prev_target = 0,
+	    .velocity = 0,
+	    .started = false,
+	    .crossed = false,
+	    .at_speed = false,
+	};
+}
+
+void rgt_tbh_reset(Rgt_TBH *t) {
+	t->output = 0;
+	t->tbh = 0;
+	t->prev_error = 0;
+	t->velocity = 0;
+	t->started = false;
+	t->crossed = false;
+	__atomic_store_n(&t->at_speed, false, __ATOMIC_RELEASE);
+}
+
+double rgt_tbh_calculate(Rgt_TBH *t, double target, double current) {
+	if (t->started && t->velocity_filter > 0) {
+		double alpha = t->velocity_filter / (t->velocity_filter + 1);
+		t->velocity = alpha * t->velocity + (1 - alpha) * current;
+	} else {
+		t->velocity = current;
+	}
+	double error = target - t->velocity;
+
+	// Nothing has crossed a new target yet, and the last error was for the old
+	// one
+	if (!t->started || target != t->prev_target) {
+		t->started = true;
+		t->crossed = false;
+		t->prev_target = target;
+		t->prev_error = error;
+	}
+
+	// Only the controller writes at_speed, so reading it plainly is fine
+	double band = t->at_speed_threshold;
+	if (t->at_speed)
+		band += t->at_speed_hysteresis;
+	__atomic_store_n(&t->at_speed, fabs(error) <= band, __ATOMIC_RELEASE);
+
+	if (target == 0) {
+		t->output = 0;
+		t->tbh = 0;
+		t->prev_error = error;
+		return 0;
+	}
+
+	bool crossing = signbit(error) != signbit(t->prev_error);
+	if (crossing && !t->crossed && t->guess_gain != 0) {
+		t->output = target * t->guess_gain;
+		t->tbh = t->output;
+	} else {
+		tbh(error, t->prev_error, &t->output, &t->tbh, t->kH);
+	}
+	t->crossed |= crossing;
+	t->prev_error = error;
+
+	// Clamping tbh too keeps a saturated spin-up from leaving an unreachable
+	// guess behind
+	if (t->output_limit > 0 && fabs(t->output) > t->output_limit)
+		t->output = copysign(t->output_limit, t->output);
+	if (t->output_limit > 0 && fabs(t->tbh) > t->output_limit)
+		t->tbh = copysign(t->output_limit, t->tbh);
+	return t->output;
+}
+
+bool rgt_tbh_at_speed(Rgt_TBH *t) {
+	return __atomic_load_n(&t->at_speed, __ATOMIC_ACQUIRE);
+}
+
+double rgt_tbh_get_sensor_data(void *tbh) {
+	return rgt_mg_get_average_velocity(((Rgt_TBH *)tbh)->mg);
+}
+
+double rgt_tbh_controller(void *tbh, double target, double current,
+                          bool reset) {
+	Rgt_TBH *t = (Rgt_TBH *)tbh;
+	if (reset)
+		rgt_tbh_reset(t);
+	return rgt_tbh_calculate(t, target, current);
+}
+
+Rgt_Bangbang rgt_bangbang_init(Rgt_Bangbang_Mode mode, double on_voltage,
+                               double off_voltage, double band) {
+	return (Rgt_Bangbang){
+	    .mode = mode,
+	    .on_voltage = on_voltage,
+	    .off_voltage = off_voltage,
+	    .band = band,
+	    .hold_voltage = 0,
+	    .brake_voltage = on_voltage,
+	    .deceleration = 0,
+	    .velocity_filter = 0,
+	    .on = false,
+	    .velocity = 0,
+	    .prev_current = 0,
+	    .has_prev_current = false,
+	    .last_time = 0,
+	};
+}
+
+void rgt_bangbang_reset(Rgt_Bangbang *b) {
+	b->on = false;
+	b->velocity = 0;
+	b->has_prev_current = false;
+	b->last_time = 0;
+}
+
+// The minimum time mode of rgt_bangbang_calculate
+static double rgt_bangbang_min_time(Rgt_Bangbang *b, double target,
+                                    double current) {
+	uint64_t now = micros();
+	double dt = 0;
+	if (b->has_prev_current && now > b->last_time) {
+		dt = (now - b->last_time) / 1e6;
+		double velocity = (current - b->prev_current) / dt;
+		double alpha = b->velocity_filter / (b->velocity_filter + 1);
+		b->velocity = alpha * b->velocity + (1 - alpha) * velocity;
+	}
+	b->prev_current = current;
+	b->has_prev_current = true;
+	b->last_time = now;
+
+	double error = target - current;
+	if (fabs(error) <= b->band) {
+		// The mechanism can arrive still moving, so brake it to a stop
+		// before holding. Slower than one update of braking is stopped
+		if (b->deceleration > 0 && fabs(b->velocity) > b->deceleration * dt)
+			return b->velocity > 0 ? -b->brake_voltage : b->brake_voltage;
+		return b->hold_voltage;
+	}
+
+	double direction = error > 0 ? 1 : -1;
+	double speed = b->velocity * direction;
+	if (speed > 0 && b->deceleration > 0) {
+		// Braking can only start on the next update, after another update of
+		// speeding up, and the estimate is the average speed over the last
+		// update, so it lags by half of one. Both assume the mechanism speeds
+		// up about as fast as it brakes
+		double a = b->deceleration;
+		speed += a * dt / 2;
+		double next_speed = speed + a * dt;
+		double stopping = speed * dt + a * dt * dt / 2 +
+		                  next_speed * next_speed / (2 * a);
+		if (stopping >= fabs(error))
+			return -direction * b->brake_voltage;
+	}
+	return direction * b->on_voltage;
+}
+
+double rgt_bangbang_calculate(Rgt_Bangbang *b, double target, double current) {
+	switch (b->mode) {
+	case RGT_BANGBANG_HYSTERESIS:
+		// The first update has no last output to keep
+		if (!b->has_prev_current)
+			b->on = current < target;
+		else if (current < target - b->band)
+			b->on = true;
+		else if (current > target + b->band)
+			b->on = false;
+		b->has_prev_current = true;
+		return b->on ? b->on_voltage : b->off_voltage;
+	case RGT_BANGBANG_DEADBAND:
+		if (current < target - b->band)
+			return b->on_voltage;
+		if (current > target + b->band)
+			return b->off_voltage;
+		return b->hold_voltage;
+	case RGT_BANGBANG_MIN_TIME:
+		return rgt_bangbang_min_time(b, target, current);
+	}
+	return 0;
+}
+
+double rgt_bangbang_controller(void *bangbang, double target, double current,
+                               bool reset) {
+	Rgt_Bangbang *b = (Rgt_Bangbang *)bangbang;
+	if (reset)
+		rgt_bangbang_reset(b);
+	return rgt_bangbang_calculate(b, target, current);
+}
+
+double rgt_feedforward_calculate(const Rgt_Feedforward *ff, double velocity,
+                                 double acceleration) {
+	// Static friction only matters while moving
+	double friction = velocity != 0 ? copysign(ff->kS, velocity) : 0;
+	return friction + ff->kV * velocity + ff->kA * acceleration;
+}
+
+/**
+ * Reads one side of a tank drive's distance, holding its last distance while
+ * none of its motors can be read. Returns PROS_ERR_F if the side has never been
+ * read.
+ */
+static double rgt_tank_side_distance(Rgt_Tank_Drive *t,
+                                     const Rgt_Motor_Group *mg, uint8_t side) {
+	double position = rgt_mg_get_aggregate_position(
+	    mg, t->aggregation, t->aggregation_threshold, NULL);
+	if (position != PROS_ERR_F && isfinite(position)) {
+		t->held_distances[side] = position * t->scale;
+		t->held[side] = true;
+	}
+	return t->held[side] ? t->held_distances[side] : PROS_ERR_F;
+}
+
+void rgt_tank_get_sensor_data(void *tank, double *values) {
+	Rgt_Tank_Drive *t = (Rgt_Tank_Drive *)tank;
+	double left = rgt_tank_side_distance(t, t->left, 0);
+	double right = rgt_tank_side_distance(t, t->right, 1);
+	if (left == PROS_ERR_F || right == PROS_ERR_F) {
+		values[0] = PROS_ERR_F;
+		values[1] = PROS_ERR_F;
+		return;
+	}
+
+	values[0] = (left + right) / 2;
+	// Turning clockwise moves the left side forward relative to the right
+	values[1] = t->get_heading != NULL ? t->get_heading() : (left - right) / 2;
+}
+
+void rgt_tank_mix(double distance, double heading, double *voltages) {
+	if (fabs(heading) > 12000)
+		heading = copysign(12000, heading);
+	if (fabs(distance) + fabs(heading) > 12000)
+		distance = copysign(12000 - fabs(heading), distance);
+
+	voltages[0] = distance + heading;
+	voltages[1] = distance - heading;
+}
+
+void rgt_tank_calculate_voltages(void *tank, const double *targets,
+                                 const double *values, bool reset,
+                                 double *voltages) {
+	Rgt_Tank_Drive *t = (Rgt_Tank_Drive *)tank;
+	if (reset) {
+		rgt_pid_reset(&t->distance_pid);
+		rgt_pid_reset(&t->heading_pid);
+	}
+
+	double distance = rgt_pid_calculate_measured(&t->distance_pid, targets[0],
+	                                             values[0], reset);
+	double heading = rgt_pid_calculate_measured(&t->heading_pid, targets[1],
+	                                            values[1], reset);
+	if (t->feedforward != NULL) {
+		distance += t->feedforward[0];
+		heading += t->feedforward[1];
+	}
+	rgt_tank_mix(distance, heading, voltages);
+}
@@ -0,0 +1,195 @@
+#include "ringtail/scheduler.h"
+
+#include "ringtail/controller.h"
+
+#include "pros/rtos.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file scheduler.c
+ *
+ * @brief Function implementations for the controller scheduler
+ */
+
+/**
+ * A registered controller - the controller, the function that runs a cycle of
+ * it, and its period field, which the scheduler keeps up to date
+ */
+typedef struct {
+	void *controller;
+	void (*step)(void *);
+	uint32_t *period;
+} Rgt_Scheduler_Entry;
+
+static Rgt_Scheduler_Entry controllers[RGT_SCHEDULER_MAX_CONTROLLERS];
+static uint32_t dividers[RGT_SCHEDULER_MAX_CONTROLLERS];
+// Set from any task, so only accessed with GCC's __atomic builtins
+static bool enabled[RGT_SCHEDULER_MAX_CONTROLLERS];
+// Published with release order after the controller's slot is filled in
+static uint8_t controller_count = 0;
+
+static task_t scheduler_task = NULL;
+static uint32_t scheduler_period = 10;
+static uint16_t scheduler_stack_depth = TASK_STACK_DEPTH_DEFAULT;
+
+// The scheduler's position in its dividers, counted in cycles
+static uint32_t cycle = 0;
+
+/**
+ * The stats, as the scheduler task updates them, and as it publishes them.
+ * stats_seq counts the publishes, and its lowest bit selects which buffer holds
+ * the latest one. It is only accessed with GCC's __atomic builtins.
+ */
+static Rgt_Scheduler_Stats stats = {0};
+static uint32_t stats_seq = 0;
+static Rgt_Scheduler_Stats stats_buffers[2];
+
+/**
+ * Updates the savings in stats. The per-task model gives every controller a
+ * TASK_STACK_DEPTH_DEFAULT task, waking up at the controller's rate.
+ */
+static void rgt_scheduler_update_savings(uint8_t count) {
+	stats.controllers = count;
+	stats.tasks_saved = count - 1;
+	stats.stack_bytes_saved =
+	    ((int32_t)count * TASK_STACK_DEPTH_DEFAULT - scheduler_stack_depth) *
+	    (int32_t)sizeof(uint32_t);
+
+	int32_t task_wakeups = 0;
+	for (uint8_t c = 0; c < count; c++)
+		task_wakeups += 1000 / (scheduler_period * dividers[c]);
+	stats.wakeups_saved = task_wakeups - 1000 / scheduler_period;
+}
+
+// Publishes stats to rgt_scheduler_get_stats - only called from the scheduler
+static void rgt_scheduler_publish(void) {
+	uint32_t next = __atomic_load_n(&stats_seq, __ATOMIC_RELAXED) + 1;
+
+	// Readers only look at stats_buffers[seq & 1], so the other one is free
+	stats_buffers[next & 1] = stats;
+	__atomic_store_n(&stats_seq, next, __ATOMIC_RELEASE);
+}
+
+void rgt_scheduler_step(void) {
+	uint64_t start = micros();
+	uint32_t stepping = 0;
+
+	uint8_t count = __atomic_load_n(&controller_count, __ATOMIC_ACQUIRE);
+	for (uint8_t c = 0; c < count; c++) {
+		if (!__atomic_load_n(&enabled[c], __ATOMIC_RELAXED) ||
+		    cycle % dividers[c] != 0)
+			continue;
+		// Keeps the controller's timing statistics in terms of its rate
+		__atomic_store_n(controllers[c].period, scheduler_period * dividers[c],
+		                 __ATOMIC_RELAXED);
+		uint64_t step_start = micros();
+		controllers[c].step(controllers[c].controller);
+		stepping += (uint32_t)(micros() - step_start);
+	}
+
+	uint32_t busy = (uint32_t)(micros() - start);
+	stats.cycles++;
+	stats.last_busy_time = busy;
+	if (busy > stats.max_busy_time)
+		stats.max_busy_time = busy;
+	stats.mean_busy_time += (busy - stats.mean_busy_time) / stats.cycles;
+	stats.last_overhead_time = busy - stepping;
+	stats.mean_overhead_time +=
+	    (stats.last_overhead_time - stats.mean_overhead_time) / stats.cycles;
+	if (count != stats.controllers)
+		rgt_scheduler_update_savings(count);
+	stats.time_saved =
+	    stats.wakeups_saved * RGT_SCHEDULER_WAKEUP_TIME -
+	    (int32_t)(stats.mean_overhead_time * 1000 / scheduler_period);
+	rgt_scheduler_publish();
+
+	cycle++;
+}
+
+// The function run by the scheduler task
+static void rgt_scheduler_fn(void *param) {
+	(void)param;
+	uint32_t now = millis();
+
+	while (true) {
+		rgt_scheduler_step();
+		task_delay_until(&now, scheduler_period);
+	}
+}
+
+static bool rgt_scheduler_add_entry(Rgt_Scheduler_Entry entry,
+                                    uint32_t divider) {
+	if (divider == 0 || controller_count >= RGT_SCHEDULER_MAX_CONTROLLERS)
+		return false;
+	// Running a controller twice a cycle would run its motors twice as hard
+	for (uint8_t c = 0; c < controller_count; c++) {
+		if (controllers[c].controller == entry.controller)
+			return false;
+	}
+
+	// Fill in the slot before publishing it to the scheduler task
+	controllers[controller_count] = entry;
+	dividers[controller_count] = divider;
+	enabled[controller_count] = true;
+	__atomic_store_n(&controller_count, controller_count + 1,
+	                 __ATOMIC_RELEASE);
+	return true;
+}
+
+// Adapters from each controller type's step function to the scheduler's
+static void rgt_scheduler_step_single(void *i) {
+	rgt_controller_step((Rgt_Controller_Info *)i);
+}
+
+static void rgt_scheduler_step_coupled(void *c) {
+	rgt_coupled_controller_step((Rgt_Coupled_Controller *)c);
+}
+
+bool rgt_scheduler_add(Rgt_Controller_Info *i, uint32_t divider) {
+	return rgt_scheduler_add_entry(
+	    (Rgt_Scheduler_Entry){i, rgt_scheduler_step_single, &i->period},
+	    divider);
+}
+
+bool rgt_scheduler_add_coupled(Rgt_Coupled_Controller *c, uint32_t divider) {
+	return rgt_scheduler_add_entry(
+	    (Rgt_Scheduler_Entry){c, rgt_scheduler_step_coupled, &c->period},
+	    divider);
+}
+
+bool rgt_scheduler_set_enabled(const void *controller, bool enable) {
+	uint8_t count = __atomic_load_n(&controller_count, __ATOMIC_ACQUIRE);
+	for (uint8_t c = 0; c < count; c++) {
+		if (controllers[c].controller == controller) {
+			__atomic_store_n(&enabled[c], enable, __ATOMIC_RELAXED);
+			return true;
+		}
+	}
+	return false;
+}
+
+task_t rgt_scheduler_start(uint32_t period, uint8_t priority,
+                           uint16_t stack_depth) {
+	if (scheduler_task != NULL)
+		return scheduler_task;
+
+	scheduler_period = period;
+	scheduler_stack_depth = stack_depth;
+	scheduler_task = task_create(rgt_scheduler_fn, NULL, priority, stack_depth,
+	                             "Ringtail Scheduler");
+	return scheduler_task;
+}
+
+Rgt_Scheduler_Stats rgt_scheduler_get_stats(void) {
+	Rgt_Scheduler_Stats s;
+	uint32_t before, after;
+	do {
+		before = __atomic_load_n(&stats_seq, __ATOMIC_ACQUIRE);
+		s = stats_buffers[before & 1];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&stats_seq, __ATOMIC_RELAXED);
+	} while (before != after);
+	return s;
+}